@@ -0,0 +1,91 @@
+#!/bin/bash
+
+# Measure a running odgi server with curl, under a hit workload that asks the same
+# few queries over and over, which the response cache answers, and a miss workload
+# whose queries are all distinct. Prints the requests per second of each, and the
+# server's own counts, hit ratios and latency quantiles from /metrics.
+#
+# usage: server_benchmark.sh URL PATH_NAME PATH_LENGTH [REQUESTS] [CLIENTS] [ENDPOINT]
+#
+#   URL          where the server listens, e.g. http://localhost:3000
+#   PATH_NAME    a path in the server's index
+#   PATH_LENGTH  length of the path in nucleotides
+#   REQUESTS     requests per workload (default: 10000)
+#   CLIENTS      curl processes sending them, each over one keep-alive connection (default: 4)
+#   ENDPOINT     depth, steps or subgraph, which need a server given a graph, or position (default: depth)
+#
+# Queries answered before stay cached, so run the miss workload against a freshly
+# started server, or one started with --cache-size 0 to measure it without a cache.
+# Single positions are never cached, so for position only the miss workload is run,
+# and it measures lifting them.
+
+URL=$1
+PATH_NAME=$2
+PATH_LENGTH=$3
+REQUESTS=${4:-10000}
+CLIENTS=${5:-4}
+ENDPOINT=${6:-depth}
+# range queries span this many nucleotides
+RANGE=100
+# the hit workload cycles through this many queries
+HOT=16
+
+if [[ -z "$URL" || -z "$PATH_NAME" || -z "$PATH_LENGTH" ]]; then
+    echo "usage: $0 URL PATH_NAME PATH_LENGTH [REQUESTS] [CLIENTS] [ENDPOINT]" >&2
+    exit 1
+fi
+
+if ! curl -sf "$URL"/hi > /dev/null; then
+    echo " [server_benchmark] ERROR: no odgi server answers at $URL." >&2
+    exit 1
+fi
+
+WORK=$(mktemp -d)
+trap 'rm -rf "$WORK"' EXIT
+
+# the URL of the query starting at the given 1-based position
+query_url() {
+    if [[ "$ENDPOINT" == "position" ]]; then
+        echo "$URL/$PATH_NAME/$1"
+    else
+        local end=$(( $1 + RANGE - 1 < PATH_LENGTH ? $1 + RANGE - 1 : PATH_LENGTH ))
+        echo "$URL/$ENDPOINT/$PATH_NAME/$1/$end"
+    fi
+}
+
+# Send the queries starting at the positions on stdin, spread over the clients, and
+# print the requests per second
+run_workload() {
+    local name=$1
+    rm -f "$WORK"/client.*
+    local i=0
+    while read -r pos; do
+        echo "url = \"$(query_url "$pos")\"" >> "$WORK"/client.$(( i % CLIENTS ))
+        echo "output = \"/dev/null\"" >> "$WORK"/client.$(( i % CLIENTS ))
+        i=$(( i + 1 ))
+    done
+    local begin=$(date +%s.%N)
+    ls "$WORK"/client.* | xargs -P "$CLIENTS" -I {} curl -s -K {}
+    local end=$(date +%s.%N)
+    awk -v name="$name" -v n="$i" -v b="$begin" -v e="$end" \
+        'BEGIN { printf(" [server_benchmark] %s: %d requests in %.3f s, %.1f requests/s\n", name, n, e - b, n / (e - b)) }'
+}
+
+echo " [server_benchmark] INFO: Sending $REQUESTS $ENDPOINT queries per workload from $CLIENTS clients to $URL."
+
+if [[ "$ENDPOINT" == "position" ]]; then
+    echo " [server_benchmark] INFO: Single positions bypass the response cache, so the hit workload is skipped."
+else
+    # the hot queries are asked once before timing, so that every timed one is a hit
+    seq 1 "$HOT" | awk -v len="$PATH_LENGTH" '{ print 1 + ($1 * 7919) % len }' > "$WORK"/hot
+    run_workload "warm-up" < "$WORK"/hot > /dev/null
+    for (( i = 0; i < REQUESTS; i += HOT )); do cat "$WORK"/hot; done | head -n "$REQUESTS" | run_workload "hit workload"
+fi
+
+# distinct positions, from a random start, so that earlier runs are unlikely to have asked them
+awk -v n="$REQUESTS" -v len="$PATH_LENGTH" -v seed="$RANDOM" \
+    'BEGIN { srand(seed); start = int(rand() * len); for (i = 0; i < n; ++i) print 1 + (start + i * 104729) % len }' \
+    | run_workload "miss workload"
+
+echo " [server_benchmark] INFO: Server metrics:"
+curl -s "$URL"/metrics | grep -v '^#'
@@ -1,4 +1,5 @@
 #include "depth.hpp"
+#include "path_range_index.hpp"
 
 namespace odgi {
 namespace algorithms {
@@ -109,31 +110,16 @@ void for_each_path_range_depth(const PathHandleGraph& graph,
 	}
     // are we subsetting?
     const bool subset_paths = !paths_to_consider.empty();
-    // sort path ranges
-    std::vector<const path_range_t*> path_ranges;
+    // index the paths we have ranges on, so that each range only visits its own steps
+    path_range_index_t range_index(graph);
+    std::vector<path_handle_t> range_paths;
     for (auto& p : _path_ranges) {
-        path_ranges.push_back(&p);
-    }
-    std::sort(path_ranges.begin(),
-              path_ranges.end(),
-              [&](const path_range_t* a,
-                  const path_range_t* b) {
-                  return std::tie(as_integer(a->begin.path), a->begin.offset, a->end.offset, a->begin.is_rev)
-                      < std::tie(as_integer(b->begin.path), b->begin.offset, b->end.offset, b->begin.is_rev);
-              });
-    // order our path ranges
-    std::vector<std::pair<std::vector<const path_range_t*>::const_iterator,
-                          std::vector<const path_range_t*>::const_iterator>> paths_todo;
-    auto p = path_ranges.begin();
-    while (p != path_ranges.end()) {
-        auto n = p; ++n;
-        while (n != path_ranges.end()
-               && (*n)->begin.path == (*p)->begin.path) {
-            ++n;
-        }
-        paths_todo.push_back(std::make_pair(p, n));
-        p = n;
+        range_paths.push_back(p.begin.path);
     }
+    std::sort(range_paths.begin(), range_paths.end(),
+              [](const path_handle_t& a, const path_handle_t& b) { return as_integer(a) < as_integer(b); });
+    range_paths.erase(std::unique(range_paths.begin(), range_paths.end()), range_paths.end());
+    range_index.index_paths(range_paths, omp_get_max_threads());
     // precompute depths for all handles in parallel
     std::vector<uint64_t> depths(graph.get_node_count() + 1);
     graph.for_each_handle(
@@ -152,66 +138,25 @@ void for_each_path_range_depth(const PathHandleGraph& graph,
                 d = graph.get_step_count(h);
             }
         }, true);
-    // dip into the path ranges, for each
+    // dip into the path ranges, each on its own
 #pragma omp parallel for schedule(dynamic,1)
-    for (auto& p : paths_todo) {
-        auto& path = (*p.first)->begin.path;
-        std::vector<std::pair<const path_range_t*, uint64_t>> active_ranges;
-        auto range_itr = p.first;
-        auto ranges_end = p.second;
-        uint64_t offset = 0;
-        graph.for_each_step_in_path(
-            path,
-            [&](const step_handle_t& step) {
-                // understand our context
+    for (uint64_t i = 0; i < _path_ranges.size(); ++i) {
+        auto& range = _path_ranges[i];
+        // ranges starting past the end of their path are not reported
+        if (range.begin.offset >= range_index.get_path_length(range.begin.path)) {
+            continue;
+        }
+        uint64_t sum = 0;
+        range_index.for_each_step_in_range(
+            range.begin.path, range.begin.offset, range.end.offset,
+            [&](const step_handle_t& step, const uint64_t& offset) {
                 handle_t handle = graph.get_handle_of_step(step);
-                auto node_length = graph.get_length(handle);
-                auto node_end = offset + node_length;
-                // remove non-active ranges and call callbacks
-                active_ranges.erase(
-                    std::remove_if(active_ranges.begin(),
-                                   active_ranges.end(),
-                                   [&](auto& r) {
-                                       if (r.first->end.offset <= offset) {
-                                           func(*r.first,
-                                                (double)r.second /
-                                                (double)(r.first->end.offset
-                                                         - r.first->begin.offset));
-                                           return true;
-                                       } else {
-                                           return false;
-                                       }
-                                   }),
-                    active_ranges.end());
-                // find ranges that start in this node, and add them to active ranges
-                while (range_itr != ranges_end
-                       && (*range_itr)->begin.offset < node_end
-                       && (*range_itr)->begin.offset >= offset) {
-                    active_ranges.push_back(std::make_pair(*range_itr++, 0));
-                }
-                // compute coverage on node
-                auto& d = depths[graph.get_id(handle) - shift];
-                // add coverage to active ranges
-                for (auto& r : active_ranges) {
-                    auto l = node_length;
-                    if (r.first->begin.offset > offset) {
-                        l -= r.first->begin.offset - offset;
-                    }
-                    if (r.first->end.offset < node_end) {
-                        l -= node_end - r.first->end.offset;
-                    }
-                    r.second += (d * l);
-                }
-                // to node end
-                offset = node_end;
+                const uint64_t node_end = offset + graph.get_length(handle);
+                // count the part of the node in the range
+                const uint64_t l = std::min(node_end, range.end.offset) - std::max(offset, range.begin.offset);
+                sum += depths[graph.get_id(handle) - shift] * l;
             });
-        // clear out any ranges that are still active at the end
-        for (auto& r : active_ranges) {
-            func(*r.first,
-                 (double)r.second /
-                 (double)(r.first->end.offset
-                          - r.first->begin.offset));
-        }
+        func(range, (double)sum / (double)(range.end.offset - range.begin.offset));
     }
 }
 
@@ -0,0 +1,200 @@
+#include "index_cache.hpp"
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+#include <unistd.h>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace {
+
+std::string to_hex(const uint64_t& n) {
+	std::stringstream ss;
+	ss << std::hex << std::setw(16) << std::setfill('0') << n;
+	return ss.str();
+}
+
+uint64_t mix(uint64_t x) {
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdull;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ull;
+	x ^= x >> 33;
+	return x;
+}
+
+uint64_t hash_of(const std::string& s) {
+	uint64_t h = s.size();
+	for (const char c : s) {
+		h = mix(h ^ (uint8_t)c);
+	}
+	return h;
+}
+
+bool is_hex(const std::string& s) {
+	return std::all_of(s.begin(), s.end(), [](const char c) {
+		return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'f');
+	});
+}
+
+}
+
+index_cache_t::index_cache_t(const std::string& dir, const std::string& graph_file) : dir(dir) {
+	std::error_code ec;
+	std::filesystem::create_directories(dir, ec);
+	if (!std::filesystem::is_directory(dir, ec)) {
+		throw std::runtime_error("[odgi::algorithms::index_cache] error: could not create the index cache directory " + dir);
+	}
+	if (graph_file == "-") {
+		stem = "stdin";
+		return;
+	}
+	// graphs of the same name in other directories may share the cache, so the
+	// stem tells them apart by where they are
+	std::error_code path_ec;
+	std::filesystem::path path = std::filesystem::absolute(graph_file, path_ec);
+	const std::filesystem::path canonical = std::filesystem::weakly_canonical(path, path_ec);
+	if (!path_ec) {
+		path = canonical;
+	}
+	stem = std::filesystem::path(graph_file).filename().string() + "." + to_hex(hash_of(path.string()));
+}
+
+std::string index_cache_t::file_of(const uint64_t& fingerprint, const std::string& kind) const {
+	return (std::filesystem::path(dir) / (stem + "." + to_hex(fingerprint) + "." + kind)).string();
+}
+
+bool index_cache_t::has(const uint64_t& fingerprint, const std::string& kind) const {
+	std::error_code ec;
+	return std::filesystem::is_regular_file(file_of(fingerprint, kind), ec);
+}
+
+void index_cache_t::store(const uint64_t& fingerprint, const std::string& kind,
+						  const std::function<void(const std::string&)>& write) const {
+	const std::string file = file_of(fingerprint, kind);
+	const std::string tmp = file + ".tmp" + std::to_string(getpid());
+	write(tmp);
+	std::error_code ec;
+	std::filesystem::rename(tmp, file, ec);
+	if (ec) {
+		std::filesystem::remove(tmp, ec);
+		throw std::runtime_error("[odgi::algorithms::index_cache] error: could not store " + file);
+	}
+	// indexes of this kind built from other versions of the graph won't be used again
+	const std::string prefix = stem + ".";
+	const std::string suffix = "." + kind;
+	const std::string current = std::filesystem::path(file).filename().string();
+	for (auto& entry : std::filesystem::directory_iterator(dir, ec)) {
+		const std::string name = entry.path().filename().string();
+		if (name != current
+			&& name.size() == prefix.size() + 16 + suffix.size()
+			&& name.compare(0, prefix.size(), prefix) == 0
+			&& name.compare(name.size() - suffix.size(), suffix.size(), suffix) == 0
+			&& is_hex(name.substr(prefix.size(), 16))) {
+			std::error_code rm_ec;
+			std::filesystem::remove(entry.path(), rm_ec);
+		}
+	}
+}
+
+std::unique_ptr<step_index_t> cached_step_index(const index_cache_t* cache,
+												const graph_t& graph,
+												const std::vector<path_handle_t>& paths,
+												const uint64_t& nthreads,
+												const bool progress,
+												const uint64_t& sample_rate) {
+	if (cache == nullptr) {
+		return std::make_unique<step_index_t>(graph, paths, nthreads, progress, sample_rate);
+	}
+	// the index covers the steps of the given paths only, so they are part of its kind
+	std::vector<uint64_t> path_ids;
+	for (auto& path : paths) {
+		path_ids.push_back(as_integer(path));
+	}
+	std::sort(path_ids.begin(), path_ids.end());
+	path_ids.erase(std::unique(path_ids.begin(), path_ids.end()), path_ids.end());
+	uint64_t paths_hash = path_ids.size();
+	for (auto& id : path_ids) {
+		paths_hash = mix(paths_hash ^ id);
+	}
+	const std::string kind = "stpidx" + std::to_string(sample_rate) + "." + to_hex(paths_hash);
+	const uint64_t fingerprint = graph.fingerprint();
+	if (cache->has(fingerprint, kind)) {
+		if (progress) {
+			std::cerr << "[odgi::algorithms::index_cache] loading the step index from " << cache->file_of(fingerprint, kind) << std::endl;
+		}
+		auto step_index = std::make_unique<step_index_t>();
+		step_index->load(cache->file_of(fingerprint, kind));
+		return step_index;
+	}
+	auto step_index = std::make_unique<step_index_t>(graph, paths, nthreads, progress, sample_rate);
+	cache->store(fingerprint, kind, [&](const std::string& file) {
+		step_index->save(file);
+	});
+	return step_index;
+}
+
+void cached_path_index(const index_cache_t* cache,
+					   graph_t& graph,
+					   xp::XP& path_index,
+					   const uint64_t& nthreads,
+					   const bool progress) {
+	if (cache == nullptr) {
+		path_index.from_handle_graph(graph, nthreads);
+		return;
+	}
+	const std::string kind = "xp";
+	const uint64_t fingerprint = graph.fingerprint();
+	if (cache->has(fingerprint, kind)) {
+		if (progress) {
+			std::cerr << "[odgi::algorithms::index_cache] loading the path index from " << cache->file_of(fingerprint, kind) << std::endl;
+		}
+		path_index.load(cache->file_of(fingerprint, kind));
+		return;
+	}
+	path_index.from_handle_graph(graph, nthreads);
+	cache->store(fingerprint, kind, [&](const std::string& file) {
+		std::ofstream out(file);
+		path_index.serialize_members(out);
+	});
+}
+
+void cached_path_range_index(const index_cache_t* cache,
+							 const graph_t& graph,
+							 path_range_index_t& range_index,
+							 const uint64_t& nthreads,
+							 const bool progress) {
+	if (cache == nullptr) {
+		return;
+	}
+	const std::string kind = "rngidx";
+	const uint64_t fingerprint = graph.fingerprint();
+	if (cache->has(fingerprint, kind)) {
+		if (progress) {
+			std::cerr << "[odgi::algorithms::index_cache] loading the path range index from " << cache->file_of(fingerprint, kind) << std::endl;
+		}
+		std::ifstream in(cache->file_of(fingerprint, kind), std::ios::binary);
+		range_index.load(in);
+		return;
+	}
+	std::vector<path_handle_t> paths;
+	graph.for_each_path_handle([&](const path_handle_t& path) {
+		paths.push_back(path);
+	});
+	range_index.index_paths(paths, nthreads);
+	cache->store(fingerprint, kind, [&](const std::string& file) {
+		std::ofstream out(file, std::ios::binary);
+		range_index.save(out);
+	});
+}
+
+}
+
+}
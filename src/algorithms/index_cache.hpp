@@ -0,0 +1,77 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <handlegraph/types.hpp>
+#include "odgi.hpp"
+#include "stepindex.hpp"
+#include "xp.hpp"
+#include "path_range_index.hpp"
+
+namespace odgi {
+
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// A directory of the indexes that subcommands build over a graph, which they
+/// reuse on later runs. Each index is filed under the fingerprint of the graph
+/// it was built from, as <graph file>.<path hash>.<fingerprint>.<kind>, so it is
+/// only used while the graph is unchanged. The hash of the graph file's absolute
+/// path keeps graphs of the same name in different directories apart. Storing an
+/// index removes those of its kind built from earlier versions of the same graph
+/// file. Indexes are written to
+/// a temporary file that is then renamed into place, so runs sharing the cache
+/// never read one that is half written.
+class index_cache_t {
+public:
+	/// Use the cache in dir, creating it if needed, for the graph read from graph_file
+	index_cache_t(const std::string& dir, const std::string& graph_file);
+
+	/// File holding the index of this kind for the graph with this fingerprint
+	std::string file_of(const uint64_t& fingerprint, const std::string& kind) const;
+
+	/// Is an index of this kind cached for the graph with this fingerprint?
+	bool has(const uint64_t& fingerprint, const std::string& kind) const;
+
+	/// Store an index of this kind, which write writes to the file it is given
+	void store(const uint64_t& fingerprint, const std::string& kind,
+			   const std::function<void(const std::string&)>& write) const;
+
+private:
+	std::string dir;
+	std::string stem;
+};
+
+/// Load the step index over paths from the cache, or build it and store it there.
+/// Without a cache the index is simply built.
+std::unique_ptr<step_index_t> cached_step_index(const index_cache_t* cache,
+												const graph_t& graph,
+												const std::vector<path_handle_t>& paths,
+												const uint64_t& nthreads,
+												const bool progress,
+												const uint64_t& sample_rate);
+
+/// Load the path index from the cache, or build it and store it there.
+/// Without a cache the index is simply built.
+void cached_path_index(const index_cache_t* cache,
+					   graph_t& graph,
+					   xp::XP& path_index,
+					   const uint64_t& nthreads,
+					   const bool progress);
+
+/// Load the step offsets of all paths into the range index from the cache, or
+/// index all paths and store them there. Without a cache the paths are left to
+/// be indexed when first queried.
+void cached_path_range_index(const index_cache_t* cache,
+							 const graph_t& graph,
+							 path_range_index_t& range_index,
+							 const uint64_t& nthreads,
+							 const bool progress);
+
+}
+
+}
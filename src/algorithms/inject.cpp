@@ -1,4 +1,5 @@
 #include "inject.hpp"
+#include "odgi.hpp"
 
 namespace odgi {
 
@@ -152,6 +153,24 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
         }
     }
 
+    // copy the steps in [begin, end) to the end of the injected path, in one batch if the graph supports it
+    graph_t* odgi_graph = dynamic_cast<graph_t*>(&graph);
+    auto append_range =
+        [&](const path_handle_t& injected, step_handle_t begin, const step_handle_t& end) {
+            std::vector<handle_t> steps;
+            do {
+                steps.push_back(graph.get_handle_of_step(begin));
+                begin = graph.get_next_step(begin);
+            } while (begin != end);
+            if (odgi_graph) {
+                odgi_graph->append_steps(injected, steps);
+            } else {
+                for (auto& h : steps) {
+                    graph.append_step(injected, h);
+                }
+            }
+        };
+
     // then we iterate back through the sorted path intervals and add paths at the appropriate points
 #pragma omp parallel for
     for (auto& path : paths) {
@@ -193,12 +212,7 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                             assert(f != injected_paths.end());
                             p = f->second;
                         }
-                        auto& c = open_intervals_by_end.begin()->second;
-                        auto end = step;
-                        do {
-                            graph.append_step(p, graph.get_handle_of_step(c));
-                            c = graph.get_next_step(c);
-                        } while (c != end);
+                        append_range(p, open_intervals_by_end.begin()->second, step);
                         // clean up
                         open_intervals_by_end.erase(open_intervals_by_end.begin());
                     }
@@ -232,12 +246,7 @@ void inject_ranges(MutablePathDeletableHandleGraph& graph,
                     assert(f != injected_paths.end());
                     p = f->second;
                 }
-                auto& c = open_intervals_by_end.begin()->second;
-                auto end = graph.path_end(path);
-                do {
-                    graph.append_step(p, graph.get_handle_of_step(c));
-                    c = graph.get_next_step(c);
-                } while (c != end);
+                append_range(p, open_intervals_by_end.begin()->second, graph.path_end(path));
                 // clean up
                 open_intervals_by_end.erase(open_intervals_by_end.begin());
             }
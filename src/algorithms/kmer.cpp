@@ -62,10 +62,9 @@ void for_each_kmer(const HandleGraph& graph, size_t k, size_t edge_max,
                             nid_t curr_id = graph.get_id(kmer.curr);
                             size_t curr_length = graph.get_length(kmer.curr);
                             bool curr_is_rev = graph.get_is_reverse(kmer.curr);
-                            std::string curr_seq = graph.get_sequence(kmer.curr);
                             size_t take = std::min(curr_length, k-kmer.seq.size());
                             kmer.end = make_pos_t(curr_id, curr_is_rev, take);
-                            kmer.seq.append(curr_seq.substr(0,take));
+                            kmer.seq.append(graph.get_subsequence(kmer.curr, 0, take));
                             if (kmer.seq.size() < k) {
                                 size_t next_count = 0;
                                 if (edge_max) graph.follow_edges(kmer.curr, false, [&](const handle_t& next) { ++next_count; return next_count <= 1; });
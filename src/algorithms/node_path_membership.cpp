@@ -0,0 +1,166 @@
+#include "node_path_membership.hpp"
+#include <algorithm>
+#include <stdexcept>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace {
+
+/// The ranks of the steps on the node, sorted, with ranks that aren't counted dropped
+void ranks_on_node(const PathHandleGraph& graph, const handle_t& handle, const std::vector<uint32_t>& path_ranks,
+				   std::vector<uint32_t>& on_node) {
+	on_node.clear();
+	graph.for_each_step_on_handle(handle, [&](const step_handle_t& step) {
+		const uint64_t path = as_integer(graph.get_path_handle_of_step(step));
+		if (path < path_ranks.size() && path_ranks[path] != node_path_membership_t::no_rank) {
+			on_node.push_back(path_ranks[path]);
+		}
+	});
+	std::sort(on_node.begin(), on_node.end());
+}
+
+}
+
+uint64_t popcount(const uint64_t* words, const uint64_t& n) {
+	uint64_t bits = 0;
+	for (uint64_t i = 0; i < n; ++i) {
+		bits += __builtin_popcountll(words[i]);
+	}
+	return bits;
+}
+
+node_path_membership_t::node_path_membership_t(const PathHandleGraph& graph, const std::vector<uint32_t>& path_ranks,
+											   const uint32_t& rank_count)
+	: rank_count(rank_count), bitmap_words(((uint64_t)rank_count + 63) / 64) {
+	for (auto& rank : path_ranks) {
+		if (rank != no_rank && rank >= rank_count) {
+			throw std::runtime_error("[odgi::algorithms::node_path_membership] error: path rank " + std::to_string(rank)
+									 + " is not below the rank count " + std::to_string(rank_count));
+		}
+	}
+	if (graph.get_node_count() == 0) {
+		member_begin.resize(1, 0);
+		set_begin.resize(1, 0);
+		return;
+	}
+	min_id = graph.min_node_id();
+	const uint64_t node_slots = graph.max_node_id() - min_id + 1;
+	// count the ranks on each node, to lay the sets out before filling them
+	member_begin.resize(node_slots + 1, 0);
+	graph.for_each_handle([&](const handle_t& handle) {
+		std::vector<uint32_t> on_node;
+		ranks_on_node(graph, handle, path_ranks, on_node);
+		member_begin[graph.get_id(handle) - min_id + 1] =
+			std::unique(on_node.begin(), on_node.end()) - on_node.begin();
+	}, true);
+	set_begin.resize(node_slots + 1, 0);
+	uint64_t array_size = 0;
+	uint64_t bitmap_size = 0;
+	for (uint64_t i = 0; i < node_slots; ++i) {
+		const uint64_t members = member_begin[i + 1];
+		if (is_bitmap(members)) {
+			set_begin[i] = bitmap_size;
+			bitmap_size += bitmap_words;
+		} else {
+			set_begin[i] = array_size;
+			array_size += members;
+		}
+		member_begin[i + 1] += member_begin[i];
+	}
+	set_begin[node_slots] = array_size;
+	counts.resize(member_begin.back());
+	ranks.resize(array_size);
+	bitmaps.resize(bitmap_size, 0);
+	graph.for_each_handle([&](const handle_t& handle) {
+		std::vector<uint32_t> on_node;
+		ranks_on_node(graph, handle, path_ranks, on_node);
+		const uint64_t i = graph.get_id(handle) - min_id;
+		const bool bitmap = is_bitmap(member_begin[i + 1] - member_begin[i]);
+		uint64_t member = member_begin[i];
+		for (uint64_t j = 0; j < on_node.size(); ++member) {
+			const uint32_t rank = on_node[j];
+			uint64_t k = j;
+			while (k < on_node.size() && on_node[k] == rank) ++k;
+			counts[member] = k - j;
+			if (bitmap) {
+				bitmaps[set_begin[i] + rank / 64] |= (uint64_t)1 << (rank % 64);
+			} else {
+				ranks[set_begin[i] + member - member_begin[i]] = rank;
+			}
+			j = k;
+		}
+	}, true);
+}
+
+bool node_path_membership_t::is_bitmap(const uint64_t& members) const {
+	// an array takes half a word per rank
+	return members > 2 * bitmap_words;
+}
+
+uint32_t node_path_membership_t::get_rank_count(void) const {
+	return rank_count;
+}
+
+uint32_t node_path_membership_t::get_member_count(const nid_t& id) const {
+	const uint64_t i = id - min_id;
+	if (id < min_id || i + 1 >= member_begin.size()) {
+		return 0;
+	}
+	return member_begin[i + 1] - member_begin[i];
+}
+
+uint32_t node_path_membership_t::get_step_count(const nid_t& id, const uint32_t& rank) const {
+	const uint64_t members = get_member_count(id);
+	if (members == 0 || rank >= rank_count) {
+		return 0;
+	}
+	const uint64_t i = id - min_id;
+	if (is_bitmap(members)) {
+		const uint64_t* words = bitmaps.data() + set_begin[i];
+		const uint64_t bit = (uint64_t)1 << (rank % 64);
+		if (!(words[rank / 64] & bit)) {
+			return 0;
+		}
+		// the members before this one are the bits set below it
+		return counts[member_begin[i] + popcount(words, rank / 64) + __builtin_popcountll(words[rank / 64] & (bit - 1))];
+	} else {
+		auto first = ranks.begin() + set_begin[i];
+		auto found = std::lower_bound(first, first + members, rank);
+		if (found == first + members || *found != rank) {
+			return 0;
+		}
+		return counts[member_begin[i] + (found - first)];
+	}
+}
+
+bool node_path_membership_t::has_member(const nid_t& id, const uint32_t& rank) const {
+	return get_step_count(id, rank) > 0;
+}
+
+void node_path_membership_t::for_each_member(const nid_t& id,
+											 const std::function<void(const uint32_t&, const uint32_t&)>& func) const {
+	const uint64_t members = get_member_count(id);
+	if (members == 0) {
+		return;
+	}
+	const uint64_t i = id - min_id;
+	uint64_t member = member_begin[i];
+	if (is_bitmap(members)) {
+		const uint64_t* words = bitmaps.data() + set_begin[i];
+		for (uint64_t w = 0; w < bitmap_words; ++w) {
+			for (uint64_t bits = words[w]; bits; bits &= bits - 1) {
+				func(w * 64 + __builtin_ctzll(bits), counts[member++]);
+			}
+		}
+	} else {
+		for (uint64_t j = 0; j < members; ++j, ++member) {
+			func(ranks[set_begin[i] + j], counts[member]);
+		}
+	}
+}
+
+}
+
+}
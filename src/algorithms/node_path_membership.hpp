@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <functional>
+#include <limits>
+#include <handlegraph/types.hpp>
+#include <handlegraph/util.hpp>
+#include <handlegraph/path_handle_graph.hpp>
+#include "odgi.hpp"
+
+namespace odgi {
+
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// For each node, the set of path ranks (paths, or groups of paths) with steps
+/// on it and how many steps each has there. As in roaring bitmaps, a node's set
+/// is kept as a sorted array of ranks while that is smaller than a bitmap over
+/// all the ranks, and as that bitmap otherwise. Step counts follow in rank order.
+/// It is built once, in parallel over the nodes, and the graph must not change.
+class node_path_membership_t {
+public:
+	/// Marks a path whose steps are not counted
+	static constexpr uint32_t no_rank = std::numeric_limits<uint32_t>::max();
+
+	node_path_membership_t(void) = default;
+
+	/// Index the steps of the graph, where path_ranks gives the rank of each path by as_integer(path)
+	node_path_membership_t(const PathHandleGraph& graph, const std::vector<uint32_t>& path_ranks, const uint32_t& rank_count);
+
+	/// Number of ranks that sets can hold
+	uint32_t get_rank_count(void) const;
+
+	/// Number of ranks with steps on the node
+	uint32_t get_member_count(const nid_t& id) const;
+
+	/// Number of steps of the rank on the node, 0 if it has none
+	uint32_t get_step_count(const nid_t& id, const uint32_t& rank) const;
+
+	/// Whether the rank has steps on the node
+	bool has_member(const nid_t& id, const uint32_t& rank) const;
+
+	/// Call func with each rank on the node, in increasing order, and its step count
+	void for_each_member(const nid_t& id, const std::function<void(const uint32_t&, const uint32_t&)>& func) const;
+
+private:
+	nid_t min_id = 0;
+	uint32_t rank_count = 0;
+	uint64_t bitmap_words = 0;
+	/// where each node's step counts start in counts, one more than the nodes
+	std::vector<uint64_t> member_begin;
+	/// where each node's set starts, in ranks if it is an array or in bitmaps otherwise
+	std::vector<uint64_t> set_begin;
+	std::vector<uint32_t> counts;
+	std::vector<uint32_t> ranks;
+	std::vector<uint64_t> bitmaps;
+	/// Whether a set of this many ranks is kept as a bitmap
+	bool is_bitmap(const uint64_t& members) const;
+};
+
+/// Number of bits set in the first n words
+uint64_t popcount(const uint64_t* words, const uint64_t& n);
+
+}
+
+}
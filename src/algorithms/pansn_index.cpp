@@ -0,0 +1,222 @@
+#include "pansn_index.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string_view>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace {
+
+/// Marks the start of a saved PanSN index, with its format version
+const uint64_t pansn_index_magic = 0x6e736e705f696764ull;
+const uint64_t pansn_index_version = 1;
+
+void write_string(std::ostream& out, const std::string& s) {
+	const uint64_t size = s.size();
+	out.write((const char*)&size, sizeof(size));
+	out.write(s.data(), size);
+}
+
+void read_string(std::istream& in, std::string& s) {
+	uint64_t size = 0;
+	in.read((char*)&size, sizeof(size));
+	if (!in) {
+		throw std::runtime_error("[odgi::algorithms::pansn_index] error: the PanSN index is truncated");
+	}
+	s.resize(size);
+	in.read((char*)s.data(), size);
+}
+
+}
+
+pansn_index_t::pansn_index_t(const PathHandleGraph& graph, const char& delim, const uint64_t& levels) : delim(delim) {
+	struct entry_t {
+		path_handle_t path;
+		std::string name;
+		/// length of the group name at each level
+		std::vector<uint64_t> cuts;
+	};
+	std::vector<entry_t> entries;
+	entries.reserve(graph.get_path_count());
+	uint64_t max_path = 0;
+	graph.for_each_path_handle([&](const path_handle_t& path) {
+		entry_t entry{path, graph.get_path_name(path), {}};
+		std::vector<uint64_t> found;
+		for (uint64_t pos = entry.name.find(delim); pos != std::string::npos && found.size() < levels;
+			 pos = entry.name.find(delim, pos + 1)) {
+			found.push_back(pos);
+		}
+		for (uint64_t k = 0; k < levels; ++k) {
+			entry.cuts.push_back(found.empty() ? entry.name.size() : found[std::min(k + 1, (uint64_t)found.size()) - 1]);
+		}
+		max_path = std::max(max_path, (uint64_t)as_integer(path));
+		if (delimiters.size() <= max_path) {
+			delimiters.resize(max_path + 1, 0);
+		}
+		delimiters[as_integer(path)] = found.size();
+		entries.push_back(std::move(entry));
+	});
+	// sorting on each level's group name in turn keeps every group together
+	std::sort(entries.begin(), entries.end(), [&](const entry_t& a, const entry_t& b) {
+		for (uint64_t k = 0; k < levels; ++k) {
+			const int c = std::string_view(a.name).substr(0, a.cuts[k]).compare(std::string_view(b.name).substr(0, b.cuts[k]));
+			if (c != 0) {
+				return c < 0;
+			}
+		}
+		return a.name < b.name;
+	});
+	for (auto& entry : entries) {
+		paths.push_back(entry.path);
+	}
+	this->levels.resize(levels);
+	for (uint64_t k = 0; k < levels; ++k) {
+		auto& level = this->levels[k];
+		for (uint64_t i = 0; i < entries.size(); ++i) {
+			auto& entry = entries[i];
+			if (i == 0 || std::string_view(entry.name).substr(0, entry.cuts[k]) != level.names.back()) {
+				level.names.push_back(entry.name.substr(0, entry.cuts[k]));
+				level.begins.push_back(i);
+			}
+		}
+		level.begins.push_back(entries.size());
+	}
+	index_groups();
+}
+
+void pansn_index_t::index_groups(void) {
+	uint64_t max_path = 0;
+	for (auto& path : paths) {
+		max_path = std::max(max_path, (uint64_t)as_integer(path));
+	}
+	for (auto& level : levels) {
+		level.group_of.assign(max_path + 1, 0);
+		level.by_name.clear();
+		for (uint64_t g = 0; g < level.names.size(); ++g) {
+			for (uint64_t i = level.begins[g]; i < level.begins[g + 1]; ++i) {
+				level.group_of[as_integer(paths[i])] = g;
+			}
+			level.by_name[level.names[g]] = g;
+		}
+	}
+}
+
+char pansn_index_t::get_delimiter(void) const {
+	return delim;
+}
+
+uint64_t pansn_index_t::get_level_count(void) const {
+	return levels.size();
+}
+
+uint64_t pansn_index_t::get_group_count(const uint64_t& level) const {
+	return levels.at(level).names.size();
+}
+
+const std::string& pansn_index_t::get_group_name(const uint64_t& level, const uint64_t& group) const {
+	return levels.at(level).names.at(group);
+}
+
+uint64_t pansn_index_t::get_group(const path_handle_t& path, const uint64_t& level) const {
+	return levels.at(level).group_of.at(as_integer(path));
+}
+
+uint64_t pansn_index_t::get_delimiter_count(const path_handle_t& path) const {
+	return delimiters.at(as_integer(path));
+}
+
+std::pair<uint64_t, uint64_t> pansn_index_t::get_paths_of_group(const uint64_t& level, const uint64_t& group) const {
+	auto& begins = levels.at(level).begins;
+	return std::make_pair(begins.at(group), begins.at(group + 1));
+}
+
+std::pair<uint64_t, uint64_t> pansn_index_t::get_subgroups(const uint64_t& level, const uint64_t& group) const {
+	if (level + 1 >= levels.size()) {
+		throw std::runtime_error("[odgi::algorithms::pansn_index] error: level " + std::to_string(level)
+								 + " is the last one, so its groups have no subgroups");
+	}
+	const auto range = get_paths_of_group(level, group);
+	auto& next = levels[level + 1];
+	return std::make_pair(next.group_of[as_integer(paths[range.first])],
+						  next.group_of[as_integer(paths[range.second - 1])] + 1);
+}
+
+std::pair<uint64_t, uint64_t> pansn_index_t::find(const std::string& prefix) const {
+	for (uint64_t k = 0; k < levels.size(); ++k) {
+		auto f = levels[k].by_name.find(prefix);
+		if (f != levels[k].by_name.end()) {
+			return get_paths_of_group(k, f->second);
+		}
+	}
+	return std::make_pair(0, 0);
+}
+
+const std::vector<path_handle_t>& pansn_index_t::get_paths(void) const {
+	return paths;
+}
+
+void pansn_index_t::save(std::ostream& out) const {
+	const uint64_t header[5] = {pansn_index_magic, pansn_index_version, (uint64_t)(unsigned char)delim,
+								levels.size(), paths.size()};
+	out.write((const char*)header, sizeof(header));
+	for (auto& path : paths) {
+		const uint64_t i = as_integer(path);
+		out.write((const char*)&i, sizeof(i));
+	}
+	const uint64_t delimiter_count = delimiters.size();
+	out.write((const char*)&delimiter_count, sizeof(delimiter_count));
+	out.write((const char*)delimiters.data(), delimiters.size() * sizeof(uint16_t));
+	for (auto& level : levels) {
+		const uint64_t group_count = level.names.size();
+		out.write((const char*)&group_count, sizeof(group_count));
+		out.write((const char*)level.begins.data(), level.begins.size() * sizeof(uint64_t));
+		for (auto& name : level.names) {
+			write_string(out, name);
+		}
+	}
+}
+
+void pansn_index_t::load(std::istream& in) {
+	uint64_t header[5];
+	in.read((char*)header, sizeof(header));
+	if (!in || header[0] != pansn_index_magic) {
+		throw std::runtime_error("[odgi::algorithms::pansn_index] error: the input is not a PanSN index");
+	}
+	if (header[1] != pansn_index_version) {
+		throw std::runtime_error("[odgi::algorithms::pansn_index] error: unsupported PanSN index version "
+								 + std::to_string(header[1]));
+	}
+	delim = (char)header[2];
+	levels.clear();
+	levels.resize(header[3]);
+	paths.resize(header[4]);
+	for (auto& path : paths) {
+		uint64_t i = 0;
+		in.read((char*)&i, sizeof(i));
+		path = as_path_handle(i);
+	}
+	uint64_t delimiter_count = 0;
+	in.read((char*)&delimiter_count, sizeof(delimiter_count));
+	delimiters.resize(delimiter_count);
+	in.read((char*)delimiters.data(), delimiters.size() * sizeof(uint16_t));
+	for (auto& level : levels) {
+		uint64_t group_count = 0;
+		in.read((char*)&group_count, sizeof(group_count));
+		level.begins.resize(group_count + 1);
+		in.read((char*)level.begins.data(), level.begins.size() * sizeof(uint64_t));
+		level.names.resize(group_count);
+		for (auto& name : level.names) {
+			read_string(in, name);
+		}
+		if (!in || level.begins.back() != paths.size()) {
+			throw std::runtime_error("[odgi::algorithms::pansn_index] error: the PanSN index is truncated");
+		}
+	}
+	index_groups();
+}
+
+}
+
+}
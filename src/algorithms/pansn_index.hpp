@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <handlegraph/types.hpp>
+#include <handlegraph/util.hpp>
+#include <handlegraph/path_handle_graph.hpp>
+
+namespace odgi {
+
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// Groups a graph's paths by the fields of their PanSN names (sample#haplotype#contig).
+/// The group of a path at level k is the part of its name before the (k+1)-th
+/// delimiter, or before its last delimiter if it has fewer, or the whole name if it
+/// has none. With the default two levels, these are the samples and the haplotypes.
+/// Paths are sorted so that every group, at every level, is a range of them, nested
+/// in the range of its group at the level above.
+class pansn_index_t {
+public:
+	pansn_index_t(void) = default;
+
+	/// Group the paths of the graph, splitting names at delim
+	explicit pansn_index_t(const PathHandleGraph& graph, const char& delim = '#', const uint64_t& levels = 2);
+
+	/// Delimiter the names were split at
+	char get_delimiter(void) const;
+
+	/// Number of grouping levels
+	uint64_t get_level_count(void) const;
+
+	/// Number of groups at the level
+	uint64_t get_group_count(const uint64_t& level) const;
+
+	/// Name of the group, which is the prefix shared by the names of its paths
+	const std::string& get_group_name(const uint64_t& level, const uint64_t& group) const;
+
+	/// Group of the path at the level
+	uint64_t get_group(const path_handle_t& path, const uint64_t& level) const;
+
+	/// Number of delimiters in the path's name, counting no more than the levels
+	uint64_t get_delimiter_count(const path_handle_t& path) const;
+
+	/// Paths of the group, as a range of get_paths()
+	std::pair<uint64_t, uint64_t> get_paths_of_group(const uint64_t& level, const uint64_t& group) const;
+
+	/// Groups of the next level inside the group, as a range of that level's groups
+	std::pair<uint64_t, uint64_t> get_subgroups(const uint64_t& level, const uint64_t& group) const;
+
+	/// Range of get_paths() of the first level with a group named prefix, which is empty if none is
+	std::pair<uint64_t, uint64_t> find(const std::string& prefix) const;
+
+	/// All paths, ordered so that the paths of each group are together
+	const std::vector<path_handle_t>& get_paths(void) const;
+
+	/// Write the index
+	void save(std::ostream& out) const;
+
+	/// Read an index written by save
+	void load(std::istream& in);
+
+private:
+	struct level_t {
+		std::vector<std::string> names;
+		/// where each group's paths start in paths, one more than the groups
+		std::vector<uint64_t> begins;
+		/// group of each path by as_integer(path)
+		std::vector<uint64_t> group_of;
+		std::unordered_map<std::string, uint64_t> by_name;
+	};
+	char delim = '#';
+	std::vector<path_handle_t> paths;
+	/// delimiters of each path by as_integer(path), capped at the level count
+	std::vector<uint16_t> delimiters;
+	std::vector<level_t> levels;
+	/// Fill in what is derived from the paths, names and begins of each level
+	void index_groups(void);
+};
+
+}
+
+}
@@ -0,0 +1,148 @@
+#include "path_range_index.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <omp.h>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace {
+
+/// Marks the start of a saved path range index, with its format version
+const uint64_t path_range_index_magic = 0x7872705f6967646full;
+const uint64_t path_range_index_version = 1;
+
+}
+
+path_range_index_t::path_range_index_t(const PathHandleGraph& graph) : graph(graph) {
+	uint64_t max_path = 0;
+	graph.for_each_path_handle([&](const path_handle_t& path) {
+		max_path = std::max(max_path, (uint64_t)as_integer(path));
+	});
+	paths.resize(max_path + 1);
+	indexed = std::make_unique<std::once_flag[]>(max_path + 1);
+}
+
+const path_range_index_t::indexed_path_t& path_range_index_t::path_at(const path_handle_t& path) const {
+	const uint64_t i = as_integer(path);
+	if (i >= paths.size()) {
+		throw std::runtime_error("[odgi::algorithms::path_range_index] error: path " + std::to_string(i) + " is not in the graph");
+	}
+	auto& p = paths[i];
+	std::call_once(indexed[i], [&]() {
+		p.offsets.push_back(0);
+		graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+			p.steps.push_back(step);
+			p.offsets.push_back(p.offsets.back() + graph.get_length(graph.get_handle_of_step(step)));
+		});
+	});
+	return p;
+}
+
+void path_range_index_t::index_paths(const std::vector<path_handle_t>& paths, const uint64_t& nthreads) {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+	for (uint64_t i = 0; i < paths.size(); ++i) {
+		path_at(paths[i]);
+	}
+}
+
+uint64_t path_range_index_t::get_path_length(const path_handle_t& path) const {
+	return path_at(path).offsets.back();
+}
+
+uint64_t path_range_index_t::get_step_count(const path_handle_t& path) const {
+	return path_at(path).steps.size();
+}
+
+uint64_t path_range_index_t::get_rank(const path_handle_t& path, const uint64_t& offset) const {
+	auto& offsets = path_at(path).offsets;
+	if (offset >= offsets.back()) {
+		return offsets.size() - 1;
+	}
+	// the first step starting after the offset follows the one covering it
+	return std::upper_bound(offsets.begin(), offsets.end() - 1, offset) - offsets.begin() - 1;
+}
+
+step_handle_t path_range_index_t::get_step(const path_handle_t& path, const uint64_t& rank) const {
+	return path_at(path).steps[rank];
+}
+
+uint64_t path_range_index_t::get_offset(const path_handle_t& path, const uint64_t& rank) const {
+	return path_at(path).offsets[rank];
+}
+
+void path_range_index_t::for_each_step_in_range(const path_handle_t& path, const uint64_t& begin, const uint64_t& end,
+												const std::function<void(const step_handle_t&, const uint64_t&)>& func) const {
+	auto& p = path_at(path);
+	for (uint64_t rank = get_rank(path, begin); rank < p.steps.size() && p.offsets[rank] < end; ++rank) {
+		func(p.steps[rank], p.offsets[rank]);
+	}
+}
+
+void path_range_index_t::steps_in_range(const std::vector<path_range_t>& ranges,
+										std::vector<std::vector<step_handle_t>>& steps,
+										const uint64_t& nthreads) const {
+	steps.clear();
+	steps.resize(ranges.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+	for (uint64_t i = 0; i < ranges.size(); ++i) {
+		auto& range = ranges[i];
+		for_each_step_in_range(range.begin.path, range.begin.offset, range.end.offset,
+							   [&](const step_handle_t& step, const uint64_t& offset) {
+								   steps[i].push_back(step);
+							   });
+	}
+}
+
+void path_range_index_t::save(std::ostream& out) const {
+	uint64_t count = 0;
+	for (auto& p : paths) {
+		count += !p.offsets.empty();
+	}
+	const uint64_t header[3] = {path_range_index_magic, path_range_index_version, count};
+	out.write((const char*)header, sizeof(header));
+	for (uint64_t i = 0; i < paths.size(); ++i) {
+		auto& p = paths[i];
+		if (p.offsets.empty()) continue;
+		const uint64_t path_header[2] = {i, p.steps.size()};
+		out.write((const char*)path_header, sizeof(path_header));
+		out.write((const char*)p.steps.data(), p.steps.size() * sizeof(step_handle_t));
+		out.write((const char*)p.offsets.data(), p.offsets.size() * sizeof(uint64_t));
+	}
+}
+
+void path_range_index_t::load(std::istream& in) {
+	uint64_t header[3];
+	in.read((char*)header, sizeof(header));
+	if (!in || header[0] != path_range_index_magic) {
+		throw std::runtime_error("[odgi::algorithms::path_range_index] error: the input is not a path range index");
+	}
+	if (header[1] != path_range_index_version) {
+		throw std::runtime_error("[odgi::algorithms::path_range_index] error: unsupported path range index version "
+								 + std::to_string(header[1]));
+	}
+	for (uint64_t n = 0; n < header[2]; ++n) {
+		uint64_t path_header[2];
+		in.read((char*)path_header, sizeof(path_header));
+		const uint64_t i = path_header[0];
+		if (!in || i >= paths.size()) {
+			throw std::runtime_error("[odgi::algorithms::path_range_index] error: the path range index doesn't match the graph");
+		}
+		indexed_path_t p;
+		p.steps.resize(path_header[1]);
+		p.offsets.resize(path_header[1] + 1);
+		in.read((char*)p.steps.data(), p.steps.size() * sizeof(step_handle_t));
+		in.read((char*)p.offsets.data(), p.offsets.size() * sizeof(uint64_t));
+		if (!in) {
+			throw std::runtime_error("[odgi::algorithms::path_range_index] error: the path range index is truncated");
+		}
+		std::call_once(indexed[i], [&]() {
+			paths[i] = std::move(p);
+		});
+	}
+}
+
+}
+
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <cstdint>
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <handlegraph/types.hpp>
+#include <handlegraph/util.hpp>
+#include <handlegraph/path_handle_graph.hpp>
+#include "position.hpp"
+
+namespace odgi {
+
+namespace algorithms {
+
+using namespace handlegraph;
+
+/// The start offsets of the steps of a graph's paths, for finding the steps in
+/// path ranges by binary search instead of by walking each path from its start.
+/// A path is indexed the first time it is queried, from whichever thread asks,
+/// or up front with index_paths. The graph must not change while it is in use.
+class path_range_index_t {
+public:
+	explicit path_range_index_t(const PathHandleGraph& graph);
+	path_range_index_t(const path_range_index_t& other) = delete;
+	path_range_index_t& operator=(const path_range_index_t& other) = delete;
+
+	/// Index these paths now, several at a time
+	void index_paths(const std::vector<path_handle_t>& paths, const uint64_t& nthreads);
+
+	/// Length of the path in bp
+	uint64_t get_path_length(const path_handle_t& path) const;
+
+	/// Number of steps in the path
+	uint64_t get_step_count(const path_handle_t& path) const;
+
+	/// Rank of the step covering the offset, or the step count if the offset is past the path end
+	uint64_t get_rank(const path_handle_t& path, const uint64_t& offset) const;
+
+	/// Step of the given rank
+	step_handle_t get_step(const path_handle_t& path, const uint64_t& rank) const;
+
+	/// Offset at which the step of the given rank starts, where the step count gives the path length
+	uint64_t get_offset(const path_handle_t& path, const uint64_t& rank) const;
+
+	/// Call func with each step overlapping [begin, end) of the path, in path order, and its start offset
+	void for_each_step_in_range(const path_handle_t& path, const uint64_t& begin, const uint64_t& end,
+								const std::function<void(const step_handle_t&, const uint64_t&)>& func) const;
+
+	/// Collect the steps overlapping each of the ranges, looking the ranges up in parallel
+	void steps_in_range(const std::vector<path_range_t>& ranges,
+						std::vector<std::vector<step_handle_t>>& steps,
+						const uint64_t& nthreads) const;
+
+	/// Write the paths indexed so far
+	void save(std::ostream& out) const;
+
+	/// Read paths written by save for this graph, which will not be indexed again. The
+	/// steps are kept as handles, which hold their rank on the node, so the graph must
+	/// also have its steps on each node in the same order, as its fingerprint checks
+	void load(std::istream& in);
+
+private:
+	struct indexed_path_t {
+		std::vector<step_handle_t> steps;
+		/// one more than the steps, ending with the path length
+		std::vector<uint64_t> offsets;
+	};
+	const PathHandleGraph& graph;
+	mutable std::vector<indexed_path_t> paths;
+	std::unique_ptr<std::once_flag[]> indexed;
+	/// The path's steps and offsets, indexing them if this is the first query
+	const indexed_path_t& path_at(const path_handle_t& path) const;
+};
+
+}
+
+}
@@ -0,0 +1,303 @@
+#include "position_batch.hpp"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <omp.h>
+
+namespace odgi {
+
+namespace algorithms {
+
+namespace {
+
+[[noreturn]] void malformed(const std::string& what) {
+	throw std::runtime_error("[odgi::algorithms::position_batch] error: " + what);
+}
+
+/// Just enough of a JSON reader for arrays of lookups
+struct json_reader_t {
+	const std::string& s;
+	uint64_t i = 0;
+
+	explicit json_reader_t(const std::string& s) : s(s) {}
+
+	char peek(void) {
+		while (i < s.size() && std::isspace((unsigned char)s[i])) ++i;
+		if (i == s.size()) {
+			malformed("unexpected end of JSON input");
+		}
+		return s[i];
+	}
+
+	void expect(const char& c) {
+		if (peek() != c) {
+			malformed(std::string("expected '") + c + "' at byte " + std::to_string(i) + " of the JSON input");
+		}
+		++i;
+	}
+
+	/// Whether the next character is c, which is then consumed
+	bool accept(const char& c) {
+		if (peek() == c) {
+			++i;
+			return true;
+		}
+		return false;
+	}
+
+	std::string read_string(void) {
+		expect('"');
+		std::string out;
+		while (i < s.size() && s[i] != '"') {
+			char c = s[i++];
+			if (c == '\\') {
+				if (i == s.size()) break;
+				c = s[i++];
+				switch (c) {
+				case 'n': out.push_back('\n'); break;
+				case 't': out.push_back('\t'); break;
+				case 'r': out.push_back('\r'); break;
+				case 'b': out.push_back('\b'); break;
+				case 'f': out.push_back('\f'); break;
+				case 'u': {
+					if (i + 4 > s.size() || !std::all_of(s.begin() + i, s.begin() + i + 4,
+														 [](const char& h) { return std::isxdigit((unsigned char)h); })) {
+						malformed("bad \\u escape in the JSON input");
+					}
+					const uint32_t code = std::stoul(s.substr(i, 4), nullptr, 16);
+					i += 4;
+					// names are expected to be ASCII, but anything in the basic plane is kept as UTF-8
+					if (code < 0x80) {
+						out.push_back(code);
+					} else if (code < 0x800) {
+						out.push_back(0xc0 | (code >> 6));
+						out.push_back(0x80 | (code & 0x3f));
+					} else {
+						out.push_back(0xe0 | (code >> 12));
+						out.push_back(0x80 | ((code >> 6) & 0x3f));
+						out.push_back(0x80 | (code & 0x3f));
+					}
+					break;
+				}
+				default: out.push_back(c); break;
+				}
+			} else {
+				out.push_back(c);
+			}
+		}
+		if (i == s.size()) {
+			malformed("unterminated string in the JSON input");
+		}
+		++i;
+		return out;
+	}
+
+	/// A position given as a number or as a string of digits
+	uint64_t read_position(void) {
+		if (peek() == '"') {
+			return parse_position(read_string());
+		}
+		const uint64_t begin = i;
+		while (i < s.size() && (std::isalnum((unsigned char)s[i]) || s[i] == '-' || s[i] == '+' || s[i] == '.')) ++i;
+		return parse_position(s.substr(begin, i - begin));
+	}
+
+	/// Skip over a value we don't use
+	void skip_value(void) {
+		const char c = peek();
+		if (c == '"') {
+			read_string();
+		} else if (c == '[' || c == '{') {
+			const char close = c == '[' ? ']' : '}';
+			++i;
+			if (accept(close)) return;
+			do {
+				if (close == '}') {
+					read_string();
+					expect(':');
+				}
+				skip_value();
+			} while (accept(','));
+			expect(close);
+		} else {
+			while (i < s.size() && (std::isalnum((unsigned char)s[i]) || s[i] == '-' || s[i] == '+' || s[i] == '.')) ++i;
+		}
+	}
+
+	path_position_query_t read_query(void) {
+		path_position_query_t query;
+		if (accept('[')) {
+			query.path_name = read_string();
+			expect(',');
+			query.position = read_position();
+			expect(']');
+			return query;
+		}
+		expect('{');
+		bool has_path = false;
+		bool has_position = false;
+		if (!accept('}')) {
+			do {
+				const std::string key = read_string();
+				expect(':');
+				if (key == "path" || key == "name") {
+					query.path_name = read_string();
+					has_path = true;
+				} else if (key == "pos" || key == "position") {
+					query.position = read_position();
+					has_position = true;
+				} else {
+					skip_value();
+				}
+			} while (accept(','));
+			expect('}');
+		}
+		if (!has_path || !has_position) {
+			malformed("each JSON lookup needs a \"path\" and a \"pos\"");
+		}
+		return query;
+	}
+};
+
+}
+
+uint64_t parse_position(const std::string& digits) {
+	if (digits.empty()) {
+		malformed("missing position");
+	}
+	uint64_t position = 0;
+	for (auto& c : digits) {
+		if (!std::isdigit((unsigned char)c)) {
+			malformed("position '" + digits + "' is not a non-negative integer");
+		}
+		if (position > (std::numeric_limits<uint64_t>::max() - (c - '0')) / 10) {
+			malformed("position '" + digits + "' is too large");
+		}
+		position = position * 10 + (c - '0');
+	}
+	return position;
+}
+
+std::vector<path_position_query_t> parse_position_batch(const std::string& body, bool& is_json) {
+	std::vector<path_position_query_t> queries;
+	uint64_t first = 0;
+	while (first < body.size() && std::isspace((unsigned char)body[first])) ++first;
+	is_json = first < body.size() && body[first] == '[';
+	if (is_json) {
+		json_reader_t reader(body);
+		reader.expect('[');
+		if (!reader.accept(']')) {
+			do {
+				queries.push_back(reader.read_query());
+			} while (reader.accept(','));
+			reader.expect(']');
+		}
+		while (reader.i < body.size() && std::isspace((unsigned char)body[reader.i])) ++reader.i;
+		if (reader.i < body.size()) {
+			malformed("unexpected input after the JSON array");
+		}
+		return queries;
+	}
+	std::istringstream in(body);
+	std::string line;
+	uint64_t line_number = 0;
+	while (std::getline(in, line)) {
+		++line_number;
+		if (!line.empty() && line.back() == '\r') {
+			line.pop_back();
+		}
+		if (line.empty()) {
+			continue;
+		}
+		// names may hold colons, as in subpath names, so NAME:N splits at the last one
+		uint64_t split = line.find('\t');
+		if (split == std::string::npos) {
+			split = line.rfind(':');
+		}
+		if (split == std::string::npos) {
+			malformed("line " + std::to_string(line_number) + " is not NAME<TAB>POSITION or NAME:POSITION");
+		}
+		path_position_query_t query;
+		query.path_name = line.substr(0, split);
+		query.position = parse_position(line.substr(split + 1));
+		queries.push_back(std::move(query));
+	}
+	return queries;
+}
+
+std::vector<uint64_t> lift_position_batch(const xp::XP& index, const std::vector<path_position_query_t>& queries,
+										  const uint64_t& nthreads) {
+	// each name is looked up in the index once, however often it is asked for
+	std::unordered_map<std::string, uint64_t> name_ranks;
+	std::vector<const std::string*> names;
+	std::vector<uint64_t> query_names(queries.size());
+	for (uint64_t i = 0; i < queries.size(); ++i) {
+		auto f = name_ranks.emplace(queries[i].path_name, names.size());
+		if (f.second) {
+			names.push_back(&queries[i].path_name);
+		}
+		query_names[i] = f.first->second;
+	}
+	std::vector<handlegraph::path_handle_t> paths(names.size());
+	std::vector<uint64_t> lengths(names.size(), 0);
+	// names matching several paths are refused once we are out of the parallel region
+	std::vector<uint8_t> ambiguous(names.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+	for (uint64_t j = 0; j < names.size(); ++j) {
+		try {
+			paths[j] = index.find_path_handle(*names[j]);
+		} catch (const xp::XPQueryError& e) {
+			paths[j] = as_path_handle(0);
+			ambiguous[j] = 1;
+		}
+		if (as_integer(paths[j]) != 0) {
+			lengths[j] = index.get_path_length(paths[j]);
+		}
+	}
+	for (uint64_t j = 0; j < names.size(); ++j) {
+		if (ambiguous[j]) {
+			throw std::runtime_error("[odgi::algorithms::position_batch] error: the path name '" + *names[j]
+									 + "' matches several paths in the index");
+		}
+	}
+	std::vector<uint64_t> positions(queries.size(), 0);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+	for (uint64_t i = 0; i < queries.size(); ++i) {
+		const uint64_t j = query_names[i];
+		const uint64_t position = queries[i].position;
+		if (position > 0 && position <= lengths[j]) {
+			positions[i] = index.get_pangenome_pos(paths[j], position - 1) + 1;
+		}
+	}
+	return positions;
+}
+
+std::string format_position_batch(const std::vector<path_position_query_t>& queries,
+								  const std::vector<uint64_t>& positions, const bool& is_json) {
+	std::string out;
+	if (is_json) {
+		out.push_back('[');
+		for (uint64_t i = 0; i < positions.size(); ++i) {
+			if (i > 0) out.push_back(',');
+			out.append(std::to_string(positions[i]));
+		}
+		out.push_back(']');
+	} else {
+		for (uint64_t i = 0; i < positions.size(); ++i) {
+			out.append(queries[i].path_name);
+			out.push_back('\t');
+			out.append(std::to_string(queries[i].position));
+			out.push_back('\t');
+			out.append(std::to_string(positions[i]));
+			out.push_back('\n');
+		}
+	}
+	return out;
+}
+
+}
+
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "xp.hpp"
+
+namespace odgi {
+
+namespace algorithms {
+
+/// A path:position lookup, with a 1-based position
+struct path_position_query_t {
+	std::string path_name;
+	uint64_t position = 0;
+};
+
+/// A position written as decimal digits, throwing if it is anything else or overflows
+uint64_t parse_position(const std::string& digits);
+
+/// Read a batch of lookups, given either as a JSON array of {"path": NAME, "pos": N}
+/// objects or of [NAME, N] pairs, or as lines of NAME<TAB>N or NAME:N. Sets is_json by
+/// the form found, and throws on malformed input.
+std::vector<path_position_query_t> parse_position_batch(const std::string& body, bool& is_json);
+
+/// The 1-based pangenome position of each lookup, or 0 where the path or position is not
+/// in the index. Each path name is resolved once, and positions are lifted in parallel.
+/// Throws if a name matches several paths, rather than guessing which one was meant.
+std::vector<uint64_t> lift_position_batch(const xp::XP& index, const std::vector<path_position_query_t>& queries,
+										  const uint64_t& nthreads);
+
+/// Answer a batch in the form it was asked in: a JSON array of positions, or lines of NAME<TAB>N<TAB>POSITION
+std::string format_position_batch(const std::vector<path_position_query_t>& queries,
+								  const std::vector<uint64_t>& positions, const bool& is_json);
+
+}
+
+}
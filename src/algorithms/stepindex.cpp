@@ -1,5 +1,6 @@
 #include "stepindex.hpp"
 #include "progress.hpp"
+#include <unordered_map>
 
 namespace odgi {
 namespace algorithms {
@@ -115,6 +116,77 @@ const uint64_t step_index_t::get_position(const step_handle_t& step, const PathH
 	}
 }
 
+void step_index_t::get_positions(const std::vector<step_handle_t>& steps, std::vector<uint64_t>& positions,
+								 const PathHandleGraph& graph) const {
+	const uint64_t n = steps.size();
+	positions.resize(n);
+	// each position is that of a base plus the length walked from it, where the base
+	// is a sampled step, an earlier step of the batch, or the start of the path
+	const uint64_t sampled_base = n;
+	const uint64_t path_start_base = n + 1;
+	std::vector<uint64_t> base(n);
+	std::vector<step_handle_t> anchor(n);
+	std::vector<uint64_t> walked(n, 0);
+	std::unordered_map<step_handle_t, uint64_t, step_handle_hasher_t> earlier;
+	if (this->sample_rate > 1) {
+		earlier.reserve(n);
+	}
+	for (uint64_t i = 0; i < n; ++i) {
+		step_handle_t cur_step = steps[i];
+		if (this->sample_rate == 0 || 0 == utils::modulo(graph.get_id(graph.get_handle_of_step(cur_step)), this->sample_rate)) {
+			base[i] = sampled_base;
+			anchor[i] = cur_step;
+			continue;
+		}
+		base[i] = path_start_base;
+		while (graph.has_previous_step(cur_step)) {
+			step_handle_t prev_step = graph.get_previous_step(cur_step);
+			handle_t prev_h = graph.get_handle_of_step(prev_step);
+			walked[i] += graph.get_length(prev_h);
+			if (utils::modulo(graph.get_id(prev_h), this->sample_rate) == 0) {
+				base[i] = sampled_base;
+				anchor[i] = prev_step;
+				break;
+			}
+			auto e = earlier.find(prev_step);
+			if (e != earlier.end()) {
+				base[i] = e->second;
+				break;
+			}
+			cur_step = prev_step;
+		}
+		earlier.emplace(steps[i], i);
+	}
+	// look up the sampled positions, hashing one group while the reads of the last one are in flight
+	const uint64_t group_size = 32;
+	std::vector<uint64_t> slot(n);
+	for (uint64_t begin = 0; begin < n + group_size; begin += group_size) {
+		const uint64_t end = std::min(n, begin + group_size);
+		for (uint64_t i = begin; i < end; ++i) {
+			if (base[i] == sampled_base) {
+				slot[i] = step_mphf->lookup(anchor[i]);
+				__builtin_prefetch(pos.data() + slot[i]);
+			}
+		}
+		if (begin >= group_size) {
+			const uint64_t prev_end = std::min(n, begin);
+			for (uint64_t i = begin - group_size; i < prev_end; ++i) {
+				if (base[i] == sampled_base) {
+					positions[i] = pos[slot[i]] + walked[i];
+				}
+			}
+		}
+	}
+	// the other steps build on those before them
+	for (uint64_t i = 0; i < n; ++i) {
+		if (base[i] == path_start_base) {
+			positions[i] = walked[i];
+		} else if (base[i] < n) {
+			positions[i] = positions[base[i]] + walked[i];
+		}
+	}
+}
+
 const uint64_t step_index_t::get_path_len(const path_handle_t& path) const {
 	return path_len[as_integer(path) - 1];
 }
@@ -60,6 +60,11 @@ struct step_index_t {
 	step_index_t& operator=(step_index_t&& other) = delete;
 
     const uint64_t get_position(const step_handle_t& step, const PathHandleGraph& graph) const;
+	/// Get the positions of many steps at once. Hashes are computed a group at a time with
+	/// the position reads prefetched, and a walk back to a sampled step stops at any step
+	/// earlier in the batch, so steps given in path order share their walks.
+	void get_positions(const std::vector<step_handle_t>& steps, std::vector<uint64_t>& positions,
+					   const PathHandleGraph& graph) const;
 	const uint64_t get_path_len(const path_handle_t& path) const;
 	void save(const std::string& name) const;
 	void load(const std::string& name);
@@ -196,6 +196,22 @@ namespace odgi {
                     });
         }
 
+        void extract_path_range(const graph_t &source, const path_range_index_t &index, path_handle_t path_handle,
+                                int64_t start, int64_t end, graph_t &subgraph) {
+            index.for_each_step_in_range(
+                    path_handle, std::max(start, (int64_t)0), std::max(end, (int64_t)0),
+                    [&](const step_handle_t& step, const uint64_t& offset) {
+                        const handle_t cur_handle = source.get_handle_of_step(step);
+                        const nid_t id = source.get_id(cur_handle);
+                        if (!subgraph.has_node(id)) {
+                            subgraph.create_handle(
+                                    source.get_sequence(
+                                            source.get_is_reverse(cur_handle) ? source.flip(cur_handle) : cur_handle),
+                                            id);
+                        }
+                    });
+        }
+
         void for_handle_in_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                       const std::function<void(const handle_t&)>& lambda) {
             uint64_t walked = 0;
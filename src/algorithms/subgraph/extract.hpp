@@ -12,6 +12,7 @@
 #include "utils.hpp"
 #include "position.hpp"
 #include "src/algorithms/subgraph/region.hpp"
+#include "src/algorithms/path_range_index.hpp"
 
 namespace odgi {
     namespace algorithms {
@@ -31,6 +32,10 @@ namespace odgi {
         void extract_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                 graph_t &subgraph);
 
+        /// extract_path_range, finding the steps of the range through the index instead of walking the path from its start
+        void extract_path_range(const graph_t &source, const path_range_index_t &index, path_handle_t path_handle,
+                                int64_t start, int64_t end, graph_t &subgraph);
+
         void for_handle_in_path_range(const graph_t &source, path_handle_t path_handle, int64_t start, int64_t end,
                                       const std::function<void(const handle_t&)>& lambda);
 
@@ -71,7 +71,7 @@ namespace odgi {
     }
 
     void add_bed_range(std::vector<odgi::path_range_t>& path_ranges,
-                       const odgi::graph_t &graph,
+                       const handlegraph::PathHandleGraph &graph,
                        const std::string &buffer) {
         if (!buffer.empty() && buffer[0] != '#') {
             const auto vals = split(buffer, '\t');
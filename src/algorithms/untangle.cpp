@@ -130,13 +130,22 @@ std::vector<step_handle_t> untangle_cuts(
         }
         cut_points.push_back(end);
     }
-    // and sort
-    std::sort(cut_points.begin(),
-              cut_points.end(),
-              [&](const step_handle_t& a,
-                  const step_handle_t& b) {
-                  return step_index.get_position(a, graph) < step_index.get_position(b, graph);
+    // and sort, looking the positions up once rather than in every comparison
+    std::vector<uint64_t> cut_positions;
+    step_index.get_positions(cut_points, cut_positions, graph);
+    std::vector<std::pair<uint64_t, step_handle_t>> sorted_cuts(cut_points.size());
+    for (uint64_t i = 0; i < cut_points.size(); ++i) {
+        sorted_cuts[i] = std::make_pair(cut_positions[i], cut_points[i]);
+    }
+    std::sort(sorted_cuts.begin(),
+              sorted_cuts.end(),
+              [&](const std::pair<uint64_t, step_handle_t>& a,
+                  const std::pair<uint64_t, step_handle_t>& b) {
+                  return a.first < b.first;
               });
+    for (uint64_t i = 0; i < cut_points.size(); ++i) {
+        cut_points[i] = sorted_cuts[i].second;
+    }
     //auto prev_size = cut_points.size();
     // then take unique positions
     cut_points.erase(std::unique(cut_points.begin(),
@@ -152,9 +161,11 @@ void write_cuts(
     const std::vector<step_handle_t>& cuts,
     const step_index_t& step_index) {
     auto path_name = graph.get_path_name(path);
+    std::vector<uint64_t> positions;
+    step_index.get_positions(cuts, positions, graph);
     std::cout << "name\tcut" << std::endl;
-    for (auto& step : cuts) {
-        std::cout << path_name << "\t" << step_index.get_position(step, graph) << std::endl;
+    for (auto& pos : positions) {
+        std::cout << path_name << "\t" << pos << std::endl;
     }
 }
 
@@ -166,8 +177,11 @@ std::vector<step_handle_t> merge_cuts(
     std::vector<step_handle_t> merged;
     uint64_t last = 0;
     //std::cerr << "dist is " << dist << std::endl;
-    for (auto& step : cuts) {
-        auto pos = step_index.get_position(step, graph);
+    std::vector<uint64_t> positions;
+    step_index.get_positions(cuts, positions, graph);
+    for (uint64_t i = 0; i < cuts.size(); ++i) {
+        auto& step = cuts[i];
+        auto pos = positions[i];
         if (pos == 0 || pos > (last + dist)) {
             merged.push_back(step);
             last = pos;
@@ -573,11 +587,13 @@ void map_segments(
         bool is_inv;
     };
     std::vector<path_range_t> gene_order;
+    std::vector<uint64_t> cut_positions;
+    step_index.get_positions(cuts, cut_positions, graph);
     for (uint64_t i = 0; i < cuts.size()-1; ++i) {
         auto& begin = cuts[i];
         auto& end = cuts[i+1];
-        auto begin_pos = step_index.get_position(begin, graph);
-        auto end_pos = step_index.get_position(end, graph);
+        auto begin_pos = cut_positions[i];
+        auto end_pos = cut_positions[i+1];
         uint64_t length = end_pos - begin_pos;
         // get the self coverage TODO
         double self_coverage = self_mean_coverage(graph, self_index, path, begin, end);
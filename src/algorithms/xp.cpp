@@ -10,6 +10,24 @@ namespace xp {
     // Here is XP
     ////////////////////////////////////////////////////////////////////////////
 
+    namespace {
+        /// Throws away what is written to it
+        struct null_buffer_t : public std::streambuf {
+            int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+            std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+        };
+
+        /// Reads from memory, keeping track of where it is
+        struct memory_buffer_t : public std::streambuf {
+            memory_buffer_t(char* begin, uint64_t size) {
+                setg(begin, begin, begin + size);
+            }
+            uint64_t position() const {
+                return gptr() - eback();
+            }
+        };
+    }
+
     XP::~XP() {
         // Clean up any created XPPaths
         while (!paths.empty()) {
@@ -17,6 +35,7 @@ namespace xp {
             paths.pop_back();
         }
         path_count = 0;
+        unmap();
     }
 
     /// build the graph from a graph handle
@@ -64,31 +83,84 @@ namespace xp {
 #endif
         // record the number of nodes + the number of paths within each node
         uint64_t np_size = 0;
+        graph.for_each_handle([&](const handle_t &h) {
+            np_size += graph.get_step_count(h);
+        });
+        // the node->path vectors are built in memory when they fit in our budget,
+        // and through a memory mapped multimap in a temporary file otherwise
+        const bool in_memory = np_size * (2 * sizeof(uint64_t) + 1) <= get_memory_budget();
         std::string node_path_idx = basename + ".node_path.mm";
-        // we fill the multiset with a tuple[handle id, step_rank, path_id, rank_of_handle_in_path]
-        mmmulti::map<uint64_t , std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>>
-            node_path_ms(node_path_idx, std::make_tuple(0, 0, 0, 0));
-        node_path_ms.open_writer();
+        std::unique_ptr<mmmulti::map<uint64_t , std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>>> node_path_ms;
+        // nodes are keyed by id, which runs past the node count while deleted nodes leave holes
+        const uint64_t id_slots = std::max<uint64_t>(graph.get_node_count(), graph.max_node_id());
+        // where each node's steps start in the node->path vectors, by id - 1, when built in memory
+        std::vector<uint64_t> np_offsets;
+        if (in_memory) {
+            // a counting sort: each node's steps go in rank order after those of the nodes before it
+            np_offsets.resize(id_slots + 1, 0);
+            graph.for_each_handle([&](const handle_t &h) {
+                np_offsets[graph.get_id(h)] = graph.get_step_count(h);
+            });
+            for (uint64_t i = 1; i < np_offsets.size(); ++i) {
+                np_offsets[i] += np_offsets[i-1];
+            }
+            sdsl::util::assign(nr_iv, sdsl::int_vector<>(np_size));
+            sdsl::util::assign(npi_iv, sdsl::int_vector<>(np_size));
+        } else {
+            // we fill the multiset with a tuple[handle id, step_rank, path_id, rank_of_handle_in_path]
+            node_path_ms = std::make_unique<mmmulti::map<uint64_t , std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>>>(
+                node_path_idx, std::make_tuple(0, 0, 0, 0));
+            node_path_ms->open_writer();
+        }
+        // collect the paths and their names, so that both can be indexed at once
+        std::vector<path_handle_t> path_handles;
         graph.for_each_path_handle([&](const path_handle_t &path) {
+            path_handles.push_back(path);
+            path_names += start_marker + graph.get_path_name(path) + end_marker;
+        });
+        // the path name CSA is built while the paths are indexed
+        std::string path_name_file = basename + ".pathnames.iv";
+        std::thread pn_csa_builder([&]() {
+            if (in_memory) {
+                sdsl::construct_im(pn_csa, path_names.c_str(), 1);
+            } else {
+                // write path names to temp file
+                sdsl::store_to_file((const char *) path_names.c_str(), path_name_file);
+                // read file and construct compressed suffix array
+                sdsl::construct(pn_csa, path_name_file, config, 1);
+            }
+        });
+        paths.resize(path_handles.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+        for (uint64_t k = 0; k < path_handles.size(); ++k) {
+            const path_handle_t &path = path_handles[k];
             std::vector<handle_t> p;
+            std::vector<std::pair<uint64_t, std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>>> node_paths;
             uint64_t handle_rank_in_path = 0;
             graph.for_each_step_in_path(path, [&](const step_handle_t &occ) {
                 handle_t h = graph.get_handle_of_step(occ);
                 uint64_t step_rank = as_integers(occ)[1];
                 p.push_back(h);
-                uint64_t hl = graph.get_length(h);
                 ++handle_rank_in_path; // handle ranks in path are 1-based
-                size_t node_id = graph.get_id(h);
-                node_path_ms.append(node_id, std::make_tuple(node_id, step_rank, as_integer(path), handle_rank_in_path));
-                np_size++;
+                if (in_memory) {
+                    // every step has its own slot, so paths can fill them concurrently
+                    const uint64_t i = np_offsets[graph.get_id(h) - 1] + step_rank;
+                    nr_iv[i] = handle_rank_in_path;
+                    npi_iv[i] = as_integer(path);
+                } else {
+                    size_t node_id = graph.get_id(h);
+                    node_paths.push_back(std::make_pair(node_id, std::make_tuple(node_id, step_rank, as_integer(path), handle_rank_in_path)));
+                }
             });
-            std::string path_name = graph.get_path_name(path);
-            // std::cout << "[XP CONSTRUCTION]: Indexing path: " << path_name << std::endl;
-            XPPath *path_index = new XPPath(path_name, p, false, graph);
-            // Add path_index to paths.
-            paths.push_back(path_index);
-            path_names += start_marker + path_name + end_marker;
-        });
+            if (!in_memory) {
+#pragma omp critical (xp_node_path_ms)
+                for (auto &node_path : node_paths) {
+                    node_path_ms->append(node_path.first, node_path.second);
+                }
+            }
+            paths[k] = new XPPath(graph.get_path_name(path), p, false, graph);
+        }
+        pn_csa_builder.join();
         // assign the position map iv
         sdsl::util::assign(pos_map_iv, sdsl::enc_vector<>(position_map));
         // set the path counts
@@ -99,38 +171,43 @@ namespace xp {
         // handle path names
         sdsl::util::assign(pn_iv, sdsl::int_vector<>(path_names.size()));
         sdsl::util::assign(pn_bv, sdsl::bit_vector(path_names.size()));
-        // now record path name starts
+        // now record path name starts, which are the start markers not inside a PanSN name
         for (size_t i = 0; i < path_names.size(); ++i) {
             pn_iv[i] = path_names[i];
-            if (path_names[i] == start_marker) {
+            if (path_names[i] == start_marker && (i == 0 || path_names[i - 1] == end_marker)) {
                 pn_bv[i] = 1; // register name start
             }
         }
         sdsl::util::assign(pn_bv_rank, sdsl::rank_support_v<1>(&pn_bv));
         sdsl::util::assign(pn_bv_select, sdsl::bit_vector::select_1_type(&pn_bv));
 
-        // write path names to temp file
-        std::string path_name_file = basename + ".pathnames.iv";
-        sdsl::store_to_file((const char *) path_names.c_str(), path_name_file);
-        // read file and construct compressed suffix array
-
-        sdsl::construct(pn_csa, path_name_file, config, 1);
-        // we need to take care of the node->path vectors
-        node_path_ms.index(nthreads, graph.get_node_count() + 1);
-        sdsl::util::assign(nr_iv, sdsl::int_vector<>(np_size));
-        sdsl::util::assign(np_bv, sdsl::bit_vector(np_size));
-        sdsl::util::assign(npi_iv, sdsl::int_vector<>(np_size));
-        // fill the node->path vectors
-        uint64_t  np_offset = 0;
-        for (int64_t i = 0; i < graph.get_node_count(); i++) {
-            np_bv[np_offset] = 1; // mark node start
-            uint64_t has_steps = false;
-            node_path_ms.for_values_of(i+1, [&](const std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>& v) {
-                nr_iv[np_offset] = std::get<3>(v); // handle_rank_of_path
-                npi_iv[np_offset] = std::get<2>(v); // path id
-                has_steps = true;
-                np_offset++;
-            });
+        if (in_memory) {
+            sdsl::util::assign(np_bv, sdsl::bit_vector(np_size));
+            for (uint64_t i = 0; i < id_slots; ++i) {
+                if (np_offsets[i] < np_size) {
+                    np_bv[np_offsets[i]] = 1; // mark node start
+                }
+            }
+        } else {
+            // we need to take care of the node->path vectors
+            node_path_ms->index(nthreads, id_slots + 1);
+            sdsl::util::assign(nr_iv, sdsl::int_vector<>(np_size));
+            sdsl::util::assign(np_bv, sdsl::bit_vector(np_size));
+            sdsl::util::assign(npi_iv, sdsl::int_vector<>(np_size));
+            // fill the node->path vectors
+            uint64_t  np_offset = 0;
+            for (uint64_t i = 0; i < id_slots; i++) {
+                if (np_offset < np_size) {
+                    np_bv[np_offset] = 1; // mark node start
+                }
+                uint64_t has_steps = false;
+                node_path_ms->for_values_of(i+1, [&](const std::tuple<uint64_t, uint64_t, uint64_t, uint64_t>& v) {
+                    nr_iv[np_offset] = std::get<3>(v); // handle_rank_of_path
+                    npi_iv[np_offset] = std::get<2>(v); // path id
+                    has_steps = true;
+                    np_offset++;
+                });
+            }
         }
         sdsl::util::bit_compress(nr_iv);
         sdsl::util::bit_compress(npi_iv);
@@ -154,13 +231,18 @@ namespace xp {
         */
         std::cerr << std::endl;
 #endif
-        // node_path_ms.reset(); // free the mmmultimap
-        std::remove(node_path_idx.c_str());
-        std::remove(path_name_file.c_str());
+        if (!in_memory) {
+            node_path_ms.reset(); // free the mmmultimap
+            std::remove(node_path_idx.c_str());
+            std::remove(path_name_file.c_str());
+        }
         // delete node_path_ms;
     }
 
     std::vector<XPPath *> XP::get_paths() const {
+        for (uint64_t i = 0; i < paths.size(); ++i) {
+            path_at(i);
+        }
         return this->paths;
     }
 
@@ -186,9 +268,10 @@ namespace xp {
         sdsl::structure_tree_node *child = sdsl::structure_tree::add_child(s, name, sdsl::util::class_name(*this));
         size_t written = 0;
 
-        // Do the magic number
-        out << "XP";
+        // Do the magic number, of the layout with a path offset table
+        out.write(lazy_magic, 2);
         written += 2;
+        written += sdsl::write_member(lazy_layout_version, out, child, "layout_version");
 
         // POSITION MAP STUFF
         written += pos_map_iv.serialize(out, child, "position_map");
@@ -206,12 +289,22 @@ namespace xp {
         paths_written += pn_bv_select.serialize(out, paths_child, "path_names_starts_select");
         paths_written += pi_iv.serialize(out, paths_child, "path_ids");
 
+        // the offset table gives where each path starts, relative to the first,
+        // and then where the node->path vectors start
+        std::vector<uint64_t> offsets(paths.size() + 1, 0);
+        for (size_t i = 0; i < paths.size(); i++) {
+            null_buffer_t null_buffer;
+            std::ostream null_out(&null_buffer);
+            offsets[i + 1] = offsets[i] + path_at(i).serialize(null_out);
+        }
+        out.write((char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+        paths_written += offsets.size() * sizeof(uint64_t);
         for (size_t i = 0; i < paths.size(); i++) {
-            XPPath *path = paths[i];
-            paths_written += path->serialize(out, paths_child,
-                                             "path:" + XP::get_path_name(handlegraph::as_path_handle(i + 1)));
+            paths_written += path_at(i).serialize(out, paths_child,
+                                                  "path:" + XP::get_path_name(handlegraph::as_path_handle(i + 1)));
         }
 
+        load_node_paths();
         paths_written += np_bv.serialize(out, paths_child, "node_path_mapping_starts");
         // paths_written += np_bv_rank.serialize(out, paths_child, "node_path_mapping_sarts_rank");
         // paths_written += np_bv_select.serialize(out, paths_child, "node_path_mapping_starts_select");
@@ -231,12 +324,15 @@ namespace xp {
     }
 
     void XP::load(std::istream &in) {
+        // drop whatever index was loaded before
+        clean();
 
         if (!in.good()) {
             throw XPFormatError("Index file does not exist or index stream cannot be read");
         }
 
         // We need to look for the magic value
+        bool has_offsets = false;
         char buffer;
         in.get(buffer);
         if (buffer == 'X') {
@@ -244,6 +340,9 @@ namespace xp {
             if (buffer == 'P') {
                 // We found the magic value!
 
+            } else if (buffer == lazy_magic[1]) {
+                // We found the magic value of the layout with path offsets
+                has_offsets = true;
             } else {
                 // Put back both characters
                 in.unget();
@@ -255,6 +354,14 @@ namespace xp {
         }
 
         try {
+            if (has_offsets) {
+                uint64_t version = 0;
+                sdsl::read_member(version, in);
+                if (version > lazy_layout_version) {
+                    throw XPFormatError("XP index was written in layout version " + std::to_string(version)
+                                        + ", but this odgi only reads up to version " + std::to_string(lazy_layout_version));
+                }
+            }
             pos_map_iv.load(in);
             sdsl::read_member(path_count, in);
             pn_iv.load(in);
@@ -263,6 +370,11 @@ namespace xp {
             pn_bv_rank.load(in, &pn_bv);
             pn_bv_select.load(in, &pn_bv);
             pi_iv.load(in);
+            if (has_offsets) {
+                // we read the paths in order, so we don't need their offsets
+                std::vector<uint64_t> offsets(path_count + 1);
+                in.read((char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+            }
 
             for (size_t i = 0; i < path_count; ++i) {
                 auto path = new XPPath;
@@ -309,6 +421,104 @@ namespace xp {
         }
     }
 
+    void XP::load(const std::string &filename) {
+        // drop whatever index was loaded before
+        clean();
+        int fd = open(filename.c_str(), O_RDONLY);
+        if (fd == -1) {
+            throw XPFormatError("Index file " + filename + " does not exist or cannot be read");
+        }
+        struct stat st;
+        fstat(fd, &st);
+        mapped_size = st.st_size;
+        if (mapped_size < 2) {
+            close(fd);
+            throw XPFormatError("Index file " + filename + " is too short to be an XP index");
+        }
+        void* buf = mmap(nullptr, mapped_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (buf == MAP_FAILED) {
+            mapped_size = 0;
+            throw XPFormatError("Index file " + filename + " cannot be mapped");
+        }
+        mapped = (char*)buf;
+        if (mapped[0] != lazy_magic[0] || mapped[1] != lazy_magic[1]) {
+            // an older index, without path offsets, has to be loaded whole
+            unmap();
+            std::ifstream in(filename);
+            load(in);
+            return;
+        }
+        // queries usually look at a few paths, so we don't want the kernel to read ahead
+        madvise(mapped, mapped_size, MADV_RANDOM);
+        memory_buffer_t buffer(mapped + 2, mapped_size - 2);
+        std::istream in(&buffer);
+        uint64_t version = 0;
+        sdsl::read_member(version, in);
+        if (version > lazy_layout_version) {
+            unmap();
+            throw XPFormatError("XP index was written in layout version " + std::to_string(version)
+                                + ", but this odgi only reads up to version " + std::to_string(lazy_layout_version));
+        }
+        pos_map_iv.load(in);
+        sdsl::read_member(path_count, in);
+        pn_iv.load(in);
+        pn_csa.load(in);
+        pn_bv.load(in);
+        pn_bv_rank.load(in, &pn_bv);
+        pn_bv_select.load(in, &pn_bv);
+        pi_iv.load(in);
+        path_offsets.resize(path_count + 1);
+        in.read((char*)path_offsets.data(), path_offsets.size() * sizeof(uint64_t));
+        if (!in.good()) {
+            unmap();
+            throw XPFormatError("Index file " + filename + " is truncated");
+        }
+        const uint64_t first_path = 2 + buffer.position();
+        for (auto& offset : path_offsets) {
+            offset += first_path;
+        }
+        paths.assign(path_count, nullptr);
+        path_loaded = std::make_unique<std::once_flag[]>(path_count);
+        node_paths_loaded = std::make_unique<std::once_flag>();
+    }
+
+    const XPPath& XP::path_at(const uint64_t& rank) const {
+        if (path_loaded) {
+            std::call_once(path_loaded[rank], [&]() {
+                memory_buffer_t buffer(mapped + path_offsets[rank], path_offsets[rank + 1] - path_offsets[rank]);
+                std::istream in(&buffer);
+                auto path = new XPPath;
+                path->load(in);
+                paths[rank] = path;
+            });
+        }
+        return *paths[rank];
+    }
+
+    void XP::load_node_paths() const {
+        if (node_paths_loaded) {
+            std::call_once(*node_paths_loaded, [&]() {
+                memory_buffer_t buffer(mapped + path_offsets.back(), mapped_size - path_offsets.back());
+                std::istream in(&buffer);
+                np_bv.load(in);
+                nr_iv.load(in);
+                npi_iv.load(in);
+            });
+        }
+    }
+
+    void XP::unmap() {
+        if (mapped != nullptr) {
+            munmap(mapped, mapped_size);
+        }
+        mapped = nullptr;
+        mapped_size = 0;
+        path_offsets.clear();
+        path_loaded.reset();
+        node_paths_loaded.reset();
+    }
+
     void XP::clean() {
         // Clean up any created XPPaths
         while (!paths.empty()) {
@@ -316,17 +526,11 @@ namespace xp {
             paths.pop_back();
         }
         path_count = 0;
+        unmap();
     }
 
     bool XP::has_path(const std::string& path_name) const {
-        // find the name in the csa
-        std::string query = start_marker + path_name + end_marker;
-        auto occs = locate(pn_csa, query);
-        if (occs.size() > 1) {
-            std::cerr << "error [xp]: multiple hits for " << query << std::endl;
-            exit(1);
-        }
-        return !(occs.size() == 0);
+        return as_integer(get_path_handle(path_name)) != 0;
     }
 
     bool XP::has_position(const std::string& path_name, size_t nuc_pos) const {
@@ -339,27 +543,49 @@ namespace xp {
     }
 
     path_handle_t XP::get_path_handle(const std::string& path_name) const {
+        try {
+            return find_path_handle(path_name);
+        } catch (const XPQueryError& e) {
+            std::cerr << e.what() << std::endl;
+            exit(1);
+        }
+    }
+
+    path_handle_t XP::find_path_handle(const std::string& path_name) const {
+        // a name holding the end marker could only match across two names
+        if (path_name.find(end_marker) != std::string::npos) {
+            return as_path_handle(0);
+        }
         // find the name in the csa
         std::string query = start_marker + path_name + end_marker;
         auto occs = locate(pn_csa, query);
-        if (occs.size() > 1) {
-            std::cerr << "error [xp]: multiple hits for " << query << std::endl;
-            exit(1);
+        // PanSN names hold the start marker, so a name can also match the end of a longer one,
+        // and only matches at the start of a name count
+        uint64_t hits = 0;
+        size_t hit = 0;
+        for (size_t i = 0; i < occs.size(); ++i) {
+            if (occs[i] == 0 || pn_iv[occs[i] - 1] == (uint64_t)end_marker) {
+                ++hits;
+                hit = occs[i];
+            }
         }
-        if(occs.size() == 0) {
+        if (hits == 0) {
             // This path does not exist. Give back 0, which can never be a real path
             // rank.
             return as_path_handle(0);
         }
-        return as_path_handle(pn_bv_rank(occs[0])+1); // step past '#'
+        if (hits > 1) {
+            throw XPQueryError("error [xp]: multiple hits for " + query);
+        }
+        return as_path_handle(pn_bv_rank(hit)+1); // step past '#'
     }
 
     size_t XP::get_path_length(const path_handle_t& path_handle) const {
-        return paths[as_integer(path_handle) - 1]->offsets.size();
+        return path_at(as_integer(path_handle) - 1).offsets.size();
     }
 
     size_t XP::get_path_step_count(const handlegraph::path_handle_t& path_handle) const {
-        return paths[as_integer(path_handle) - 1]->handles.size();
+        return path_at(as_integer(path_handle) - 1).handles.size();
     }
 
     /// Get the step at a given position
@@ -369,7 +595,7 @@ namespace xp {
                                 get_path_name(path) + " of length " + std::to_string(get_path_length(path)));
         }
 
-        const auto& xppath = *paths[as_integer(path) - 1];
+        const auto& xppath = path_at(as_integer(path) - 1);
         step_handle_t step;
         as_integers(step)[0] = as_integer(path);
         as_integers(step)[1] = xppath.step_rank_at_position(position);
@@ -377,7 +603,7 @@ namespace xp {
     }
 
     size_t XP::get_position_of_step(const step_handle_t& step_handle) const {
-        const auto& xppath = *paths[as_integer(get_path_handle_of_step(step_handle)) - 1];
+        const auto& xppath = path_at(as_integer(get_path_handle_of_step(step_handle)) - 1);
         auto& step_rank = as_integers(step_handle)[1];
         return xppath.positions[step_rank];
     }
@@ -387,13 +613,13 @@ namespace xp {
     }
 
     handle_t XP::get_handle_of_step(const step_handle_t& step_handle) const {
-        const auto& xppath = *paths[as_integer(get_path_handle_of_step(step_handle)) - 1];
+        const auto& xppath = path_at(as_integer(get_path_handle_of_step(step_handle)) - 1);
         return xppath.handle(as_integers(step_handle)[1]);
     }
 
     const XPPath& XP::get_path(const std::string &name) const {
         handlegraph::path_handle_t p_h = get_path_handle(name);
-        return *paths[as_integer(p_h) - 1];
+        return path_at(as_integer(p_h) - 1);
     }
 
     const sdsl::enc_vector<>& XP::get_pos_map_iv() const {
@@ -405,6 +631,7 @@ namespace xp {
     }
 
     const sdsl::int_vector<>& XP::get_nr_iv() const {
+        load_node_paths();
         return nr_iv;
     }
 /*
@@ -414,10 +641,12 @@ namespace xp {
 */
 
     const sdsl::bit_vector XP::get_np_bv() const {
+        load_node_paths();
         return np_bv;
     }
 
     const sdsl::int_vector<>& XP::get_npi_iv() const {
+        load_node_paths();
         return npi_iv;
     }
 /*
@@ -441,10 +670,14 @@ namespace xp {
             std::cerr << "[XP] error: The given path name " << path_name << " is not in the index." << std::endl;
             exit(1);
         }
-        const XPPath& xppath = get_path(path_name);
+        return get_pangenome_pos(p_h, nuc_pos);
+    }
+
+    size_t XP::get_pangenome_pos(const handlegraph::path_handle_t &p_h, const size_t &nuc_pos) const {
+        const XPPath& xppath = path_at(as_integer(p_h) - 1);
         // Is the nucleotide position there?!
         if (xppath.offsets.size() <= nuc_pos) {
-            std::cerr << "[XP] error: The given path " << path_name << " with nucleotide position " << nuc_pos << " is not in the index." << std::endl;
+            std::cerr << "[XP] error: The given path " << get_path_name(p_h) << " with nucleotide position " << nuc_pos << " is not in the index." << std::endl;
             exit(1);
         }
 
@@ -682,6 +915,22 @@ namespace xp {
         return as_handle(as_integer(handle)+as_integer(min_handle));
     }
 
+    namespace {
+        // 0 until it is set or first asked for
+        std::atomic<uint64_t> memory_budget(0);
+    }
+
+    void set_memory_budget(const uint64_t& bytes) {
+        memory_budget.store(bytes);
+    }
+
+    uint64_t get_memory_budget() {
+        if (memory_budget.load() == 0) {
+            memory_budget.store((uint64_t)sysconf(_SC_PHYS_PAGES) * (uint64_t)sysconf(_SC_PAGE_SIZE) / 4);
+        }
+        return memory_budget.load();
+    }
+
     namespace temp_file {
 
 // We use this to make the API thread-safe
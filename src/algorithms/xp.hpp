@@ -17,6 +17,13 @@
 #include "mmmultimap.hpp"
 #include "odgi.hpp"
 #include "mutex"
+#include <atomic>
+#include <memory>
+#include <unistd.h>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 
 namespace xp {
 
@@ -72,10 +79,17 @@ namespace xp {
         /// helper to builder
         void from_handle_graph_impl(odgi::graph_t &graph, const std::string& basename, const uint64_t& nthreads);
 
-        /// Load this XP index from a stream. Throw an XPFormatError if the stream
-        /// does not produce a valid XP file.
+        /// Load this XP index from a stream, replacing any index loaded before.
+        /// Throw an XPFormatError if the stream does not produce a valid XP file.
         void load(std::istream &in);
 
+        /// Load this XP index from a file, which is memory-mapped. Indexes written
+        /// with a path offset table only load each path, and the node->path
+        /// vectors, when first used, and processes mapping the same file share
+        /// its pages through the page cache. Older indexes are loaded whole.
+        /// Any index loaded before is replaced.
+        void load(const std::string &filename);
+
         /// Alias for load() to match the SerializableHandleGraph interface.
         void deserialize_members(std::istream &in);
 
@@ -95,8 +109,13 @@ namespace xp {
         bool has_position(const std::string& path_name, size_t nuc_pos) const;
 
         /// Look up the path handle for the given path name
+        /// Will exit with (1) if several paths match the name.
         handlegraph::path_handle_t get_path_handle(const std::string &path_name) const;
 
+        /// Look up the path handle for the given path name, or 0 if it is not in the index
+        /// Throws XPQueryError if several paths match the name, so servers can refuse the query.
+        handlegraph::path_handle_t find_path_handle(const std::string &path_name) const;
+
         /// Get a node handle (node ID and orientation) from a handle to a step on a path
         handlegraph::handle_t get_handle_of_step(const handlegraph::step_handle_t& step_handle) const;
 
@@ -125,6 +144,10 @@ namespace xp {
         /// Will exit with (1) given position is not in the given path.
         size_t get_pangenome_pos(const std::string &path_name, const size_t &nuc_pos) const;
 
+        /// Look up the pangenome position by path handle, for callers that resolved the name once
+        /// 0-base positioning!
+        size_t get_pangenome_pos(const handlegraph::path_handle_t &p_h, const size_t &nuc_pos) const;
+
         /// Get the path of the given path name
         const XPPath& get_path(const std::string& name) const;
 
@@ -147,7 +170,29 @@ namespace xp {
         char start_marker = '#';
         char end_marker = '$';
 
+        /// Magic number of indexes written with a path offset table
+        static constexpr char lazy_magic[2] = {'X', 'L'};
+        /// Version of the layout with a path offset table
+        static constexpr uint64_t lazy_layout_version = 1;
+
     private:
+        /// Get a path by rank, first loading it from the mapped file if needed
+        const XPPath& path_at(const uint64_t& rank) const;
+
+        /// Load the node->path vectors from the mapped file if needed
+        void load_node_paths() const;
+
+        /// Forget the file we were mapped from, if any
+        void unmap();
+
+        // the file we were mapped from, with where each path starts followed by
+        // where the node->path vectors start
+        char* mapped = nullptr;
+        size_t mapped_size = 0;
+        std::vector<uint64_t> path_offsets;
+        std::unique_ptr<std::once_flag[]> path_loaded;
+        std::unique_ptr<std::once_flag> node_paths_loaded;
+
         ////////////////////////////////////////////////////////////////////////////
         // Here is path storage
         ////////////////////////////////////////////////////////////////////////////
@@ -162,14 +207,14 @@ namespace xp {
 
         sdsl::enc_vector<> pos_map_iv; // store each offset of each node in the sequence vector
 
-        std::vector<XPPath *> paths; // path structure
+        mutable std::vector<XPPath *> paths; // path structure, null until loaded when mapped
 
         // node->path rank
-        sdsl::int_vector<> nr_iv; // rank of step in path
+        mutable sdsl::int_vector<> nr_iv; // rank of step in path
         // path integer
-        sdsl::int_vector<> npi_iv; // path integers to directly construct path handles from
+        mutable sdsl::int_vector<> npi_iv; // path integers to directly construct path handles from
         // entity delimiter
-        sdsl::bit_vector np_bv;
+        mutable sdsl::bit_vector np_bv;
         // sdsl::bit_vector::rank_1_type np_bv_rank;
         sdsl::bit_vector::select_1_type np_bv_select;
     };
@@ -222,6 +267,14 @@ namespace xp {
         handlegraph::handle_t handle(size_t offset) const;
     };
 
+    /// Set the most memory, in bytes, that XP::from_handle_graph may use to build
+    /// its node to path vectors in memory instead of through temporary files.
+    /// A budget of 0 resets it to the default.
+    void set_memory_budget(const uint64_t& bytes);
+
+    /// Get the memory budget for building in memory, by default a quarter of the physical memory
+    uint64_t get_memory_budget();
+
     /**
  * Temporary files. Create with create() and remove with remove(). All
  * temporary files will be deleted when the program exits normally or with
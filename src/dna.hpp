@@ -2,6 +2,9 @@
 #define dank_dna_hpp
 
 #include <string>
+#ifdef __SSSE3__
+#include <immintrin.h>
+#endif
 
 namespace odgi {
 
@@ -42,28 +45,96 @@ inline char reverse_complement(const char& c) {
     return complement[c];
 }
 
-inline std::string reverse_complement(const std::string& seq) {
-    std::string rc;
-    rc.assign(seq.rbegin(), seq.rend());
-    for (auto& c : rc) {
-        c = complement[c];
+#ifdef __SSSE3__
+/// Reverse complement 16 bases at once. Returns false, leaving rc undefined,
+/// if any of them is not one of ACGTN (in either case), which the caller
+/// then has to handle with the complement table.
+inline bool reverse_complement_16(const __m128i& v, __m128i& rc) {
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    const __m128i upper = _mm_andnot_si128(case_bit, v);
+    const __m128i valid = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(upper, _mm_set1_epi8('A')),
+                     _mm_cmpeq_epi8(upper, _mm_set1_epi8('C'))),
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(upper, _mm_set1_epi8('G')),
+                                  _mm_cmpeq_epi8(upper, _mm_set1_epi8('T'))),
+                     _mm_cmpeq_epi8(upper, _mm_set1_epi8('N'))));
+    if (_mm_movemask_epi8(valid) != 0xFFFF) {
+        return false;
     }
+    // A, C, G, T and N differ in their low nibble, which indexes the complement
+    const __m128i table = _mm_setr_epi8(0, 'T', 0, 'G', 'A', 0, 0, 'C',
+                                        0, 0, 0, 0, 0, 0, 'N', 0);
+    const __m128i comp = _mm_or_si128(
+        _mm_shuffle_epi8(table, _mm_and_si128(upper, _mm_set1_epi8(0x0F))),
+        _mm_and_si128(v, case_bit));
+    rc = _mm_shuffle_epi8(comp, _mm_setr_epi8(15, 14, 13, 12, 11, 10, 9, 8,
+                                              7, 6, 5, 4, 3, 2, 1, 0));
+    return true;
+}
+#endif
+
+/// Write the reverse complement of seq[0, len) to out, which must not overlap seq
+inline void reverse_complement(const char* seq, size_t len, char* out) {
+    size_t i = 0;
+#ifdef __SSSE3__
+    for ( ; i + 16 <= len; i += 16) {
+        __m128i rc;
+        if (reverse_complement_16(_mm_loadu_si128((const __m128i*)(seq + len - i - 16)), rc)) {
+            _mm_storeu_si128((__m128i*)(out + i), rc);
+        } else {
+            for (size_t j = i; j < i + 16; ++j) {
+                out[j] = complement[seq[len - j - 1]];
+            }
+        }
+    }
+#endif
+    for ( ; i < len; ++i) {
+        out[i] = complement[seq[len - i - 1]];
+    }
+}
+
+inline std::string reverse_complement(const std::string& seq) {
+    std::string rc(seq.size(), '\0');
+    reverse_complement(seq.data(), seq.size(), &rc[0]);
     return rc;
 }
     
-inline void reverse_complement_in_place(std::string& seq) {
-    size_t swap_size = seq.size() / 2;
-    for (size_t i = 0, j = seq.size() - 1; i < swap_size; i++, j--) {
+inline void reverse_complement_in_place(char* seq, size_t len) {
+    size_t swap_size = len / 2;
+    size_t i = 0, j = len - 1;
+#ifdef __SSSE3__
+    // swap 16 bases from each end at a time while the blocks don't overlap
+    for ( ; i + 16 <= swap_size; i += 16, j -= 16) {
+        __m128i front = _mm_loadu_si128((const __m128i*)(&seq[i]));
+        __m128i back = _mm_loadu_si128((const __m128i*)(&seq[j - 15]));
+        __m128i front_rc, back_rc;
+        if (reverse_complement_16(front, front_rc) && reverse_complement_16(back, back_rc)) {
+            _mm_storeu_si128((__m128i*)(&seq[i]), back_rc);
+            _mm_storeu_si128((__m128i*)(&seq[j - 15]), front_rc);
+        } else {
+            for (size_t k = 0; k < 16; ++k) {
+                char tmp = seq[i + k];
+                seq[i + k] = complement[seq[j - k]];
+                seq[j - k] = complement[tmp];
+            }
+        }
+    }
+#endif
+    for ( ; i < swap_size; i++, j--) {
         char tmp = seq[i];
         seq[i] = complement[seq[j]];
         seq[j] = complement[tmp];
     }
     
-    if (seq.size() % 2) {
+    if (len % 2) {
         seq[swap_size] = complement[seq[swap_size]];
     }
 }
 
+inline void reverse_complement_in_place(std::string& seq) {
+    reverse_complement_in_place(&seq[0], seq.size());
+}
+
 inline int dna_as_int(char c) {
     switch (c) {
     case 'A':
@@ -0,0 +1,184 @@
+#include "external_steps.hpp"
+
+#include <cstdio>
+#include <stdexcept>
+#include <omp.h>
+
+namespace odgi {
+
+namespace {
+
+/// Records gathered by a thread before they are appended to a multimap
+const uint64_t append_batch_size = 1 << 16;
+/// Node ids or path ids handled by a thread at a time
+const uint64_t key_block_size = 1 << 12;
+
+/// Append a batch of records to a multimap, which only takes one writer at a time
+template<typename Value>
+void append_batch(mmmulti::map<uint64_t, Value>& map, std::vector<std::pair<uint64_t, Value>>& batch) {
+#pragma omp critical (external_steps_append)
+    {
+        for (auto& kv : batch) {
+            map.append(kv.first, kv.second);
+        }
+    }
+    batch.clear();
+}
+
+}
+
+external_steps_t::external_steps_t(const std::string& base, uint64_t num_threads)
+    : staged_file(base + ".staged_steps.mm"),
+      ranked_file(base + ".ranked_steps.mm"),
+      records_file(base + ".step_records.mm"),
+      num_threads(std::max(num_threads, (uint64_t)1)) {
+    staged = std::make_unique<mmmulti::map<uint64_t, staged_step_t>>(staged_file, staged_step_t(0, 0, 0));
+    staged->open_writer();
+}
+
+external_steps_t::~external_steps_t(void) {
+    staged.reset();
+    ranked.reset();
+    records.reset();
+    std::remove(staged_file.c_str());
+    std::remove(ranked_file.c_str());
+    std::remove(records_file.c_str());
+}
+
+void external_steps_t::add_path(const HandleGraph& graph, const path_handle_t& path, const std::vector<handle_t>& path_steps) {
+    const uint64_t path_id = as_integer(path);
+    std::vector<std::pair<uint64_t, staged_step_t>> batch;
+    batch.reserve(path_steps.size());
+    uint64_t max_id = 0;
+    for (uint64_t i = 0; i < path_steps.size(); ++i) {
+        const uint64_t id = graph.get_id(path_steps[i]);
+        max_id = std::max(max_id, id);
+        batch.push_back(std::make_pair(id, staged_step_t(path_id, i, graph.get_is_reverse(path_steps[i]))));
+    }
+    std::lock_guard<std::mutex> guard(staging_mutex);
+    if (indexed) {
+        throw std::runtime_error("[odgi::external_steps_t] error: paths can't be staged once the steps are indexed");
+    }
+    for (auto& kv : batch) {
+        staged->append(kv.first, kv.second);
+    }
+    max_node_id = std::max(max_node_id, max_id);
+    max_path_id = std::max(max_path_id, path_id);
+    if (lengths.size() <= path_id) {
+        lengths.resize(path_id + 1, 0);
+    }
+    lengths[path_id] = path_steps.size();
+    steps += path_steps.size();
+}
+
+void external_steps_t::index(void) {
+    indexed = true;
+    fronts.resize(max_path_id + 1);
+    backs.resize(max_path_id + 1);
+    lengths.resize(max_path_id + 1, 0);
+    // sort the staged steps by node: a step's rank on its node is its place among them
+    staged->index(num_threads, max_node_id + 1);
+    ranked = std::make_unique<mmmulti::map<uint64_t, ranked_step_t>>(ranked_file, ranked_step_t(0, 0, 0));
+    ranked->open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (uint64_t first = 1; first <= max_node_id; first += key_block_size) {
+        std::vector<std::pair<uint64_t, ranked_step_t>> batch;
+        const uint64_t last = std::min(max_node_id + 1, first + key_block_size);
+        for (uint64_t id = first; id < last; ++id) {
+            uint64_t rank = 0;
+            staged->for_values_of(id, [&](const staged_step_t& v) {
+                    batch.push_back(std::make_pair(std::get<0>(v),
+                                                   ranked_step_t(std::get<1>(v), id, (rank << 1) | std::get<2>(v))));
+                    ++rank;
+                });
+            if (batch.size() >= append_batch_size) {
+                append_batch(*ranked, batch);
+            }
+        }
+        append_batch(*ranked, batch);
+    }
+    staged.reset();
+    std::remove(staged_file.c_str());
+    // sort them into path order, so that each step meets its neighbours
+    ranked->index(num_threads, max_path_id + 1);
+    records = std::make_unique<mmmulti::map<uint64_t, step_record_t>>(records_file, step_record_t(0, 0, 0, 0, 0, 0, 0));
+    records->open_writer();
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (uint64_t first = 1; first <= max_path_id; first += key_block_size) {
+        std::vector<std::pair<uint64_t, step_record_t>> batch;
+        const uint64_t last = std::min(max_path_id + 1, first + key_block_size);
+        for (uint64_t path_id = first; path_id < last; ++path_id) {
+            // each step is written once we have seen the step after it
+            auto write_step = [&](const ranked_step_t& step, const ranked_step_t* prev, const ranked_step_t* next) {
+                const uint64_t flags = (std::get<2>(step) & 1) | ((prev == nullptr) << 1) | ((next == nullptr) << 2);
+                batch.push_back(std::make_pair(std::get<1>(step),
+                                               step_record_t(std::get<2>(step) >> 1, path_id, flags,
+                                                             prev ? std::get<1>(*prev) : 0,
+                                                             prev ? std::get<2>(*prev) >> 1 : 0,
+                                                             next ? std::get<1>(*next) : 0,
+                                                             next ? std::get<2>(*next) >> 1 : 0)));
+            };
+            ranked_step_t prev, curr;
+            uint64_t n = 0;
+            ranked->for_values_of(path_id, [&](const ranked_step_t& v) {
+                    if (n == 0) {
+                        fronts[path_id] = {(nid_t)std::get<1>(v), std::get<2>(v) >> 1, (bool)(std::get<2>(v) & 1)};
+                    } else {
+                        write_step(curr, n > 1 ? &prev : nullptr, &v);
+                    }
+                    prev = curr;
+                    curr = v;
+                    ++n;
+                });
+            if (n > 0) {
+                write_step(curr, n > 1 ? &prev : nullptr, nullptr);
+                backs[path_id] = {(nid_t)std::get<1>(curr), std::get<2>(curr) >> 1, (bool)(std::get<2>(curr) & 1)};
+            }
+            if (batch.size() >= append_batch_size) {
+                append_batch(*records, batch);
+            }
+        }
+        append_batch(*records, batch);
+    }
+    ranked.reset();
+    std::remove(ranked_file.c_str());
+    // and finally back into node order, by rank within each node
+    records->index(num_threads, max_node_id + 1);
+}
+
+void external_steps_t::for_each_step_of_node(const nid_t& id, const std::function<void(const node_t::step_t&)>& func) const {
+    if (!indexed || (uint64_t)id > max_node_id) {
+        return;
+    }
+    records->for_values_of(id, [&](const step_record_t& v) {
+            node_t::step_t step;
+            step.path_id = std::get<1>(v);
+            step.is_rev = std::get<2>(v) & 1;
+            step.is_start = std::get<2>(v) & 2;
+            step.is_end = std::get<2>(v) & 4;
+            step.prev_id = std::get<3>(v);
+            step.prev_rank = std::get<4>(v);
+            step.next_id = std::get<5>(v);
+            step.next_rank = std::get<6>(v);
+            func(step);
+        });
+}
+
+uint64_t external_steps_t::path_length(const path_handle_t& path) const {
+    const uint64_t path_id = as_integer(path);
+    return path_id < lengths.size() ? lengths[path_id] : 0;
+}
+
+const external_steps_t::step_ref_t& external_steps_t::path_front(const path_handle_t& path) const {
+    return fronts.at(as_integer(path));
+}
+
+const external_steps_t::step_ref_t& external_steps_t::path_back(const path_handle_t& path) const {
+    return backs.at(as_integer(path));
+}
+
+uint64_t external_steps_t::step_count(void) const {
+    return steps;
+}
+
+}
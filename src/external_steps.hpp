@@ -0,0 +1,97 @@
+//
+//  odgi
+//
+//  external_steps.hpp
+//
+//  path steps staged on disk for building graphs larger than memory
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <tuple>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <handlegraph/types.hpp>
+#include <handlegraph/handle_graph.hpp>
+#include "mmmultimap.hpp"
+#include "node.hpp"
+
+namespace odgi {
+
+using namespace handlegraph;
+
+/// Path steps kept in memory-mapped multimaps on disk rather than in the nodes.
+/// Each path is staged as the node id and orientation of its steps. index()
+/// then sorts the steps by node, which gives each step its rank on its node,
+/// sorts them back into path order to find the ranks of their neighbours, and
+/// sorts the finished step records by node once more. The records can then be
+/// read one node at a time, which is how graph_t::serialize_external writes a
+/// graph without ever holding all of its steps.
+class external_steps_t {
+public:
+    /// A step as the id and orientation of its node and its rank among the node's steps
+    struct step_ref_t {
+        nid_t id = 0;
+        uint64_t rank = 0;
+        bool is_rev = false;
+    };
+
+    /// Stage the steps in files whose names start with base
+    external_steps_t(const std::string& base, uint64_t num_threads);
+    ~external_steps_t(void);
+    external_steps_t(const external_steps_t& other) = delete;
+    external_steps_t& operator=(const external_steps_t& other) = delete;
+
+    /// Stage the steps of a path of the graph, in path order. Each path must be
+    /// staged once, but paths may be staged from several threads at once.
+    void add_path(const HandleGraph& graph, const path_handle_t& path, const std::vector<handle_t>& steps);
+
+    /// Work out every step's record once all paths have been staged
+    void index(void);
+
+    /// Call func with the step records of a node, in rank order
+    void for_each_step_of_node(const nid_t& id, const std::function<void(const node_t::step_t&)>& func) const;
+
+    /// Number of steps in the path
+    uint64_t path_length(const path_handle_t& path) const;
+
+    /// First step of a non-empty path
+    const step_ref_t& path_front(const path_handle_t& path) const;
+
+    /// Last step of a non-empty path
+    const step_ref_t& path_back(const path_handle_t& path) const;
+
+    /// Number of staged steps
+    uint64_t step_count(void) const;
+
+private:
+    /// node id -> (path id, step index in path, is reverse)
+    typedef std::tuple<uint64_t, uint64_t, uint64_t> staged_step_t;
+    /// path id -> (step index in path, node id, rank on node << 1 | is reverse)
+    typedef std::tuple<uint64_t, uint64_t, uint64_t> ranked_step_t;
+    /// node id -> (rank on node, path id, is_rev | is_start << 1 | is_end << 2,
+    ///             prev id, prev rank, next id, next rank)
+    typedef std::tuple<uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t, uint64_t> step_record_t;
+
+    std::string staged_file;
+    std::string ranked_file;
+    std::string records_file;
+    uint64_t num_threads;
+    std::unique_ptr<mmmulti::map<uint64_t, staged_step_t>> staged;
+    std::unique_ptr<mmmulti::map<uint64_t, ranked_step_t>> ranked;
+    std::unique_ptr<mmmulti::map<uint64_t, step_record_t>> records;
+    std::mutex staging_mutex;
+    uint64_t max_node_id = 0;
+    uint64_t max_path_id = 0;
+    uint64_t steps = 0;
+    bool indexed = false;
+    std::vector<uint64_t> lengths;
+    std::vector<step_ref_t> fronts;
+    std::vector<step_ref_t> backs;
+};
+
+}
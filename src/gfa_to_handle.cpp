@@ -1,196 +1,539 @@
 #include "gfa_to_handle.hpp"
+#include "odgi.hpp"
+#include "telemetry.hpp"
+#include "gzip_stream.hpp"
+#include "external_steps.hpp"
+
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <omp.h>
 
 namespace odgi {
 
-std::map<char, uint64_t> gfa_line_counts(const char* filename) {
+namespace {
+
+/// A segment, with its sequence left in the mapped file
+struct gfa_segment_t {
+    uint64_t id;
+    const char* seq;
+    uint64_t len;
+};
+
+/// A path or walk, with its steps left in the mapped file
+struct gfa_path_t {
+    std::string name;
+    const char* steps;
+    uint64_t steps_len;
+    /// steps are a W-line walk like >1<2>3 rather than a P-line list like 1+,2-,3+
+    bool is_walk;
+};
+
+/// A run of whole lines of the file and what the first pass found in it
+struct gfa_chunk_t {
+    const char* begin;
+    const char* end;
+    /// The lines themselves when they were decompressed rather than mapped
+    std::string text;
+    std::vector<gfa_segment_t> segments;
+    std::vector<gfa_path_t> paths;
+    bool has_links = false;
+    uint64_t min_id = std::numeric_limits<uint64_t>::max();
+    uint64_t max_id = 0;
+};
+
+/// Split the buffer into about n chunks of whole lines
+void split_lines(const char* buf, uint64_t size, uint64_t n, std::deque<gfa_chunk_t>& chunks) {
+    const char* end = buf + size;
+    const uint64_t target = std::max((uint64_t)1, size / n);
+    const char* p = buf;
+    while (p < end) {
+        const char* q = p + std::min(target, (uint64_t)(end - p));
+        if (q < end) {
+            const char* nl = (const char*)std::memchr(q, '\n', end - q);
+            q = (nl == nullptr ? end : nl + 1);
+        }
+        chunks.emplace_back();
+        chunks.back().begin = p;
+        chunks.back().end = q;
+        p = q;
+    }
+}
+
+/// Call the callback with each line of [begin, end), without its line terminator
+template<typename F>
+inline void for_each_line(const char* begin, const char* end, const F& callback) {
+    const char* p = begin;
+    while (p < end) {
+        const char* nl = (const char*)std::memchr(p, '\n', end - p);
+        const char* line_end = (nl == nullptr ? end : nl);
+        const char* e = line_end;
+        if (e > p && *(e - 1) == '\r') --e;
+        if (e > p) callback(p, e);
+        p = line_end + 1;
+    }
+}
+
+/// Find the tab separated fields of a line, up to max of them, returning how many were found
+inline uint64_t split_fields(const char* begin, const char* end,
+                             const char** field_begin, const char** field_end, uint64_t max) {
+    uint64_t n = 0;
+    const char* p = begin;
+    while (n < max) {
+        const char* t = (const char*)std::memchr(p, '\t', end - p);
+        field_begin[n] = p;
+        field_end[n] = (t == nullptr ? end : t);
+        ++n;
+        if (t == nullptr) break;
+        p = t + 1;
+    }
+    return n;
+}
+
+/// Parse a node id, returning false if the text is not a number
+inline bool parse_id(const char* begin, const char* end, uint64_t& id) {
+    if (begin == end) return false;
+    id = 0;
+    for (const char* p = begin; p < end; ++p) {
+        if (*p < '0' || *p > '9') return false;
+        id = id * 10 + (*p - '0');
+    }
+    return true;
+}
+
+/// The PanSN name of the path a W-line walk describes: sample#haplotype#contig,
+/// followed by :start-end if the walk doesn't start at the beginning of the contig
+std::string walk_path_name(const char** field_begin, const char** field_end) {
+    std::string name = std::string(field_begin[1], field_end[1])
+        + "#" + std::string(field_begin[2], field_end[2])
+        + "#" + std::string(field_begin[3], field_end[3]);
+    const std::string start(field_begin[4], field_end[4]);
+    if (start != "*" && start != "0") {
+        name += ":" + start + "-" + std::string(field_begin[5], field_end[5]);
+    }
+    return name;
+}
+
+/// Tokenize the segments and paths of a chunk, and note whether it has links
+void parse_chunk(gfa_chunk_t& chunk) {
+    const char* field_begin[7];
+    const char* field_end[7];
+    for_each_line(
+        chunk.begin, chunk.end,
+        [&](const char* begin, const char* end) {
+            switch (*begin) {
+            case 'S': {
+                uint64_t n = split_fields(begin, end, field_begin, field_end, 3);
+                uint64_t id = 0;
+                if (n < 3 || !parse_id(field_begin[1], field_end[1], id)) {
+                    std::cerr << "[odgi::gfa_to_handle] Error parsing segment '"
+                              << (n < 2 ? std::string(begin, end) : std::string(field_begin[1], field_end[1]))
+                              << "': segment names must be numeric ids, followed by a sequence" << std::endl;
+                    exit(1);
+                }
+                chunk.segments.push_back({id, field_begin[2], (uint64_t)(field_end[2] - field_begin[2])});
+                chunk.min_id = std::min(chunk.min_id, id);
+                chunk.max_id = std::max(chunk.max_id, id);
+                break;
+            }
+            case 'L':
+                chunk.has_links = true;
+                break;
+            case 'P': {
+                uint64_t n = split_fields(begin, end, field_begin, field_end, 3);
+                if (n < 3) {
+                    std::cerr << "[odgi::gfa_to_handle] Error parsing path line '"
+                              << std::string(begin, end) << "'" << std::endl;
+                    exit(1);
+                }
+                chunk.paths.push_back({std::string(field_begin[1], field_end[1]),
+                                       field_begin[2], (uint64_t)(field_end[2] - field_begin[2]),
+                                       false});
+                break;
+            }
+            case 'W': {
+                uint64_t n = split_fields(begin, end, field_begin, field_end, 7);
+                if (n < 7) {
+                    std::cerr << "[odgi::gfa_to_handle] Error parsing walk line '"
+                              << std::string(begin, end) << "'" << std::endl;
+                    exit(1);
+                }
+                chunk.paths.push_back({walk_path_name(field_begin, field_end),
+                                       field_begin[6], (uint64_t)(field_end[6] - field_begin[6]),
+                                       true});
+                break;
+            }
+            default:
+                break;
+            }
+        });
+}
+
+/// Create the nodes of the chunk's segments, in file order
+void add_nodes(handlegraph::MutablePathMutableHandleGraph* graph, const gfa_chunk_t& chunk, uint64_t id_increment) {
+    for (auto& s : chunk.segments) {
+        try {
+            graph->create_handle(std::string(s.seq, s.len), s.id - id_increment);
+        } catch (const std::exception& e) {
+            std::cerr << "[odgi::gfa_to_handle] Error creating node '" << s.id << ": " << e.what() << std::endl;
+            exit(1);
+        }
+    }
+}
+
+/// Create the edges of the chunk's links, returning how many there were
+uint64_t add_edges(handlegraph::MutablePathMutableHandleGraph* graph, const gfa_chunk_t& chunk, uint64_t id_increment) {
+    const char* field_begin[5];
+    const char* field_end[5];
+    uint64_t edges = 0;
+    for_each_line(
+        chunk.begin, chunk.end,
+        [&](const char* begin, const char* end) {
+            if (*begin != 'L') return;
+            uint64_t n = split_fields(begin, end, field_begin, field_end, 5);
+            if (n < 2 || field_begin[1] == field_end[1]) return;
+            const std::string source_name(field_begin[1], field_end[1]);
+            const std::string sink_name(n < 4 ? "" : std::string(field_begin[3], field_end[3]));
+            uint64_t source_id = 0, sink_id = 0;
+            if (n < 5
+                || !parse_id(field_begin[1], field_end[1], source_id)
+                || !parse_id(field_begin[3], field_end[3], sink_id)) {
+                std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << source_name << " <--> " << sink_name << "': could not parse the link" << std::endl;
+                exit(1);
+            }
+            source_id -= id_increment;
+            sink_id -= id_increment;
+            if (graph->has_node(source_id) && graph->has_node(sink_id)) {
+                handlegraph::handle_t a = graph->get_handle(source_id, *field_begin[2] == '-');
+                handlegraph::handle_t b = graph->get_handle(sink_id, *field_begin[4] == '-');
+                graph->create_edge(a, b);
+                ++edges;
+            } else {
+                std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << source_name << " <--> " << sink_name << "' due to missing node(s)" << std::endl;
+                exit(1);
+            }
+        });
+    return edges;
+}
+
+/// Add the steps of a P-line or W-line to its path, or stage them in external_steps
+void add_steps(handlegraph::MutablePathMutableHandleGraph* graph, graph_t* odgi_graph,
+               const handlegraph::path_handle_t& path, const gfa_path_t& p,
+               uint64_t id_increment, external_steps_t* external_steps) {
+    std::vector<handlegraph::handle_t> steps;
+    const char* s = p.steps;
+    const char* end = p.steps + p.steps_len;
+    while (s < end) {
+        // a step is id+ or id- in a P-line, and >id or <id in a W-line
+        const char* e;
+        const char* id_begin;
+        const char* id_end;
+        bool is_rev;
+        bool valid;
+        if (p.is_walk) {
+            e = s + 1;
+            while (e < end && *e != '>' && *e != '<') ++e;
+            id_begin = s + 1;
+            id_end = e;
+            is_rev = (*s == '<');
+            valid = (*s == '>' || *s == '<');
+        } else {
+            const char* comma = (const char*)std::memchr(s, ',', end - s);
+            e = (comma == nullptr ? end : comma);
+            id_begin = s;
+            id_end = e - 1;
+            is_rev = (*(e - 1) == '-');
+            valid = (e - s >= 2 && (*(e - 1) == '+' || *(e - 1) == '-'));
+        }
+        uint64_t id = 0;
+        if (!valid || !parse_id(id_begin, id_end, id)) {
+            std::cerr << "[odgi::gfa_to_handle] id parsing failure for path "
+                      << graph->get_path_name(path)
+                      << " attempting to parse node id from '" << std::string(s, e) << "'" << std::endl;
+            exit(1);
+        }
+        id -= id_increment;
+        if (graph->has_node(id)) {
+            steps.push_back(graph->get_handle(id, is_rev));
+        } else {
+            std::cerr << "[odgi::gfa_to_handle] Error creating path '" << graph->get_path_name(path) << "' due to missing node '" << std::string(id_begin, id_end) << "'" << std::endl;
+            exit(1);
+        }
+        s = (p.is_walk ? e : e + 1);
+    }
+    if (external_steps) {
+        external_steps->add_path(*graph, path, steps);
+    } else if (odgi_graph) {
+        odgi_graph->append_steps(path, steps);
+    } else {
+        for (auto& h : steps) {
+            graph->append_step(path, h);
+        }
+    }
+}
+
+/// Decompress the file in chunks of whole lines, tokenize up to parse_threads of
+/// them at a time in parallel, and hand each such batch to the callback before
+/// dropping it, so that only a few chunks are ever held in memory
+template<typename F>
+void for_each_gzip_batch(const std::string& filename, uint64_t reader_threads, uint64_t parse_threads,
+                         const F& callback) {
+    gzip::gzip_reader_t reader(filename, reader_threads);
+    std::deque<gfa_chunk_t> batch;
+    bool more = true;
+    while (more) {
+        batch.clear();
+        while (more && batch.size() < parse_threads) {
+            std::string text;
+            if ((more = reader.next(text))) {
+                batch.emplace_back();
+                auto& chunk = batch.back();
+                chunk.text = std::move(text);
+                chunk.begin = chunk.text.data();
+                chunk.end = chunk.text.data() + chunk.text.size();
+            }
+        }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(parse_threads)
+        for (uint64_t c = 0; c < batch.size(); ++c) {
+            parse_chunk(batch[c]);
+        }
+        callback(batch, reader.compressed_bytes());
+    }
+}
+
+/// Build the graph from a plain GFA file, which we map and tokenize all at once
+void mapped_gfa_to_handle(const std::string& gfa_filename,
+                          handlegraph::MutablePathMutableHandleGraph* graph,
+                          graph_t* odgi_graph,
+                          bool compact_ids,
+                          uint64_t n_threads,
+                          bool progress,
+                          external_steps_t* external_steps) {
     int gfa_fd = -1;
     char* gfa_buf = nullptr;
-    size_t gfa_filesize = gfak::mmap_open(filename, gfa_buf, gfa_fd);
+    size_t gfa_filesize = gfak::mmap_open((char*)gfa_filename.c_str(), gfa_buf, gfa_fd);
     if (gfa_fd == -1) {
-        cerr << "Couldn't open GFA file " << filename << "." << endl;
+        std::cerr << "[odgi::gfa_to_handle] error: couldn't open GFA file " << gfa_filename << "." << std::endl;
         exit(1);
     }
-    string line;
-    size_t i = 0;
-    //bool seen_newline = true;
-    std::map<char, uint64_t> counts;
-    while (i < gfa_filesize) {
-        if (i == 0 || gfa_buf[i-1] == '\n') {
-            counts[gfa_buf[i]]++;
+
+    // first pass: tokenize the segments and paths of each chunk in parallel
+    std::deque<gfa_chunk_t> chunks;
+    {
+        telemetry::phase_t phase("parse GFA", n_threads);
+        phase.add_items(gfa_filesize);
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                gfa_filesize, "[odgi::gfa_to_handle] parsing GFA:");
+        }
+        // split the file at line boundaries into several chunks per thread
+        split_lines(gfa_buf, gfa_filesize, n_threads * 8, chunks);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+        for (uint64_t c = 0; c < chunks.size(); ++c) {
+            parse_chunk(chunks[c]);
+            if (progress) progress_meter->increment(chunks[c].end - chunks[c].begin);
+        }
+        if (progress) {
+            progress_meter->finish();
         }
-        ++i;
     }
-    gfak::mmap_close(gfa_buf, gfa_fd, gfa_filesize);
-    return counts;
-}
-
-void gfa_to_handle(const string& gfa_filename,
-                   handlegraph::MutablePathMutableHandleGraph* graph,
-                   bool compact_ids,
-                   uint64_t n_threads,
-                   bool progress) {
 
-    n_threads = (n_threads == 0 ? 1 : n_threads);
-    char* filename = (char*) gfa_filename.c_str();
-    //std::cerr << "filename is " << filename << std::endl;
-    gfak::GFAKluge gg;
-    uint64_t i = 0;
     uint64_t min_id = std::numeric_limits<uint64_t>::max();
-    uint64_t max_id = std::numeric_limits<uint64_t>::min();
-    std::map<char, uint64_t> line_counts;
-    // in parallel scan over the file to count edges and sequences
-    {
-        std::thread x(
-            [&]() {
-                gg.for_each_sequence_line_in_file(
-                    filename,
-                    [&](gfak::sequence_elem s) {
-                        try {
-                            uint64_t id = stol(s.name);
-                            min_id = std::min(min_id, id);
-                            max_id = std::max(max_id, id);
-                        } catch (const std::exception& e) {
-                            std::cerr << "[odgi::gfa_to_handle] Error parsing segment '" << s.name << "': " << e.what() << std::endl;
-                            exit(1);
-                        }
-                    });
-            });
-        line_counts = gfa_line_counts(filename);
-        x.join();
-    }
-    uint64_t id_increment = (compact_ids ? min_id - 1 : 0);
-    uint64_t node_count = line_counts['S'];
-    uint64_t edge_count = line_counts['L'];
-    uint64_t path_count = line_counts['P'];
-    // build the nodes
+    uint64_t node_count = 0;
+    uint64_t path_count = 0;
+    uint64_t link_bytes = 0;
+    for (auto& chunk : chunks) {
+        min_id = std::min(min_id, chunk.min_id);
+        node_count += chunk.segments.size();
+        path_count += chunk.paths.size();
+        if (chunk.has_links) link_bytes += chunk.end - chunk.begin;
+    }
+    uint64_t id_increment = (compact_ids && node_count ? min_id - 1 : 0);
+
+    // build the nodes in file order
     {
+        telemetry::phase_t phase("build nodes", 1);
+        phase.add_items(node_count);
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                 node_count, "[odgi::gfa_to_handle] building nodes:");
         }
-        gg.for_each_sequence_line_in_file(
-            filename,
-            [&](const gfak::sequence_elem& s) {
-                try {
-                    uint64_t id = stol(s.name);
-                    graph->create_handle(s.sequence, id - id_increment);
-                } catch (const std::exception& e) {
-                    std::cerr << "[odgi::gfa_to_handle] Error creating node '" << s.name << ": " << e.what() << std::endl;
-                    exit(1);
-                }
-                if (progress) progress_meter->increment(1);
-            });
+        for (auto& chunk : chunks) {
+            add_nodes(graph, chunk, id_increment);
+            if (progress) progress_meter->increment(chunk.segments.size());
+            chunk.segments = std::vector<gfa_segment_t>();
+        }
         if (progress) {
             progress_meter->finish();
         }
     }
 
+    // second pass: add the edges straight from the chunks that have any
     {
+        const uint64_t edge_threads = (odgi_graph ? n_threads : 1);
+        telemetry::phase_t phase("build edges", edge_threads);
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
-                edge_count, "[odgi::gfa_to_handle] building edges:");
-        }
-        gg.for_each_edge_line_in_file(
-            filename,
-            [&](const gfak::edge_elem& e) {
-                if (e.source_name.empty()) return;
-                try {
-                    uint64_t source_id = stol(e.source_name) - id_increment;
-                    uint64_t sink_id = stol(e.sink_name) - id_increment;
-                    if (graph->has_node(source_id) && graph->has_node(sink_id)) {
-                        handlegraph::handle_t a = graph->get_handle(stol(e.source_name) - id_increment, !e.source_orientation_forward);
-                        handlegraph::handle_t b = graph->get_handle(stol(e.sink_name) - id_increment, !e.sink_orientation_forward);
-                        graph->create_edge(a, b);
-                    } else {
-                        std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << e.source_name << " <--> " << e.sink_name << "' due to missing node(s)" << std::endl;
-                        exit(1);
-                    }
-                } catch (const std::exception& exc) {
-                    std::cerr << "[odgi::gfa_to_handle] Error creating edge '" << e.source_name << " <--> " << e.sink_name << "': " << exc.what() << std::endl;
-                    exit(1);
-                }
-
-                if (progress) progress_meter->increment(1);
-            });
+                link_bytes, "[odgi::gfa_to_handle] building edges:");
+        }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(edge_threads)
+        for (uint64_t c = 0; c < chunks.size(); ++c) {
+            auto& chunk = chunks[c];
+            if (!chunk.has_links) continue;
+            phase.add_items(add_edges(graph, chunk, id_increment));
+            if (progress) progress_meter->increment(chunk.end - chunk.begin);
+        }
         if (progress) {
             progress_meter->finish();
         }
     }
 
     if (path_count > 0) {
+        telemetry::phase_t phase("build paths", n_threads);
+        phase.add_items(path_count);
         std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
         if (progress) {
             progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
                 path_count, "[odgi::gfa_to_handle] building paths:");
         }
-        gfa_path_queue_t path_queue;
-        std::mutex logging_mutex;
-        std::atomic<bool> work_todo{};
-        uint64_t idx = 0;
-        auto worker =
-            [&](uint64_t tid) {
-                while (work_todo.load()) {
-                    path_elem_t * p;
-                    if (path_queue.try_pop(p)) {
-                        uint64_t i = 0;
-                        for (auto& s : p->gfak.segment_names) {
-                            uint64_t id = 0;
-                            try {
-                                id = std::stoull(s) - id_increment;
-                                if (graph->has_node(id)) {
-                                    graph->append_step(p->path,
-                                                graph->get_handle(id,
-                                                                    // in gfak, true == +
-                                                                    !p->gfak.orientations[i++]));
-                                } else {
-                                    std::cerr << "[odgi::gfa_to_handle] Error creating path '" << graph->get_path_name(p->path) << "' due to missing node '" << s << "'" << std::endl;
-                                    exit(1);
-                                }
-                            } catch (...) {
-                                std::cerr << "[odgi::gfa_to_handle] id parsing failure for path "
-                                          << graph->get_path_name(p->path)
-                                          << " attempting to parse node id from '" << s << "'" << std::endl;
-                                exit(1);
-                            }
-                        }
-                        delete p;
-                        if (progress) progress_meter->increment(1);
-                    } else {
-                        std::this_thread::sleep_for(std::chrono::nanoseconds(1));
-                    }
-                }
-            };
-
-        std::vector<std::thread> workers;
-        workers.reserve(n_threads);
-        work_todo.store(true);
-        for (uint64_t t = 0; t < n_threads; ++t) {
-            workers.emplace_back(worker, t);
+        // create the paths in file order, so that their handles follow it
+        std::vector<std::pair<handlegraph::path_handle_t, const gfa_path_t*>> paths;
+        paths.reserve(path_count);
+        for (auto& chunk : chunks) {
+            for (auto& p : chunk.paths) {
+                paths.push_back(std::make_pair(graph->create_path_handle(p.name), &p));
+            }
         }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(n_threads)
+        for (uint64_t k = 0; k < paths.size(); ++k) {
+            add_steps(graph, odgi_graph, paths[k].first, *paths[k].second, id_increment, external_steps);
+            if (progress) progress_meter->increment(1);
+        }
+        if (progress) {
+            progress_meter->finish();
+        }
+    }
 
-        gg.for_each_path_line_in_file(
-            filename,
-            [&](const gfak::path_elem& path) {
-                handlegraph::path_handle_t p_h = graph->create_path_handle(path.name);
-                path_elem_t* p = new path_elem_t({p_h, path});
-                path_queue.push(p);
-            });
+    chunks.clear();
+    gfak::mmap_close(gfa_buf, gfa_fd, gfa_filesize);
+}
 
-        while (!path_queue.was_empty()) {
-            std::this_thread::sleep_for(std::chrono::nanoseconds(1));
+/// Build the graph from a gzip or BGZF compressed GFA file. Rather than holding
+/// all of it decompressed, we stream it once to create the nodes and once more to
+/// add the edges and paths, which may refer to nodes defined later in the file.
+/// Compacting ids takes another pass beforehand to find the smallest one.
+void gzip_gfa_to_handle(const std::string& gfa_filename,
+                        handlegraph::MutablePathMutableHandleGraph* graph,
+                        graph_t* odgi_graph,
+                        bool compact_ids,
+                        uint64_t n_threads,
+                        bool progress,
+                        external_steps_t* external_steps) {
+    const uint64_t gfa_filesize = std::filesystem::file_size(gfa_filename);
+    // the reader inflates while we parse, so the two share the thread budget,
+    // which is split evenly when BGZF blocks let the reader inflate in parallel
+    const uint64_t reader_threads = (gzip::is_bgzf(gfa_filename) ? std::max((uint64_t)1, n_threads / 2) : 1);
+    const uint64_t parse_threads = std::max((uint64_t)1, n_threads - reader_threads);
+    const uint64_t edge_threads = (odgi_graph ? parse_threads : 1);
+
+    auto stream = [&](const std::string& message, const auto& callback) {
+        std::unique_ptr<algorithms::progress_meter::ProgressMeter> progress_meter;
+        if (progress) {
+            progress_meter = std::make_unique<algorithms::progress_meter::ProgressMeter>(
+                gfa_filesize, "[odgi::gfa_to_handle] " + message + ":");
         }
-        work_todo.store(false);
-        for (uint64_t t = 0; t < n_threads; ++t) {
-            workers[t].join();
+        uint64_t reported = 0;
+        try {
+            for_each_gzip_batch(
+                gfa_filename, reader_threads, parse_threads,
+                [&](std::deque<gfa_chunk_t>& batch, uint64_t read) {
+                    callback(batch);
+                    if (progress) {
+                        progress_meter->increment(read - reported);
+                        reported = read;
+                    }
+                });
+        } catch (const std::exception& e) {
+            std::cerr << "[odgi::gfa_to_handle] error: couldn't read compressed GFA file " << gfa_filename << ": " << e.what() << std::endl;
+            exit(1);
         }
         if (progress) {
             progress_meter->finish();
         }
+    };
+
+    uint64_t id_increment = 0;
+    if (compact_ids) {
+        telemetry::phase_t phase("scan GFA", n_threads);
+        phase.add_items(gfa_filesize);
+        uint64_t min_id = std::numeric_limits<uint64_t>::max();
+        uint64_t node_count = 0;
+        stream("scanning GFA", [&](std::deque<gfa_chunk_t>& batch) {
+            for (auto& chunk : batch) {
+                min_id = std::min(min_id, chunk.min_id);
+                node_count += chunk.segments.size();
+            }
+        });
+        id_increment = (node_count ? min_id - 1 : 0);
+    }
+
+    {
+        telemetry::phase_t phase("build nodes", n_threads);
+        stream("building nodes", [&](std::deque<gfa_chunk_t>& batch) {
+            for (auto& chunk : batch) {
+                add_nodes(graph, chunk, id_increment);
+                phase.add_items(chunk.segments.size());
+            }
+        });
+    }
+
+    {
+        telemetry::phase_t phase("build edges and paths", n_threads);
+        stream("building edges and paths", [&](std::deque<gfa_chunk_t>& batch) {
+#pragma omp parallel for schedule(dynamic, 1) num_threads(edge_threads)
+            for (uint64_t c = 0; c < batch.size(); ++c) {
+                if (batch[c].has_links) {
+                    phase.add_items(add_edges(graph, batch[c], id_increment));
+                }
+            }
+            // create the paths in file order, so that their handles follow it
+            std::vector<std::pair<handlegraph::path_handle_t, const gfa_path_t*>> paths;
+            for (auto& chunk : batch) {
+                for (auto& p : chunk.paths) {
+                    paths.push_back(std::make_pair(graph->create_path_handle(p.name), &p));
+                }
+            }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(parse_threads)
+            for (uint64_t k = 0; k < paths.size(); ++k) {
+                add_steps(graph, odgi_graph, paths[k].first, *paths[k].second, id_increment, external_steps);
+            }
+        });
+    }
+}
+
+}
+
+void gfa_to_handle(const string& gfa_filename,
+                   handlegraph::MutablePathMutableHandleGraph* graph,
+                   bool compact_ids,
+                   uint64_t n_threads,
+                   bool progress,
+                   external_steps_t* external_steps) {
+
+    n_threads = (n_threads == 0 ? 1 : n_threads);
+    // our own graph can take edges from many threads, and each path's steps in one batch
+    graph_t* odgi_graph = dynamic_cast<graph_t*>(graph);
+    if (gzip::is_gzip(gfa_filename)) {
+        gzip_gfa_to_handle(gfa_filename, graph, odgi_graph, compact_ids, n_threads, progress, external_steps);
+    } else {
+        mapped_gfa_to_handle(gfa_filename, graph, odgi_graph, compact_ids, n_threads, progress, external_steps);
     }
 
     if (compact_ids) {
+        telemetry::phase_t phase("optimize");
         graph->optimize();
     }
 
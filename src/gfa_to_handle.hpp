@@ -15,26 +15,29 @@
 #include <thread>
 #include <mutex>
 #include <functional>
-#include "atomic_queue.h"
 #include "progress.hpp"
 
 namespace odgi {
 
-struct path_elem_t {
-    handlegraph::path_handle_t path;
-    gfak::path_elem gfak;
-};
-
-typedef atomic_queue::AtomicQueue<path_elem_t*, 2 << 10> gfa_path_queue_t;
-
-std::map<char, uint64_t> gfa_line_counts(const char* filename);
+class external_steps_t;
 
 /// Fills a handle graph with an instantiation of a sequence graph from a GFA file.
 /// Handle graph must be empty when passed into function.
+/// The file is mapped into memory and split into chunks of whole lines that
+/// are tokenized in parallel. Nodes are then created in file order, and edges
+/// and paths are added from n_threads threads. GFA 1.1 W-lines become paths
+/// named in PanSN style, sample#haplotype#contig, with a :start-end suffix
+/// when the walk does not start at the beginning of its contig.
+/// A gzip or BGZF compressed file is instead decompressed in chunks, and read
+/// twice, first for the nodes and then for the edges and paths, so that it is
+/// never held in memory whole.
+/// If external_steps is given, the paths are created empty and their steps
+/// are staged there instead, to be indexed and written out on disk.
 void gfa_to_handle(const string& gfa_filename,
                    handlegraph::MutablePathMutableHandleGraph* graph,
                    bool compact_ids,
                    uint64_t n_threads,
-                   bool show_progress);
+                   bool show_progress,
+                   external_steps_t* external_steps = nullptr);
 
 }
@@ -0,0 +1,345 @@
+#include "gzip_stream.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <zlib.h>
+#include <omp.h>
+
+namespace odgi {
+
+namespace gzip {
+
+namespace {
+
+/// Uncompressed bytes per BGZF block, as in htslib
+const uint64_t bgzf_block_data = 0xff00;
+/// Largest BGZF block, compressed
+const uint64_t bgzf_max_block = 1 << 16;
+/// Size of the fixed BGZF block header, including its BC extra field
+const uint64_t bgzf_header_size = 18;
+/// Compressed bytes read at a time from plain gzip
+const uint64_t gzip_read_size = 1 << 20;
+
+const unsigned char bgzf_eof[28] = {
+    0x1f, 0x8b, 0x08, 0x04, 0x00, 0x00, 0x00, 0x00, 0x00, 0xff, 0x06, 0x00, 0x42, 0x43,
+    0x02, 0x00, 0x1b, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+inline uint32_t read_le32(const unsigned char* p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+inline void write_le16(unsigned char* p, uint16_t v) {
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+inline void write_le32(unsigned char* p, uint32_t v) {
+    for (int i = 0; i < 4; ++i) p[i] = (v >> (8 * i)) & 0xff;
+}
+
+/// If the header is that of a BGZF block, return the block's total size, else 0
+inline uint64_t bgzf_block_size(const unsigned char* h) {
+    if (h[0] == 0x1f && h[1] == 0x8b && h[2] == 8 && (h[3] & 4)
+        && h[10] == 6 && h[11] == 0 && h[12] == 'B' && h[13] == 'C'
+        && h[14] == 2 && h[15] == 0) {
+        return ((uint64_t)h[16] | ((uint64_t)h[17] << 8)) + 1;
+    }
+    return 0;
+}
+
+/// Inflate one gzip member held entirely in memory
+void inflate_block(const std::string& block, std::string& out) {
+    // the last four bytes hold the uncompressed size
+    out.resize(read_le32((const unsigned char*)block.data() + block.size() - 4));
+    if (out.empty()) return;
+    z_stream zs;
+    std::memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        throw std::runtime_error("[odgi::gzip] error: could not initialize zlib");
+    }
+    zs.next_in = (Bytef*)block.data();
+    zs.avail_in = block.size();
+    zs.next_out = (Bytef*)&out[0];
+    zs.avail_out = out.size();
+    int ret = inflate(&zs, Z_FINISH);
+    inflateEnd(&zs);
+    if (ret != Z_STREAM_END || zs.avail_out != 0) {
+        throw std::runtime_error("[odgi::gzip] error: corrupt BGZF block");
+    }
+}
+
+/// Deflate data into a complete BGZF block
+void deflate_block(const char* data, uint64_t len, int level, std::string& block) {
+    for (int l : {level, 0}) {
+        block.resize(bgzf_max_block);
+        unsigned char* b = (unsigned char*)&block[0];
+        z_stream zs;
+        std::memset(&zs, 0, sizeof(zs));
+        if (deflateInit2(&zs, l, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            throw std::runtime_error("[odgi::gzip] error: could not initialize zlib");
+        }
+        zs.next_in = (Bytef*)data;
+        zs.avail_in = len;
+        zs.next_out = b + bgzf_header_size;
+        zs.avail_out = bgzf_max_block - bgzf_header_size - 8;
+        int ret = deflate(&zs, Z_FINISH);
+        uint64_t compressed = zs.total_out;
+        deflateEnd(&zs);
+        if (ret != Z_STREAM_END) {
+            // didn't fit, which can only happen with incompressible data, so store it instead
+            continue;
+        }
+        const uint64_t total = bgzf_header_size + compressed + 8;
+        std::memcpy(b, bgzf_eof, bgzf_header_size);
+        write_le16(b + 16, total - 1);
+        write_le32(b + bgzf_header_size + compressed, crc32(crc32(0L, Z_NULL, 0), (const Bytef*)data, len));
+        write_le32(b + bgzf_header_size + compressed + 4, len);
+        block.resize(total);
+        return;
+    }
+    throw std::runtime_error("[odgi::gzip] error: could not compress a BGZF block");
+}
+
+}
+
+bool is_gzip(const std::string& filename) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if (f == nullptr) return false;
+    unsigned char magic[2] = {0, 0};
+    size_t n = fread(magic, 1, 2, f);
+    fclose(f);
+    return n == 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+}
+
+bool is_bgzf(const std::string& filename) {
+    FILE* f = fopen(filename.c_str(), "rb");
+    if (f == nullptr) return false;
+    unsigned char header[bgzf_header_size];
+    size_t n = fread(header, 1, bgzf_header_size, f);
+    fclose(f);
+    return n == bgzf_header_size && bgzf_block_size(header) > 0;
+}
+
+gzip_reader_t::gzip_reader_t(const std::string& filename, uint64_t num_threads, uint64_t chunk_size)
+    : filename(filename),
+      num_threads(std::max(num_threads, (uint64_t)1)),
+      chunk_size(chunk_size),
+      max_queued(std::max(num_threads, (uint64_t)1) + 1) {
+    producer = std::thread(&gzip_reader_t::produce, this);
+}
+
+gzip_reader_t::~gzip_reader_t(void) {
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        stop = true;
+    }
+    cv.notify_all();
+    producer.join();
+}
+
+bool gzip_reader_t::next(std::string& chunk) {
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return !queue.empty() || done; });
+    if (!queue.empty()) {
+        chunk = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        cv.notify_all();
+        return true;
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    return false;
+}
+
+uint64_t gzip_reader_t::compressed_bytes(void) const {
+    return read_bytes.load();
+}
+
+bool gzip_reader_t::emit(std::string& pending, bool at_end) {
+    std::string chunk;
+    if (at_end) {
+        chunk = std::move(pending);
+        pending.clear();
+    } else {
+        auto nl = pending.rfind('\n');
+        if (nl == std::string::npos) return true;
+        chunk = pending.substr(0, nl + 1);
+        pending.erase(0, nl + 1);
+    }
+    if (chunk.empty()) return true;
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [&]() { return queue.size() < max_queued || stop; });
+    if (stop) return false;
+    queue.push_back(std::move(chunk));
+    lock.unlock();
+    cv.notify_all();
+    return true;
+}
+
+void gzip_reader_t::produce(void) {
+    std::string pending;
+    try {
+        FILE* in = fopen(filename.c_str(), "rb");
+        if (in == nullptr) {
+            throw std::runtime_error("[odgi::gzip] error: could not open " + filename);
+        }
+        unsigned char header[bgzf_header_size];
+        size_t n = fread(header, 1, bgzf_header_size, in);
+        bool bgzf = (n == bgzf_header_size && bgzf_block_size(header) > 0);
+        if (bgzf) {
+            rewind(in);
+            produce_bgzf(in, pending);
+            fclose(in);
+        } else {
+            fclose(in);
+            produce_gzip(pending);
+        }
+        emit(pending, true);
+    } catch (const std::exception& e) {
+        std::lock_guard<std::mutex> guard(mutex);
+        error = e.what();
+    }
+    {
+        std::lock_guard<std::mutex> guard(mutex);
+        done = true;
+    }
+    cv.notify_all();
+}
+
+void gzip_reader_t::produce_bgzf(FILE* in, std::string& pending) {
+    // blocks are independent, so we inflate a batch of them at once
+    const uint64_t batch_size = num_threads * 64;
+    std::vector<std::string> blocks(batch_size);
+    std::vector<std::string> inflated(batch_size);
+    bool at_end = false;
+    while (!at_end) {
+        uint64_t n = 0;
+        while (n < batch_size) {
+            unsigned char header[bgzf_header_size];
+            size_t r = fread(header, 1, bgzf_header_size, in);
+            if (r == 0) {
+                at_end = true;
+                break;
+            }
+            uint64_t size = (r == bgzf_header_size ? bgzf_block_size(header) : 0);
+            if (size < bgzf_header_size + 8) {
+                throw std::runtime_error("[odgi::gzip] error: " + filename + " mixes BGZF blocks with other data");
+            }
+            blocks[n].resize(size);
+            std::memcpy(&blocks[n][0], header, bgzf_header_size);
+            if (fread(&blocks[n][bgzf_header_size], 1, size - bgzf_header_size, in) != size - bgzf_header_size) {
+                throw std::runtime_error("[odgi::gzip] error: " + filename + " ends in the middle of a BGZF block");
+            }
+            read_bytes += size;
+            ++n;
+        }
+        std::string error_in_batch;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (uint64_t i = 0; i < n; ++i) {
+            try {
+                inflate_block(blocks[i], inflated[i]);
+            } catch (const std::exception& e) {
+#pragma omp critical (gzip_error)
+                error_in_batch = e.what();
+            }
+        }
+        if (!error_in_batch.empty()) {
+            throw std::runtime_error(error_in_batch);
+        }
+        for (uint64_t i = 0; i < n; ++i) {
+            pending.append(inflated[i]);
+            if (pending.size() >= chunk_size && !emit(pending, false)) return;
+        }
+    }
+}
+
+void gzip_reader_t::produce_gzip(std::string& pending) {
+    gzFile in = gzopen(filename.c_str(), "rb");
+    if (in == nullptr) {
+        throw std::runtime_error("[odgi::gzip] error: could not open " + filename);
+    }
+    gzbuffer(in, gzip_read_size);
+    std::vector<char> buf(gzip_read_size);
+    while (true) {
+        int n = gzread(in, buf.data(), buf.size());
+        if (n < 0) {
+            int errnum = 0;
+            std::string msg = gzerror(in, &errnum);
+            gzclose(in);
+            throw std::runtime_error("[odgi::gzip] error: could not decompress " + filename + ": " + msg);
+        }
+        if (n == 0) break;
+        read_bytes.store(gzoffset(in));
+        pending.append(buf.data(), n);
+        if (pending.size() >= chunk_size && !emit(pending, false)) break;
+    }
+    gzclose(in);
+}
+
+bgzf_streambuf_t::bgzf_streambuf_t(std::ostream& out, uint64_t num_threads, int level)
+    : out(out),
+      num_threads(std::max(num_threads, (uint64_t)1)),
+      level(level) {
+    buffer.resize(this->num_threads * 16 * bgzf_block_data);
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+bgzf_streambuf_t::~bgzf_streambuf_t(void) {
+    close();
+}
+
+void bgzf_streambuf_t::write_buffered(void) {
+    const uint64_t len = pptr() - pbase();
+    const uint64_t n = (len + bgzf_block_data - 1) / bgzf_block_data;
+    blocks.resize(std::max(blocks.size(), (size_t)n));
+    std::string error_in_batch;
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+    for (uint64_t i = 0; i < n; ++i) {
+        const uint64_t begin = i * bgzf_block_data;
+        try {
+            deflate_block(pbase() + begin, std::min(bgzf_block_data, len - begin), level, blocks[i]);
+        } catch (const std::exception& e) {
+#pragma omp critical (gzip_error)
+            error_in_batch = e.what();
+        }
+    }
+    if (!error_in_batch.empty()) {
+        throw std::runtime_error(error_in_batch);
+    }
+    for (uint64_t i = 0; i < n; ++i) {
+        out.write(blocks[i].data(), blocks[i].size());
+    }
+    setp(buffer.data(), buffer.data() + buffer.size());
+}
+
+bgzf_streambuf_t::int_type bgzf_streambuf_t::overflow(int_type c) {
+    if (closed) return traits_type::eof();
+    write_buffered();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+int bgzf_streambuf_t::sync(void) {
+    // compressing on every flush would make many tiny blocks, so we only
+    // flush what has already been compressed
+    out.flush();
+    return out ? 0 : -1;
+}
+
+void bgzf_streambuf_t::close(void) {
+    if (closed) return;
+    write_buffered();
+    out.write((const char*)bgzf_eof, sizeof(bgzf_eof));
+    out.flush();
+    closed = true;
+}
+
+}
+
+}
@@ -0,0 +1,98 @@
+//
+//  odgi
+//
+//  gzip_stream.hpp
+//
+//  pipelined gzip/BGZF input and parallel BGZF output
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <streambuf>
+#include <ostream>
+
+namespace odgi {
+
+namespace gzip {
+
+/// True if the file starts with the gzip magic number
+bool is_gzip(const std::string& filename);
+
+/// True if the file starts with a BGZF block, as written by bgzip
+bool is_bgzf(const std::string& filename);
+
+/// Reads a gzip compressed text file as chunks of whole lines. A background
+/// thread decompresses ahead of the consumer, keeping a few chunks queued.
+/// BGZF files (as written by bgzip) are cut into their independent blocks,
+/// which are inflated by several threads at once. Other gzip files, with one
+/// or more members, are inflated by the background thread alone.
+class gzip_reader_t {
+public:
+    /// Inflate with up to num_threads threads, the background one included
+    gzip_reader_t(const std::string& filename, uint64_t num_threads, uint64_t chunk_size = 1 << 24);
+    ~gzip_reader_t(void);
+    gzip_reader_t(const gzip_reader_t& other) = delete;
+    gzip_reader_t& operator=(const gzip_reader_t& other) = delete;
+    /// Move the next chunk of whole lines into chunk, returning false once the
+    /// input is exhausted. Throws if the input is not valid gzip.
+    bool next(std::string& chunk);
+    /// Compressed bytes read so far
+    uint64_t compressed_bytes(void) const;
+private:
+    std::string filename;
+    uint64_t num_threads;
+    uint64_t chunk_size;
+    uint64_t max_queued;
+    std::deque<std::string> queue;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool done = false;
+    bool stop = false;
+    std::string error;
+    std::atomic<uint64_t> read_bytes{0};
+    std::thread producer;
+    void produce(void);
+    void produce_bgzf(FILE* in, std::string& pending);
+    void produce_gzip(std::string& pending);
+    /// Queue the whole lines of pending, keeping the partial last line, or everything if at_end
+    bool emit(std::string& pending, bool at_end);
+};
+
+/// A stream buffer that writes BGZF to an underlying stream. The input is
+/// cut into blocks of up to 0xff00 bytes, and batches of blocks are
+/// compressed in parallel and written in order. The output ends with the
+/// BGZF end-of-file marker block, so it can be read by gzip, bgzip, samtools
+/// and gzip_reader_t alike.
+class bgzf_streambuf_t : public std::streambuf {
+public:
+    bgzf_streambuf_t(std::ostream& out, uint64_t num_threads, int level = 6);
+    ~bgzf_streambuf_t(void);
+    bgzf_streambuf_t(const bgzf_streambuf_t& other) = delete;
+    bgzf_streambuf_t& operator=(const bgzf_streambuf_t& other) = delete;
+    /// Compress what is buffered, write the end-of-file marker and flush
+    void close(void);
+protected:
+    int_type overflow(int_type c) override;
+    int sync(void) override;
+private:
+    std::ostream& out;
+    uint64_t num_threads;
+    int level;
+    bool closed = false;
+    std::vector<char> buffer;
+    std::vector<std::string> blocks;
+    void write_buffered(void);
+};
+
+}
+
+}
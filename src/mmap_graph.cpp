@@ -0,0 +1,590 @@
+//
+//  mmap_graph.cpp
+//
+
+#include "mmap_graph.hpp"
+
+#include <fstream>
+#include <cstring>
+#include <cassert>
+#include <limits>
+#include <numeric>
+#include <algorithm>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace odgi {
+
+namespace {
+
+inline uint64_t align8(uint64_t n) {
+    return (n + 7) & ~(uint64_t)7;
+}
+
+// write a vector and pad the section to the next 8 byte boundary
+template<typename T>
+void write_section(std::ostream& out, const T* v, uint64_t n) {
+    uint64_t bytes = n * sizeof(T);
+    out.write((const char*)v, bytes);
+    static const char zeros[8] = {0, 0, 0, 0, 0, 0, 0, 0};
+    out.write(zeros, align8(bytes) - bytes);
+}
+
+}
+
+mmap_graph_t::mmap_graph_t(const std::string& filename) {
+    open(filename);
+}
+
+mmap_graph_t::~mmap_graph_t(void) {
+    close();
+}
+
+bool mmap_graph_t::is_frozen(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    char magic[8];
+    if (!in.read(magic, sizeof(magic))) {
+        return false;
+    }
+    return std::memcmp(magic, magic_string, sizeof(magic)) == 0;
+}
+
+void mmap_graph_t::freeze(const graph_t& graph, const std::string& filename, uint64_t nthreads) {
+    const uint64_t node_slots = graph.node_v.size();
+    std::vector<path_handle_t> paths;
+    graph.for_each_path_handle([&](const path_handle_t& p) {
+        paths.push_back(p);
+    });
+    const uint64_t path_count = paths.size();
+
+    // per slot sequence lengths and degrees, turned into offsets
+    std::vector<uint64_t> seq_offsets(node_slots + 1, 0);
+    std::vector<uint64_t> edge_offsets(2 * node_slots + 1, 0);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t i = 0; i < node_slots; ++i) {
+        if (graph.node_v[i] == nullptr) continue;
+        handle_t h = number_bool_packing::pack(i, false);
+        seq_offsets[i + 1] = graph.get_length(h);
+        edge_offsets[2 * i + 1] = graph.get_degree(h, false);
+        edge_offsets[2 * i + 2] = graph.get_degree(h, true);
+    }
+    std::partial_sum(seq_offsets.begin(), seq_offsets.end(), seq_offsets.begin());
+    std::partial_sum(edge_offsets.begin(), edge_offsets.end(), edge_offsets.begin());
+
+    // path names, sorted order, and circularity
+    std::vector<uint64_t> name_offsets(path_count + 1, 0);
+    std::vector<uint64_t> path_circular(path_count, 0);
+    std::vector<std::string> names(path_count);
+    for (uint64_t i = 0; i < path_count; ++i) {
+        names[i] = graph.get_path_name(paths[i]);
+        name_offsets[i + 1] = name_offsets[i] + names[i].size();
+        path_circular[i] = graph.get_is_circular(paths[i]);
+    }
+    std::vector<uint64_t> name_order(path_count);
+    std::iota(name_order.begin(), name_order.end(), 0);
+    std::sort(name_order.begin(), name_order.end(),
+              [&](const uint64_t& a, const uint64_t& b) {
+                  return names[a] < names[b];
+              });
+
+    // which slots hold nodes, as deleted slots and empty nodes both have no sequence
+    std::vector<uint64_t> node_live((node_slots + 63) / 64, 0);
+    for (uint64_t i = 0; i < node_slots; ++i) {
+        if (graph.node_v[i] != nullptr) {
+            node_live[i >> 6] |= (uint64_t)1 << (i & 63);
+        }
+    }
+
+    // steps in path order
+    std::vector<uint64_t> step_offsets(path_count + 1, 0);
+    for (uint64_t i = 0; i < path_count; ++i) {
+        step_offsets[i + 1] = step_offsets[i] + graph.get_step_count(paths[i]);
+    }
+    const uint64_t step_count = step_offsets[path_count];
+    std::vector<uint64_t> steps(step_count);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < path_count; ++i) {
+        uint64_t j = step_offsets[i];
+        graph.for_each_step_in_path(paths[i], [&](const step_handle_t& step) {
+            steps[j++] = as_integer(graph.get_handle_of_step(step));
+        });
+    }
+
+    // steps grouped by node slot, via a counting sort
+    std::vector<uint64_t> node_step_offsets(node_slots + 1, 0);
+    for (auto& h : steps) {
+        ++node_step_offsets[number_bool_packing::unpack_number(as_handle(h)) + 1];
+    }
+    std::partial_sum(node_step_offsets.begin(), node_step_offsets.end(), node_step_offsets.begin());
+    std::vector<uint64_t> node_steps(2 * step_count);
+    {
+        std::vector<uint64_t> fill(node_step_offsets.begin(), node_step_offsets.end() - 1);
+        for (uint64_t i = 0; i < path_count; ++i) {
+            for (uint64_t j = step_offsets[i]; j < step_offsets[i + 1]; ++j) {
+                uint64_t& k = fill[number_bool_packing::unpack_number(as_handle(steps[j]))];
+                node_steps[2 * k] = i;
+                node_steps[2 * k + 1] = j - step_offsets[i];
+                ++k;
+            }
+        }
+    }
+
+    // lay out the file
+    frozen_graph_header_t header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, magic_string, sizeof(header.magic));
+    header.version = format_version;
+    header.node_slots = node_slots;
+    header.node_count = graph.get_node_count();
+    header.min_node_id = graph.min_node_id();
+    header.max_node_id = graph.max_node_id();
+    header.id_increment = graph._id_increment;
+    header.edge_count = graph._edge_count;
+    header.path_count = path_count;
+    header.step_count = step_count;
+    uint64_t offset = align8(sizeof(header));
+    auto place = [&](uint64_t bytes) {
+        uint64_t o = offset;
+        offset += align8(bytes);
+        return o;
+    };
+    header.seq_offsets = place(seq_offsets.size() * sizeof(uint64_t));
+    header.seq = place(seq_offsets.back());
+    header.edge_offsets = place(edge_offsets.size() * sizeof(uint64_t));
+    header.edges = place(edge_offsets.back() * sizeof(uint64_t));
+    header.name_offsets = place(name_offsets.size() * sizeof(uint64_t));
+    header.names = place(name_offsets.back());
+    header.name_order = place(name_order.size() * sizeof(uint64_t));
+    header.path_circular = place(path_circular.size() * sizeof(uint64_t));
+    header.step_offsets = place(step_offsets.size() * sizeof(uint64_t));
+    header.steps = place(steps.size() * sizeof(uint64_t));
+    header.node_step_offsets = place(node_step_offsets.size() * sizeof(uint64_t));
+    header.node_steps = place(node_steps.size() * sizeof(uint64_t));
+    header.node_live = place(node_live.size() * sizeof(uint64_t));
+    header.file_size = offset;
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out) {
+        throw std::runtime_error("[odgi::mmap_graph] error: could not open " + filename + " for writing");
+    }
+    write_section(out, (const char*)&header, sizeof(header));
+    write_section(out, seq_offsets.data(), seq_offsets.size());
+    {
+        std::string seqs;
+        seqs.reserve(seq_offsets.back());
+        for (uint64_t i = 0; i < node_slots; ++i) {
+            if (graph.node_v[i] == nullptr) continue;
+            seqs.append(graph.node_v[i]->get_sequence());
+        }
+        write_section(out, seqs.data(), seqs.size());
+    }
+    write_section(out, edge_offsets.data(), edge_offsets.size());
+    {
+        std::vector<uint64_t> edges;
+        edges.reserve(edge_offsets.back());
+        for (uint64_t i = 0; i < node_slots; ++i) {
+            if (graph.node_v[i] == nullptr) continue;
+            handle_t h = number_bool_packing::pack(i, false);
+            graph.follow_edges(h, false, [&](const handle_t& other) {
+                edges.push_back(as_integer(other));
+            });
+            graph.follow_edges(h, true, [&](const handle_t& other) {
+                edges.push_back(as_integer(other));
+            });
+        }
+        write_section(out, edges.data(), edges.size());
+    }
+    write_section(out, name_offsets.data(), name_offsets.size());
+    {
+        std::string all_names;
+        all_names.reserve(name_offsets.back());
+        for (auto& name : names) {
+            all_names.append(name);
+        }
+        write_section(out, all_names.data(), all_names.size());
+    }
+    write_section(out, name_order.data(), name_order.size());
+    write_section(out, path_circular.data(), path_circular.size());
+    write_section(out, step_offsets.data(), step_offsets.size());
+    write_section(out, steps.data(), steps.size());
+    write_section(out, node_step_offsets.data(), node_step_offsets.size());
+    write_section(out, node_steps.data(), node_steps.size());
+    write_section(out, node_live.data(), node_live.size());
+    out.close();
+}
+
+void mmap_graph_t::open(const std::string& filename) {
+    close();
+    fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        throw std::runtime_error("[odgi::mmap_graph] error: could not open " + filename);
+    }
+    struct stat st;
+    if (fstat(fd, &st) == -1 || (uint64_t)st.st_size < sizeof(frozen_graph_header_t)) {
+        close();
+        throw std::runtime_error("[odgi::mmap_graph] error: " + filename + " is too small to be a frozen graph");
+    }
+    size = st.st_size;
+    void* m = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (m == MAP_FAILED) {
+        data = nullptr;
+        close();
+        throw std::runtime_error("[odgi::mmap_graph] error: could not map " + filename);
+    }
+    data = (const uint8_t*)m;
+    header = (const frozen_graph_header_t*)data;
+    if (std::memcmp(header->magic, magic_string, sizeof(header->magic)) != 0
+        || header->version != format_version
+        || header->file_size != size) {
+        close();
+        throw std::runtime_error("[odgi::mmap_graph] error: " + filename + " is not a frozen graph of version "
+                                 + std::to_string(format_version) + " or is truncated");
+    }
+    seq_offsets = (const uint64_t*)(data + header->seq_offsets);
+    seq = (const char*)(data + header->seq);
+    edge_offsets = (const uint64_t*)(data + header->edge_offsets);
+    edges = (const uint64_t*)(data + header->edges);
+    name_offsets = (const uint64_t*)(data + header->name_offsets);
+    names = (const char*)(data + header->names);
+    name_order = (const uint64_t*)(data + header->name_order);
+    path_circular = (const uint64_t*)(data + header->path_circular);
+    step_offsets = (const uint64_t*)(data + header->step_offsets);
+    steps = (const uint64_t*)(data + header->steps);
+    node_step_offsets = (const uint64_t*)(data + header->node_step_offsets);
+    node_steps = (const uint64_t*)(data + header->node_steps);
+    node_live = (const uint64_t*)(data + header->node_live);
+}
+
+void mmap_graph_t::close(void) {
+    if (data != nullptr) {
+        munmap((void*)data, size);
+        data = nullptr;
+    }
+    if (fd != -1) {
+        ::close(fd);
+        fd = -1;
+    }
+    header = nullptr;
+    size = 0;
+}
+
+void mmap_graph_t::thaw(graph_t& graph, uint64_t nthreads) const {
+    // create the nodes before setting the id increment, as load_node works in raw ids, and
+    // through load_node rather than create_handle, as live nodes may have empty sequences
+    for (uint64_t i = 0; i < header->node_slots; ++i) {
+        if (is_live(i)) {
+            graph.load_node(std::string(seq + seq_offsets[i], seq_offsets[i + 1] - seq_offsets[i]), i + 1);
+        }
+    }
+    graph.set_id_increment(header->id_increment);
+    // every edge is listed on both of the sides it joins, and is only created from the
+    // first of them, so that no two threads ever create the same edge
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(nthreads)
+    for (uint64_t i = 0; i < header->node_slots; ++i) {
+        handle_t h = number_bool_packing::pack(i, false);
+        for (uint64_t side = 2 * i; side < 2 * i + 2; ++side) {
+            const bool go_left = side & 1;
+            for (uint64_t j = edge_offsets[side]; j < edge_offsets[side + 1]; ++j) {
+                const handle_t other = as_handle(edges[j]);
+                const uint64_t other_side = 2 * number_bool_packing::unpack_number(other)
+                    + (go_left == get_is_reverse(other));
+                if (side <= other_side) {
+                    if (go_left) {
+                        graph.create_edge(other, h);
+                    } else {
+                        graph.create_edge(h, other);
+                    }
+                }
+            }
+        }
+    }
+    std::vector<path_handle_t> paths(header->path_count);
+    for (uint64_t i = 0; i < header->path_count; ++i) {
+        paths[i] = graph.create_path_handle(name_of(i), path_circular[i]);
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(nthreads)
+    for (uint64_t i = 0; i < header->path_count; ++i) {
+        std::vector<handle_t> to_append(step_offsets[i + 1] - step_offsets[i]);
+        for (uint64_t j = step_offsets[i]; j < step_offsets[i + 1]; ++j) {
+            to_append[j - step_offsets[i]] = as_handle(steps[j]);
+        }
+        graph.append_steps(paths[i], to_append);
+    }
+}
+
+bool mmap_graph_t::has_node(nid_t node_id) const {
+    uint64_t rank = node_id - header->id_increment - 1;
+    return rank < header->node_slots && is_live(rank);
+}
+
+handle_t mmap_graph_t::get_handle(const nid_t& node_id, bool is_reverse) const {
+    return number_bool_packing::pack(node_id - header->id_increment - 1, is_reverse);
+}
+
+nid_t mmap_graph_t::get_id(const handle_t& handle) const {
+    return number_bool_packing::unpack_number(handle) + 1 + header->id_increment;
+}
+
+bool mmap_graph_t::get_is_reverse(const handle_t& handle) const {
+    return number_bool_packing::unpack_bit(handle);
+}
+
+handle_t mmap_graph_t::flip(const handle_t& handle) const {
+    return number_bool_packing::toggle_bit(handle);
+}
+
+size_t mmap_graph_t::get_length(const handle_t& handle) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    return seq_offsets[rank + 1] - seq_offsets[rank];
+}
+
+std::string mmap_graph_t::get_sequence(const handle_t& handle) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    std::string s(seq + seq_offsets[rank], seq_offsets[rank + 1] - seq_offsets[rank]);
+    return get_is_reverse(handle) ? reverse_complement(s) : s;
+}
+
+char mmap_graph_t::get_base(const handle_t& handle, size_t index) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    if (get_is_reverse(handle)) {
+        return reverse_complement(seq[seq_offsets[rank + 1] - 1 - index]);
+    } else {
+        return seq[seq_offsets[rank] + index];
+    }
+}
+
+std::string mmap_graph_t::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    uint64_t len = seq_offsets[rank + 1] - seq_offsets[rank];
+    if (index >= len) return "";
+    size = std::min(size, (size_t)(len - index));
+    if (get_is_reverse(handle)) {
+        const char* end = seq + seq_offsets[rank + 1] - index;
+        std::string s(size, 'N');
+        for (size_t i = 0; i < size; ++i) {
+            s[i] = reverse_complement(*(end - 1 - i));
+        }
+        return s;
+    } else {
+        return std::string(seq + seq_offsets[rank] + index, size);
+    }
+}
+
+size_t mmap_graph_t::get_node_count(void) const {
+    return header->node_count;
+}
+
+nid_t mmap_graph_t::min_node_id(void) const {
+    return header->min_node_id;
+}
+
+nid_t mmap_graph_t::max_node_id(void) const {
+    return header->max_node_id;
+}
+
+size_t mmap_graph_t::get_degree(const handle_t& handle, bool go_left) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    // going left on the reverse strand is going right on the forward strand
+    uint64_t side = 2 * rank + (go_left != get_is_reverse(handle));
+    return edge_offsets[side + 1] - edge_offsets[side];
+}
+
+size_t mmap_graph_t::get_edge_count(void) const {
+    return header->edge_count;
+}
+
+bool mmap_graph_t::follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    bool is_rev = get_is_reverse(handle);
+    uint64_t side = 2 * rank + (go_left != is_rev);
+    for (uint64_t j = edge_offsets[side]; j < edge_offsets[side + 1]; ++j) {
+        handle_t other = as_handle(edges[j]);
+        if (!iteratee(is_rev ? flip(other) : other)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool mmap_graph_t::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const {
+    const uint64_t node_slots = header->node_slots;
+    if (parallel) {
+        volatile bool flag = true;
+#pragma omp parallel for
+        for (uint64_t i = 0; i < node_slots; ++i) {
+            if (!flag || !is_live(i)) continue;
+            bool result = iteratee(number_bool_packing::pack(i, false));
+#pragma omp atomic
+            flag &= result;
+        }
+        return flag;
+    } else {
+        for (uint64_t i = 0; i < node_slots; ++i) {
+            if (!is_live(i)) continue;
+            if (!iteratee(number_bool_packing::pack(i, false))) return false;
+        }
+        return true;
+    }
+}
+
+size_t mmap_graph_t::get_path_count(void) const {
+    return header->path_count;
+}
+
+uint64_t mmap_graph_t::find_path(const std::string& path_name) const {
+    const uint64_t path_count = header->path_count;
+    auto it = std::lower_bound(name_order, name_order + path_count, path_name,
+                               [&](const uint64_t& idx, const std::string& name) {
+                                   return name_of(idx) < name;
+                               });
+    if (it != name_order + path_count && name_of(*it) == path_name) {
+        return *it;
+    }
+    return path_count;
+}
+
+bool mmap_graph_t::has_path(const std::string& path_name) const {
+    return find_path(path_name) != header->path_count;
+}
+
+path_handle_t mmap_graph_t::get_path_handle(const std::string& path_name) const {
+    uint64_t idx = find_path(path_name);
+    assert(idx != header->path_count);
+    return as_path_handle(idx + 1);
+}
+
+std::string mmap_graph_t::get_path_name(const path_handle_t& path_handle) const {
+    return name_of(path_index(path_handle));
+}
+
+bool mmap_graph_t::get_is_circular(const path_handle_t& path_handle) const {
+    return path_circular[path_index(path_handle)];
+}
+
+size_t mmap_graph_t::get_step_count(const path_handle_t& path_handle) const {
+    return step_count_of(path_index(path_handle));
+}
+
+size_t mmap_graph_t::get_step_count(const handle_t& handle) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    return node_step_offsets[rank + 1] - node_step_offsets[rank];
+}
+
+handle_t mmap_graph_t::get_handle_of_step(const step_handle_t& step_handle) const {
+    return as_handle(steps[step_offsets[as_integers(step_handle)[0] - 1] + as_integers(step_handle)[1]]);
+}
+
+path_handle_t mmap_graph_t::get_path_handle_of_step(const step_handle_t& step_handle) const {
+    return as_path_handle(as_integers(step_handle)[0]);
+}
+
+step_handle_t mmap_graph_t::path_begin(const path_handle_t& path_handle) const {
+    step_handle_t step;
+    as_integers(step)[0] = as_integer(path_handle);
+    as_integers(step)[1] = 0;
+    return step;
+}
+
+step_handle_t mmap_graph_t::path_end(const path_handle_t& path_handle) const {
+    step_handle_t step;
+    as_integers(step)[0] = as_integer(path_handle);
+    as_integers(step)[1] = get_step_count(path_handle);
+    return step;
+}
+
+step_handle_t mmap_graph_t::path_back(const path_handle_t& path_handle) const {
+    step_handle_t step;
+    as_integers(step)[0] = as_integer(path_handle);
+    as_integers(step)[1] = get_step_count(path_handle) - 1;
+    return step;
+}
+
+step_handle_t mmap_graph_t::path_front_end(const path_handle_t& path_handle) const {
+    step_handle_t step;
+    as_integers(step)[0] = as_integer(path_handle);
+    as_integers(step)[1] = std::numeric_limits<uint64_t>::max();
+    return step;
+}
+
+bool mmap_graph_t::has_next_step(const step_handle_t& step_handle) const {
+    const uint64_t path_idx = as_integers(step_handle)[0] - 1;
+    const uint64_t rank = as_integers(step_handle)[1];
+    const uint64_t count = step_count_of(path_idx);
+    if (rank == std::numeric_limits<uint64_t>::max()) {
+        return count > 0;
+    }
+    // the last step of a circular path is followed by its first
+    return rank + 1 < count || (path_circular[path_idx] && rank + 1 == count);
+}
+
+bool mmap_graph_t::has_previous_step(const step_handle_t& step_handle) const {
+    const uint64_t path_idx = as_integers(step_handle)[0] - 1;
+    const uint64_t rank = as_integers(step_handle)[1];
+    return rank != std::numeric_limits<uint64_t>::max()
+        && (rank > 0 || (path_circular[path_idx] && step_count_of(path_idx) > 0));
+}
+
+step_handle_t mmap_graph_t::get_next_step(const step_handle_t& step_handle) const {
+    step_handle_t next = step_handle;
+    const uint64_t path_idx = as_integers(step_handle)[0] - 1;
+    const uint64_t count = step_count_of(path_idx);
+    uint64_t& rank = as_integers(next)[1];
+    if (rank == std::numeric_limits<uint64_t>::max()) {
+        rank = 0;
+    } else if (path_circular[path_idx] && rank + 1 == count) {
+        rank = 0;
+    } else if (rank < count) {
+        ++rank;
+    }
+    return next;
+}
+
+step_handle_t mmap_graph_t::get_previous_step(const step_handle_t& step_handle) const {
+    step_handle_t prev = step_handle;
+    const uint64_t path_idx = as_integers(step_handle)[0] - 1;
+    uint64_t& rank = as_integers(prev)[1];
+    if (rank == 0) {
+        // the first step of a circular path is preceded by its last
+        rank = path_circular[path_idx] ? step_count_of(path_idx) - 1 : std::numeric_limits<uint64_t>::max();
+    } else if (rank != std::numeric_limits<uint64_t>::max()) {
+        --rank;
+    }
+    return prev;
+}
+
+size_t mmap_graph_t::get_ordinal_rank_of_step(const step_handle_t& step_handle) const {
+    return as_integers(step_handle)[1];
+}
+
+void mmap_graph_t::for_each_step_in_path(const path_handle_t& path, const std::function<void(const step_handle_t&)>& iteratee) const {
+    step_handle_t step;
+    as_integers(step)[0] = as_integer(path);
+    const uint64_t count = get_step_count(path);
+    for (uint64_t i = 0; i < count; ++i) {
+        as_integers(step)[1] = i;
+        iteratee(step);
+    }
+}
+
+bool mmap_graph_t::for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const {
+    for (uint64_t i = 0; i < header->path_count; ++i) {
+        if (!iteratee(as_path_handle(i + 1))) return false;
+    }
+    return true;
+}
+
+bool mmap_graph_t::for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const {
+    uint64_t rank = number_bool_packing::unpack_number(handle);
+    for (uint64_t j = node_step_offsets[rank]; j < node_step_offsets[rank + 1]; ++j) {
+        step_handle_t step;
+        as_integers(step)[0] = node_steps[2 * j] + 1;
+        as_integers(step)[1] = node_steps[2 * j + 1];
+        if (!iteratee(step)) return false;
+    }
+    return true;
+}
+
+}
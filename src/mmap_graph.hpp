@@ -0,0 +1,256 @@
+//
+//  odgi
+//
+//  mmap_graph.hpp
+//
+//  frozen, memory-mapped, read-only graph
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <functional>
+#include <handlegraph/types.hpp>
+#include <handlegraph/iteratee.hpp>
+#include <handlegraph/util.hpp>
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/path_handle_graph.hpp>
+#include "odgi.hpp"
+
+namespace odgi {
+
+using namespace handlegraph;
+
+/// Header of a frozen graph file. Every section is an 8-byte aligned array
+/// and is addressed by its byte offset from the start of the file, so that
+/// the whole structure can be used directly from a read-only mapping.
+struct frozen_graph_header_t {
+    char magic[8];
+    uint64_t version;
+    uint64_t node_slots;      // node_v.size() of the source graph, deleted slots included
+    uint64_t node_count;      // live nodes
+    uint64_t min_node_id;
+    uint64_t max_node_id;
+    uint64_t id_increment;
+    uint64_t edge_count;
+    uint64_t path_count;
+    uint64_t step_count;      // total steps over all paths
+    uint64_t seq_offsets;     // node_slots+1 x uint64, into seq
+    uint64_t seq;             // concatenated forward node sequences
+    uint64_t edge_offsets;    // 2*node_slots+1 x uint64, into edges (right side, then left side, per slot)
+    uint64_t edges;           // handles reached from the forward orientation of each slot
+    uint64_t name_offsets;    // path_count+1 x uint64, into names
+    uint64_t names;           // concatenated path names
+    uint64_t name_order;      // path_count x uint64, path indexes sorted by name
+    uint64_t path_circular;   // path_count x uint64
+    uint64_t step_offsets;    // path_count+1 x uint64, into steps
+    uint64_t steps;           // handles of all steps in path order
+    uint64_t node_step_offsets; // node_slots+1 x uint64, into node_steps
+    uint64_t node_steps;      // (path index, step rank) pairs grouped by node slot
+    uint64_t node_live;       // (node_slots+63)/64 x uint64, a bit set for each slot holding a node
+    uint64_t file_size;
+};
+
+/// A read-only PathHandleGraph over a frozen graph file. Opening it maps the
+/// file and validates the header, nothing is copied or decoded, so loading
+/// costs O(1) and the page cache is shared by every process that maps the
+/// same file. Handles are the same as in the graph_t the file was frozen
+/// from. Step handles encode the path index and the rank of the step.
+class mmap_graph_t : public PathHandleGraph {
+
+public:
+
+    mmap_graph_t(void) = default;
+    explicit mmap_graph_t(const std::string& filename);
+    ~mmap_graph_t(void);
+    mmap_graph_t(const mmap_graph_t& other) = delete;
+    mmap_graph_t& operator=(const mmap_graph_t& other) = delete;
+
+    /// Magic string at the start of every frozen graph file
+    static constexpr const char* magic_string = "ODGIFRZ1";
+    static const uint64_t format_version = 2;
+
+    /// Write the given graph to a frozen graph file
+    static void freeze(const graph_t& graph, const std::string& filename, uint64_t nthreads = 1);
+
+    /// Check if the given file starts with the frozen graph magic string
+    static bool is_frozen(const std::string& filename);
+
+    /// Map the given file, replacing any file mapped before
+    void open(const std::string& filename);
+
+    /// Unmap the file
+    void close(void);
+
+    /// Build a mutable copy of the frozen graph, adding its edges and paths in parallel
+    void thaw(graph_t& graph, uint64_t nthreads = 1) const;
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Handle graph interface
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// Method to check if a node exists by ID
+    bool has_node(nid_t node_id) const;
+
+    /// Look up the handle for the node with the given ID in the given orientation
+    handle_t get_handle(const nid_t& node_id, bool is_reverse = false) const;
+
+    /// Get the ID from a handle
+    nid_t get_id(const handle_t& handle) const;
+
+    /// Get the orientation of a handle
+    bool get_is_reverse(const handle_t& handle) const;
+
+    /// Invert the orientation of a handle (potentially without getting its ID)
+    handle_t flip(const handle_t& handle) const;
+
+    /// Get the length of a node
+    size_t get_length(const handle_t& handle) const;
+
+    /// Get the sequence of a node, presented in the handle's local forward orientation.
+    std::string get_sequence(const handle_t& handle) const;
+
+    /// Get a character of the sequence without building the whole string
+    char get_base(const handle_t& handle, size_t index) const;
+
+    /// Get a substring of the sequence without building the whole string
+    std::string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+    /// Return the number of nodes in the graph
+    size_t get_node_count(void) const;
+
+    /// Return the smallest ID in the graph
+    nid_t min_node_id(void) const;
+
+    /// Return the largest ID in the graph
+    nid_t max_node_id(void) const;
+
+    /// Get the number of edges on the given side of the handle in O(1)
+    size_t get_degree(const handle_t& handle, bool go_left) const;
+
+    /// Return the total number of edges
+    size_t get_edge_count(void) const;
+
+protected:
+
+    /// Loop over all the handles to next/previous (right/left) nodes.
+    bool follow_edges_impl(const handle_t& handle, bool go_left, const std::function<bool(const handle_t&)>& iteratee) const;
+
+    /// Loop over all the nodes in the graph in their local forward orientations.
+    bool for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel = false) const;
+
+public:
+
+    ////////////////////////////////////////////////////////////////////////////
+    // Path handle interface
+    ////////////////////////////////////////////////////////////////////////////
+
+    /// Returns the number of paths stored in the graph
+    size_t get_path_count(void) const;
+
+    /// Determine if a path name exists and is legal to get a path handle for.
+    bool has_path(const std::string& path_name) const;
+
+    /// Look up the path handle for the given path name.
+    /// The path with that name must exist.
+    path_handle_t get_path_handle(const std::string& path_name) const;
+
+    /// Look up the name of a path from a handle to it
+    std::string get_path_name(const path_handle_t& path_handle) const;
+
+    /// Look up whether a path is circular
+    bool get_is_circular(const path_handle_t& path_handle) const;
+
+    /// Returns the number of node steps in the path
+    size_t get_step_count(const path_handle_t& path_handle) const;
+
+    /// Returns the number of node steps on the handle
+    size_t get_step_count(const handle_t& handle) const;
+
+    /// Get a node handle (node ID and orientation) from a handle to a step on a path
+    handle_t get_handle_of_step(const step_handle_t& step_handle) const;
+
+    /// Returns a handle to the path that a step is on
+    path_handle_t get_path_handle_of_step(const step_handle_t& step_handle) const;
+
+    /// Get a handle to the first step
+    step_handle_t path_begin(const path_handle_t& path_handle) const;
+
+    /// Get a handle to a fictitious position past the end of a path
+    step_handle_t path_end(const path_handle_t& path_handle) const;
+
+    /// Get a handle to the last step
+    step_handle_t path_back(const path_handle_t& path_handle) const;
+
+    /// Get a handle to a fictitious position before the beginning of a path
+    step_handle_t path_front_end(const path_handle_t& path_handle) const;
+
+    /// Returns true if the step is not the last step in a non-circular path.
+    bool has_next_step(const step_handle_t& step_handle) const;
+
+    /// Returns true if the step is not the first step in a non-circular path.
+    bool has_previous_step(const step_handle_t& step_handle) const;
+
+    /// Returns a handle to the next step on the path
+    step_handle_t get_next_step(const step_handle_t& step_handle) const;
+
+    /// Returns a handle to the previous step on the path
+    step_handle_t get_previous_step(const step_handle_t& step_handle) const;
+
+    /// Returns the 0-based ordinal rank of a step on a path
+    size_t get_ordinal_rank_of_step(const step_handle_t& step_handle) const;
+
+    /// Loop over all the steps along a path, from first through last
+    void for_each_step_in_path(const path_handle_t& path, const std::function<void(const step_handle_t&)>& iteratee) const;
+
+protected:
+
+    /// Execute a function on each path in the graph
+    bool for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const;
+
+    /// Enumerate the path steps on a given handle (strand agnostic)
+    bool for_each_step_on_handle_impl(const handle_t& handle, const std::function<bool(const step_handle_t&)>& iteratee) const;
+
+private:
+
+    // the mapping
+    int fd = -1;
+    const uint8_t* data = nullptr;
+    size_t size = 0;
+    const frozen_graph_header_t* header = nullptr;
+
+    // typed views into the mapping
+    const uint64_t* seq_offsets = nullptr;
+    const char* seq = nullptr;
+    const uint64_t* edge_offsets = nullptr;
+    const uint64_t* edges = nullptr;
+    const uint64_t* name_offsets = nullptr;
+    const char* names = nullptr;
+    const uint64_t* name_order = nullptr;
+    const uint64_t* path_circular = nullptr;
+    const uint64_t* step_offsets = nullptr;
+    const uint64_t* steps = nullptr;
+    const uint64_t* node_step_offsets = nullptr;
+    const uint64_t* node_steps = nullptr;
+    const uint64_t* node_live = nullptr;
+
+    /// Does the slot hold a node? Nodes may have empty sequences, so their lengths can't tell
+    inline bool is_live(uint64_t rank) const {
+        return (node_live[rank >> 6] >> (rank & 63)) & 1;
+    }
+    inline uint64_t path_index(const path_handle_t& path) const {
+        return as_integer(path) - 1;
+    }
+    inline uint64_t step_count_of(uint64_t path_idx) const {
+        return step_offsets[path_idx+1] - step_offsets[path_idx];
+    }
+    inline std::string name_of(uint64_t path_idx) const {
+        return std::string(names + name_offsets[path_idx],
+                           name_offsets[path_idx+1] - name_offsets[path_idx]);
+    }
+    /// Find the index of a path by name, or path_count if not present
+    uint64_t find_path(const std::string& path_name) const;
+};
+
+}
@@ -1,13 +1,19 @@
 #include "node.hpp"
+#include "packed_sequence.hpp"
+
+#include <algorithm>
 
 namespace odgi {
 
 uint64_t node_t::sequence_size() const {
-    return sequence.size();
+    return packed ? packed_sequence::length(sequence) : sequence.size();
 }
 
-void node_t::set_sequence(const std::string& seq) {
-    sequence = seq;
+void node_t::set_sequence(const std::string& seq, bool compact) {
+    packed = compact && packed_sequence::pack(seq, sequence);
+    if (!packed) {
+        sequence = seq;
+    }
 }
 
 void node_t::set_id(const uint64_t& new_id) {
@@ -18,8 +24,29 @@ const uint64_t& node_t::get_id() const {
     return id;
 }
 
-const std::string& node_t::get_sequence() const {
-    return sequence;
+std::string node_t::get_sequence() const {
+    return packed ? packed_sequence::unpack(sequence) : sequence;
+}
+
+bool node_t::is_packed() const {
+    return packed;
+}
+
+char node_t::get_base(const uint64_t& i, const bool& reverse) const {
+    if (reverse) {
+        return complement[get_base(sequence_size() - i - 1, false)];
+    }
+    return packed ? packed_sequence::base(sequence, i) : sequence[i];
+}
+
+void node_t::write_sequence(const uint64_t& begin, const uint64_t& len, const bool& reverse, char* out) const {
+    if (packed) {
+        packed_sequence::unpack(sequence, begin, len, reverse, out);
+    } else if (reverse) {
+        reverse_complement(sequence.data() + sequence.size() - begin - len, len, out);
+    } else {
+        sequence.copy(out, len, begin);
+    }
 }
 
 // encode an internal representation of an external id (adding if none exists)
@@ -119,15 +146,45 @@ void node_t::add_path_step(const node_t::step_t& step) {
 }
 
 const std::vector<node_t::step_t> node_t::get_path_steps() const {
-    uint64_t n_paths = path_count();
-    if (n_paths == 0) return {};
-    std::vector<node_t::step_t> steps(n_paths);
-    for (uint64_t i = 0; i < n_paths; ++i) {
-        steps[i] = get_path_step(i);
-    }
+    std::vector<node_t::step_t> steps;
+    get_path_steps(steps);
     return steps;
 }
 
+void node_t::decode_ids(std::vector<uint64_t>& ids) const {
+    uint64_t s = decoding.size();
+    ids.resize(s);
+    for (uint64_t i = 0; i < s; ++i) {
+        ids[i] = from_delta(decoding.at(i));
+    }
+}
+
+void node_t::decode_path_steps(const uint64_t* ids, uint64_t begin, uint64_t end, step_t* out) const {
+    for (uint64_t i = PATH_RECORD_LENGTH*begin; i < PATH_RECORD_LENGTH*end; i += PATH_RECORD_LENGTH) {
+        uint64_t t = paths.at(i+1);
+        *out++ = {
+            paths.at(i),
+            step_type_helper::unpack_is_rev(t),
+            step_type_helper::unpack_is_start(t),
+            step_type_helper::unpack_is_end(t),
+            ids[paths.at(i+2)],
+            paths.at(i+3),
+            ids[paths.at(i+4)],
+            paths.at(i+5),
+        };
+    }
+}
+
+void node_t::get_path_steps(std::vector<step_t>& steps) const {
+    uint64_t n_paths = path_count();
+    steps.resize(n_paths);
+    if (n_paths == 0) return;
+    // the decoding table only holds the distinct neighbors, so we resolve it once
+    std::vector<uint64_t> ids;
+    decode_ids(ids);
+    decode_path_steps(ids.data(), 0, n_paths, steps.data());
+}
+
 const node_t::step_t node_t::get_path_step(const uint64_t& rank) const {
     if (rank >= path_count()) assert(false);
     uint64_t i = PATH_RECORD_LENGTH*rank;
@@ -151,7 +208,9 @@ void node_t::for_each_path_step(
                              bool is_rev)>& func) const {
     uint64_t n_paths = path_count();
     for (uint64_t i = 0; i < n_paths; ++i) {
-        if (!step_is_del(i) && !func(i, paths.at(PATH_RECORD_LENGTH*i), step_is_rev(i))) {
+        uint64_t t = paths.at(PATH_RECORD_LENGTH*i+1);
+        if (!step_type_helper::unpack_is_del(t)
+            && !func(i, paths.at(PATH_RECORD_LENGTH*i), step_type_helper::unpack_is_rev(t))) {
             break;
         }
     }
@@ -159,9 +218,19 @@ void node_t::for_each_path_step(
 
 void node_t::for_each_path_step(const std::function<bool(step_t step)>& func) const {
     uint64_t n_paths = path_count();
-    for (uint64_t i = 0; i < n_paths; ++i) {
-        if (!step_is_del(i) && !func(get_path_step(i))) {
-            break;
+    if (n_paths == 0) return;
+    std::vector<uint64_t> ids;
+    decode_ids(ids);
+    // decode in small batches so that we can stop early without decoding everything
+    const uint64_t batch_size = 64;
+    step_t batch[batch_size];
+    for (uint64_t i = 0; i < n_paths; i += batch_size) {
+        uint64_t end = std::min(n_paths, i + batch_size);
+        decode_path_steps(ids.data(), i, end, batch);
+        for (uint64_t j = 0; j < end - i; ++j) {
+            if (!step_is_del(i + j) && !func(batch[j])) {
+                return;
+            }
         }
     }
 }
@@ -310,6 +379,7 @@ node_t::node_t() {
 
 void node_t::clear() {
     sequence.clear(); // not sure this works
+    packed = false;
     clear_encoding();
     clear_edges();
     clear_paths();
@@ -334,6 +404,7 @@ void node_t::copy(const node_t& other) {
     clear();
     id = other.id;
     sequence = other.sequence;
+    packed = other.packed;
     edges = other.edges;
     decoding = other.decoding;
     paths = other.paths;
@@ -345,7 +416,13 @@ void node_t::apply_ordering(
     // flip the node sequence if needed
     bool flip = to_flip(id);
     if (flip) {
-        reverse_complement_in_place(sequence);
+        if (packed) {
+            std::string seq = packed_sequence::unpack(sequence);
+            reverse_complement_in_place(seq);
+            set_sequence(seq, true);
+        } else {
+            reverse_complement_in_place(sequence);
+        }
     }
     // rewrite the encoding (affects path storage)
     std::vector<uint64_t> dec_v;
@@ -417,10 +494,22 @@ void node_t::apply_path_ordering(
     }
 }
 
+bool node_t::refers_to(const std::function<bool(uint64_t)>& pred) const {
+    for (uint64_t i = 0; i < edges.size(); i += EDGE_RECORD_LENGTH) {
+        if (pred(edges.at(i))) return true;
+    }
+    for (uint64_t i = 0; i < decoding.size(); ++i) {
+        if (pred(decode(i))) return true;
+    }
+    return false;
+}
+
 uint64_t node_t::serialize(std::ostream& out) const {
     uint64_t written = 0;
     size_t seq_size = sequence.size();
-    out.write((char*)&seq_size, sizeof(size_t));
+    // packed sequences are flagged in the top bit of their stored size
+    size_t stored_size = seq_size | (packed ? packed_size_flag : 0);
+    out.write((char*)&stored_size, sizeof(size_t));
     written += sizeof(size_t);
     out.write((char*)sequence.c_str(), seq_size*sizeof(char));
     written += seq_size*sizeof(char);
@@ -435,6 +524,8 @@ uint64_t node_t::serialize(std::ostream& out) const {
 void node_t::load(std::istream& in) {
     size_t len = 0;
     in.read((char*)&len, sizeof(size_t));
+    packed = len & packed_size_flag;
+    len &= ~packed_size_flag;
     sequence.resize(len);
     in.read((char*)sequence.c_str(), len*sizeof(uint8_t));
     in.read((char*)&id, sizeof(id));
@@ -445,7 +536,7 @@ void node_t::load(std::istream& in) {
 }
 
 void node_t::display() const {
-    std::cerr << "seq " << sequence << " "
+    std::cerr << "seq " << get_sequence() << " "
               << "edge_count " << edge_count() << " "
               << "path_count " << path_count();
     std::cerr << " | ";
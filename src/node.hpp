@@ -14,6 +14,7 @@
 #include "dynamic.hpp"
 #include "varint.hpp"
 #include "dna.hpp"
+#include "spin_lock.hpp"
 
 namespace odgi {
 
@@ -21,11 +22,14 @@ using namespace handlegraph;
 //using nid_t = handlegraph::nid_t;
 const uint8_t EDGE_RECORD_LENGTH = 2;
 const uint8_t PATH_RECORD_LENGTH = 6;
+/// Set in the serialized sequence size of nodes whose sequence is packed
+const size_t packed_size_flag = (size_t)1 << 63;
 
 /// A node object with the sequence, its edge lists, and paths
 class node_t {
     uint64_t id = 0;
     std::atomic_flag lock = ATOMIC_FLAG_INIT;
+    bool packed = false; // sequence holds a packed_sequence encoding
     std::string sequence;
     dyn::hacked_vector edges;
     dyn::hacked_vector decoding;
@@ -87,11 +91,10 @@ public:
     node_t(void); // constructor
     // locking methods
     inline void get_lock(void) {
-        while (lock.test_and_set(std::memory_order_acquire))  // acquire lock
-            ; // spin
+        spin_lock::acquire(lock, spin_lock::node_lock, id);
     }
     inline void clear_lock(void) {
-        lock.clear(std::memory_order_release);
+        spin_lock::release(lock);
     }
     inline const uint64_t edge_count(void) const { return edges.size()/EDGE_RECORD_LENGTH; }
     inline const uint64_t path_count(void) const { return paths.size()/PATH_RECORD_LENGTH; }
@@ -110,8 +113,14 @@ public:
     uint64_t decode(const uint64_t& idx) const;
 
     uint64_t sequence_size(void) const;
-    const std::string& get_sequence(void) const;
-    void set_sequence(const std::string& seq);
+    std::string get_sequence(void) const;
+    /// Set the sequence, storing it 2-bit packed if compact is set and that saves memory
+    void set_sequence(const std::string& seq, bool compact = false);
+    bool is_packed(void) const;
+    /// Get a base, counted from the end and complemented if reverse is set
+    char get_base(const uint64_t& i, const bool& reverse) const;
+    /// Write len bases starting at begin, in the given orientation, to out
+    void write_sequence(const uint64_t& begin, const uint64_t& len, const bool& reverse, char* out) const;
     const uint64_t& get_id(void) const;
     void set_id(const uint64_t& new_id);
     void for_each_edge(const std::function<bool(uint64_t other_id,
@@ -133,6 +142,8 @@ public:
     void add_path_step(const node_t::step_t& step);
     const step_t get_path_step(const uint64_t& rank) const;
     const std::vector<step_t> get_path_steps(void) const;
+    /// Decode all step records into the given buffer in one pass, reusing its storage
+    void get_path_steps(std::vector<step_t>& steps) const;
     void set_path_step(const uint64_t& rank, const uint64_t& path_id, const bool& is_rev,
                        const bool& is_start, const bool& is_end,
                        const uint64_t& prev_id, const uint64_t& prev_rank,
@@ -178,6 +189,14 @@ public:
         const std::function<bool(uint64_t)>& to_flip);
     void apply_path_ordering(
         const std::function<uint64_t(uint64_t)>& get_new_path_id);
+    /// Check if pred holds for any node id referred to by our edges or path step encoding
+    bool refers_to(const std::function<bool(uint64_t)>& pred) const;
+
+private:
+    /// Resolve the whole decoding table to node ids
+    void decode_ids(std::vector<uint64_t>& ids) const;
+    /// Decode the step records [begin, end) using a resolved decoding table
+    void decode_path_steps(const uint64_t* ids, uint64_t begin, uint64_t end, step_t* out) const;
 
 };
 
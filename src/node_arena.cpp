@@ -0,0 +1,68 @@
+#include "node_arena.hpp"
+
+#include <new>
+#include <utility>
+
+namespace odgi {
+
+node_arena_t::~node_arena_t(void) {
+    clear();
+}
+
+void node_arena_t::add_slab(void) {
+    slabs.push_back(static_cast<node_t*>(::operator new(slab_size * sizeof(node_t))));
+}
+
+node_t* node_arena_t::allocate(void) {
+    if (!free_list.empty()) {
+        node_t* node = free_list.back();
+        free_list.pop_back();
+        return node;
+    }
+    if (constructed == slabs.size() * slab_size) {
+        add_slab();
+    }
+    node_t* node = slabs[constructed / slab_size] + constructed % slab_size;
+    new (node) node_t();
+    ++constructed;
+    return node;
+}
+
+void node_arena_t::release(node_t* node) {
+    // records stay constructed, but give their payloads back to the heap
+    node->clear();
+    node->set_id(0);
+    free_list.push_back(node);
+}
+
+void node_arena_t::reserve(uint64_t n) {
+    uint64_t available = slabs.size() * slab_size - constructed + free_list.size();
+    while (available < n) {
+        add_slab();
+        available += slab_size;
+    }
+}
+
+void node_arena_t::clear(void) {
+    for (uint64_t i = 0; i < constructed; ++i) {
+        (slabs[i / slab_size] + i % slab_size)->~node_t();
+    }
+    for (auto* slab : slabs) {
+        ::operator delete(slab);
+    }
+    slabs.clear();
+    free_list.clear();
+    constructed = 0;
+}
+
+uint64_t node_arena_t::size(void) const {
+    return constructed - free_list.size();
+}
+
+void node_arena_t::swap(node_arena_t& other) {
+    std::swap(slabs, other.slabs);
+    std::swap(constructed, other.constructed);
+    std::swap(free_list, other.free_list);
+}
+
+}
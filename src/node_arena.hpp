@@ -0,0 +1,64 @@
+//
+//  odgi
+//
+//  node_arena.hpp
+//
+//  slab storage for node records
+//
+
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "node.hpp"
+
+namespace odgi {
+
+/// Slab allocator for the node records of a graph. Records are constructed in
+/// place in large blocks, so they never move once created, they lie in memory
+/// in the order they were allocated, and creating a node costs no heap
+/// allocation of its own. Released records are recycled by later allocations.
+/// Not threadsafe, like the node vector that indexes into it.
+class node_arena_t {
+
+public:
+
+    node_arena_t(void) = default;
+    ~node_arena_t(void);
+    node_arena_t(const node_arena_t& other) = delete;
+    node_arena_t& operator=(const node_arena_t& other) = delete;
+
+    /// Number of records in each slab
+    static const uint64_t slab_size = 1 << 14;
+
+    /// Return an empty record
+    node_t* allocate(void);
+
+    /// Clear a record and make it available to later allocations
+    void release(node_t* node);
+
+    /// Make room for at least n more records without allocating new slabs
+    void reserve(uint64_t n);
+
+    /// Destroy all records and free all slabs
+    void clear(void);
+
+    /// Number of records currently handed out
+    uint64_t size(void) const;
+
+    /// Exchange the contents of two arenas
+    void swap(node_arena_t& other);
+
+private:
+
+    /// Raw blocks of slab_size records each
+    std::vector<node_t*> slabs;
+    /// Records constructed so far, all slabs before the last one are full
+    uint64_t constructed = 0;
+    /// Records that have been released and can be reused
+    std::vector<node_t*> free_list;
+
+    void add_slab(void);
+};
+
+}
@@ -3,6 +3,13 @@
 //
 
 #include "odgi.hpp"
+#include "ips4o.hpp"
+#include "telemetry.hpp"
+#include "external_steps.hpp"
+
+#include <charconv>
+#include <cstring>
+#include <arpa/inet.h>
 
 namespace odgi {
 
@@ -73,9 +80,54 @@ size_t graph_t::get_length(const handle_t& handle) const {
 std::string graph_t::get_sequence(const handle_t& handle) const {
     auto& node = get_node_ref(handle);
     node.get_lock();
-    auto seq = node.get_sequence();
+    std::string seq(node.sequence_size(), '\0');
+    node.write_sequence(0, seq.size(), get_is_reverse(handle), &seq[0]);
+    node.clear_lock();
+    return seq;
+}
+
+/// Get a base of a node in the handle's local forward orientation
+char graph_t::get_base(const handle_t& handle, size_t index) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    char c = node.get_base(index, get_is_reverse(handle));
     node.clear_lock();
-    return (get_is_reverse(handle) ? reverse_complement(seq) : seq);
+    return c;
+}
+
+/// Get a substring of a node's sequence in the handle's local forward orientation
+std::string graph_t::get_subsequence(const handle_t& handle, size_t index, size_t size) const {
+    auto& node = get_node_ref(handle);
+    node.get_lock();
+    uint64_t length = node.sequence_size();
+    index = std::min<uint64_t>(index, length);
+    size = std::min<uint64_t>(size, length - index);
+    std::string seq(size, '\0');
+    node.write_sequence(index, size, get_is_reverse(handle), &seq[0]);
+    node.clear_lock();
+    return seq;
+}
+
+/// Loop over the bases of a node in the handle's local forward orientation
+bool graph_t::for_each_base(const handle_t& handle, const std::function<bool(const char&)>& iteratee) const {
+    auto& node = get_node_ref(handle);
+    const bool is_rev = get_is_reverse(handle);
+    const uint64_t length = get_length(handle);
+    // decode a chunk at a time into a buffer on the stack
+    const uint64_t chunk_size = 256;
+    char chunk[chunk_size];
+    for (uint64_t i = 0; i < length; i += chunk_size) {
+        uint64_t n = std::min(chunk_size, length - i);
+        node.get_lock();
+        node.write_sequence(i, n, is_rev, chunk);
+        node.clear_lock();
+        for (uint64_t j = 0; j < n; ++j) {
+            if (!iteratee(chunk[j])) {
+                return false;
+            }
+        }
+    }
+    return true;
 }
 
 /// Loop over all the handles to next/previous (right/left) nodes. Passes
@@ -306,7 +358,7 @@ handle_t graph_t::get_handle_of_step(const step_handle_t& step_handle) const {
 path_handle_t graph_t::get_path(const step_handle_t& step_handle) const {
     auto& node = get_node_ref(get_handle_of_step(step_handle));
     node.get_lock();
-    auto p = node.get_path_step(as_integers(step_handle)[1]).path_id;
+    auto p = node.step_path_id(as_integers(step_handle)[1]);
     node.clear_lock();
     return as_path_handle(p);
 }
@@ -506,6 +558,10 @@ handle_t graph_t::create_handle(const std::string& sequence) {
 /// Create a new node with the given id and sequence, then return the handle.
 handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
     assert(sequence.size());
+    return load_node(sequence, id);
+}
+
+handle_t graph_t::load_node(const std::string& sequence, const nid_t& id) {
     assert(id > 0);
     assert(!has_node(id));
 
@@ -534,10 +590,10 @@ handle_t graph_t::create_handle(const std::string& sequence, const nid_t& id) {
         assert(deleted_nodes.count(id));
         deleted_nodes.erase(id);
     }
-    n = new node_t();
+    n = node_arena.allocate();
     auto& node = *n;
     node.set_id(id);
-    node.set_sequence(sequence);
+    node.set_sequence(sequence, _compact_sequences);
     return number_bool_packing::pack(handle_rank, 0);
 }
 
@@ -566,9 +622,21 @@ void graph_t::destroy_handle(const handle_t& handle) {
     for (auto& edge : edges_to_destroy) {
         destroy_edge(edge);
     }
+    // remember the neighbors, whose path step encodings optimize() has to clean up
+    for (auto& edge : edges_to_destroy) {
+        dirty_nodes.insert(get_id(edge.first));
+        dirty_nodes.insert(get_id(edge.second));
+    }
+    get_node_cref(handle).for_each_path_step(
+        [&](const node_t::step_t& step) {
+            dirty_nodes.insert(step.prev_id);
+            dirty_nodes.insert(step.next_id);
+            return true;
+        });
+    dirty_nodes.erase(id);
     // clear the node storage
     auto& node = node_v[number_bool_packing::unpack_number(handle)];
-    delete node;
+    node_arena.release(node);
     // remove from the graph
     node = nullptr;
     // add the index to our list of open node slots
@@ -625,7 +693,6 @@ void graph_t::create_edge(const handle_t& left_h, const handle_t& right_h) {
                            get_is_reverse(right_h),
                            false,
                            get_is_reverse(left_h));
-        left_node.clear_lock();
         // only insert the second side if it's on a different node
         if (left_rank != right_rank) {
             right_node.add_edge(get_id(left_h),
@@ -689,10 +756,9 @@ void graph_t::clear() {
     _min_node_id = 0;
     _edge_count = 0;
     deleted_nodes.clear();
-    for (auto& n : node_v) {
-        delete n;
-    }
+    dirty_nodes.clear();
     node_v.clear();
+    node_arena.clear();
     for_each_path_handle(
         [&](const path_handle_t& p) {
             // remove from both hash tables
@@ -735,7 +801,85 @@ void graph_t::swap_handles(const handle_t& a, const handle_t& b) {
 }
 
 void graph_t::optimize(bool allow_id_reassignment) {
-    apply_ordering({}, allow_id_reassignment);
+    if (deleted_nodes.empty() && dirty_nodes.empty()
+        && (!allow_id_reassignment || node_v.empty() || _min_node_id == 1)) {
+        // nothing was deleted since the graph was last compacted
+        return;
+    }
+    if (_id_increment != 0
+        || (allow_id_reassignment
+            && (double)deleted_nodes.size() > optimize_rebuild_fraction * (double)node_v.size())) {
+        // the graph is fragmented enough that we may as well rebuild all of it
+        apply_ordering({}, allow_id_reassignment);
+        return;
+    }
+
+    // the empty slots, in order
+    std::vector<uint64_t> holes(deleted_nodes.begin(), deleted_nodes.end());
+    std::sort(holes.begin(), holes.end());
+    // compacting ids shifts every node down by the number of empty slots before it
+    // deleted nodes map to 0, which drops them from the path step encodings
+    auto get_new_id =
+        [&](uint64_t id) -> uint64_t {
+            auto it = std::lower_bound(holes.begin(), holes.end(), id);
+            if (it != holes.end() && *it == id) {
+                return 0;
+            }
+            return allow_id_reassignment ? id - (it - holes.begin()) : id;
+        };
+    auto no_flip = [](uint64_t id) { return false; };
+
+    // find the nodes we have to rewrite: the ones that move, that refer to a
+    // node that moves or was deleted, or that had a neighbor deleted
+    const uint64_t first_hole = holes.empty() ? node_v.size() + 1 : holes.front();
+    std::vector<uint64_t> to_rewrite;
+    if (allow_id_reassignment && !holes.empty()) {
+        std::vector<uint8_t> rewrite(node_v.size(), 0);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(_num_threads)
+        for (uint64_t i = 0; i < node_v.size(); ++i) {
+            auto* node = node_v[i];
+            if (node != nullptr) {
+                rewrite[i] = i + 1 >= first_hole
+                    || node->refers_to([&](uint64_t other_id) { return other_id >= first_hole; });
+            }
+        }
+        for (uint64_t i = 0; i < node_v.size(); ++i) {
+            if (rewrite[i]) to_rewrite.push_back(i);
+        }
+    } else {
+        for (auto& id : dirty_nodes) {
+            if (has_node(id)) to_rewrite.push_back(get_node_rank(id));
+        }
+    }
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+    for (uint64_t i = 0; i < to_rewrite.size(); ++i) {
+        node_v[to_rewrite[i]]->apply_ordering(get_new_id, no_flip);
+    }
+
+    if (allow_id_reassignment && !holes.empty()) {
+        // the first and last steps of the paths refer to node ranks
+        auto update_step =
+            [&](std::atomic<step_handle_t>& a) {
+                step_handle_t step = a.load();
+                handle_t& h = as_handle((uint64_t&)as_integers(step)[0]);
+                h = number_bool_packing::pack(get_new_id(get_id(h)) - 1,
+                                              get_is_reverse(h));
+                a.store(step);
+            };
+        for_each_path_handle(
+            [&](const path_handle_t& path) {
+                auto& meta = get_path_metadata(path);
+                if (meta.length > 0) {
+                    update_step(meta.first);
+                    update_step(meta.last);
+                }
+            });
+        node_v.erase(std::remove(node_v.begin(), node_v.end(), nullptr), node_v.end());
+        deleted_nodes.clear();
+        _min_node_id = node_v.empty() ? 0 : 1;
+        _max_node_id = node_v.size();
+    }
+    dirty_nodes.clear();
 }
 
 bool graph_t::is_optimized(void) {
@@ -892,8 +1036,30 @@ bool graph_t::apply_ordering(const std::vector<handle_t>& order_in, bool compact
         }
         _max_node_id = new_node_v.size();
     }
+    // rebuild the node records in their new order, so that iterating over the
+    // ranks walks through the arena sequentially
+    node_arena_t new_arena;
+    new_arena.reserve(order->size());
+    std::vector<node_t*> old_node_v = new_node_v;
+    for (auto& n : new_node_v) {
+        if (n != nullptr) {
+            n = new_arena.allocate();
+        }
+    }
+#pragma omp parallel for schedule(static, 1) num_threads(_num_threads)
+    for (uint64_t i = 0; i < new_node_v.size(); ++i) {
+        if (new_node_v[i] != nullptr) {
+            new_node_v[i]->copy(*old_node_v[i]);
+            old_node_v[i]->clear();
+        }
+    }
+    node_arena.swap(new_arena);
     node_v = new_node_v;
-    deleted_nodes.clear();
+    // without compaction the empty slots stay where they were
+    if (compact_ids) {
+        deleted_nodes.clear();
+    }
+    dirty_nodes.clear();
 
     return true;
 }
@@ -983,7 +1149,7 @@ handle_t graph_t::apply_orientation(const handle_t& handle) {
     auto& node = get_node_ref(handle);
 
     // flip the node sequence
-    node.set_sequence(get_sequence(handle));
+    node.set_sequence(get_sequence(handle), _compact_sequences);
 
     // we need to flip any stored path fronts and backs as well
     std::pair<std::map<uint64_t, std::pair<uint64_t, bool>>, // path fronts
@@ -1027,7 +1193,7 @@ void graph_t::set_handle_sequence(const handle_t& handle, const std::string& seq
     assert(seq.size());
     auto& node = get_node_ref(handle);
     node.get_lock();
-    node.set_sequence(seq);
+    node.set_sequence(seq, _compact_sequences);
     node.clear_lock();
 }
 
@@ -1340,6 +1506,131 @@ step_handle_t graph_t::append_step(const path_handle_t& path, const handle_t& to
     return new_step;
 }
 
+void graph_t::append_steps(const path_handle_t& path, const std::vector<handle_t>& to_append) {
+    append_step_runs({std::make_pair(path, &to_append)}, 1);
+}
+
+void graph_t::append_steps(const std::vector<std::pair<path_handle_t, std::vector<handle_t>>>& to_append) {
+    std::vector<std::pair<path_handle_t, const std::vector<handle_t>*>> runs;
+    runs.reserve(to_append.size());
+    for (auto& run : to_append) {
+        runs.push_back(std::make_pair(run.first, &run.second));
+    }
+    append_step_runs(runs, _num_threads);
+}
+
+void graph_t::append_step_runs(const std::vector<std::pair<path_handle_t, const std::vector<handle_t>*>>& runs,
+                               const uint64_t& num_threads) {
+    // flatten the runs, remembering where each one starts
+    std::vector<uint64_t> offsets(runs.size() + 1, 0);
+    for (uint64_t i = 0; i < runs.size(); ++i) {
+        offsets[i+1] = offsets[i] + runs[i].second->size();
+    }
+    const uint64_t total = offsets.back();
+    if (total == 0) {
+        return;
+    }
+    std::vector<handle_t> handles;
+    std::vector<uint64_t> run_of;
+    handles.reserve(total);
+    run_of.reserve(total);
+    for (uint64_t i = 0; i < runs.size(); ++i) {
+        handles.insert(handles.end(), runs[i].second->begin(), runs[i].second->end());
+        run_of.resize(offsets[i+1], i);
+    }
+    // the current last step of each path, if any, which the new steps follow
+    std::vector<uint8_t> extends(runs.size(), 0);
+    std::vector<step_handle_t> prev_last(runs.size());
+    for (uint64_t i = 0; i < runs.size(); ++i) {
+        auto& p = get_path_metadata(runs[i].first);
+        if (p.length) {
+            extends[i] = 1;
+            prev_last[i] = p.last.load();
+        }
+    }
+    // group the steps by node, keeping the path order within each node
+    std::vector<std::pair<uint64_t, uint64_t>> order(total);
+    for (uint64_t g = 0; g < total; ++g) {
+        order[g] = std::make_pair(number_bool_packing::unpack_number(handles[g]), g);
+    }
+    if (num_threads > 1) {
+        ips4o::parallel::sort(order.begin(), order.end(), std::less<>(), num_threads);
+    } else {
+        std::sort(order.begin(), order.end());
+    }
+    std::vector<uint64_t> groups;
+    for (uint64_t k = 0; k < total; ++k) {
+        if (k == 0 || order[k].first != order[k-1].first) {
+            groups.push_back(k);
+        }
+    }
+    groups.push_back(total);
+    // first pass: add the step records, whose neighbours' ids are known but whose ranks aren't yet
+    std::vector<uint64_t> ranks(total);
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (uint64_t i = 0; i < groups.size() - 1; ++i) {
+        node_t& node = get_node_ref(handles[order[groups[i]].second]);
+        node.get_lock();
+        for (uint64_t k = groups[i]; k < groups[i+1]; ++k) {
+            const uint64_t g = order[k].second;
+            const uint64_t r = run_of[g];
+            const bool is_first = g == offsets[r];
+            const bool is_last = g + 1 == offsets[r+1];
+            const bool is_start = is_first && !extends[r];
+            ranks[g] = node.path_count();
+            node.add_path_step(as_integer(runs[r].first), get_is_reverse(handles[g]),
+                               is_start, is_last,
+                               is_start ? 0 : get_id(is_first ? get_handle_of_step(prev_last[r]) : handles[g-1]),
+                               is_start || !is_first ? 0 : as_integers(prev_last[r])[1],
+                               is_last ? 0 : get_id(handles[g+1]),
+                               0);
+        }
+        node.clear_lock();
+    }
+    // second pass: fill in the ranks of the neighbouring steps within each run
+#pragma omp parallel for schedule(dynamic, 256) num_threads(num_threads)
+    for (uint64_t i = 0; i < groups.size() - 1; ++i) {
+        node_t& node = get_node_ref(handles[order[groups[i]].second]);
+        node.get_lock();
+        for (uint64_t k = groups[i]; k < groups[i+1]; ++k) {
+            const uint64_t g = order[k].second;
+            const uint64_t r = run_of[g];
+            if (g != offsets[r]) {
+                node.set_step_prev_rank(ranks[g], ranks[g-1]);
+            }
+            if (g + 1 != offsets[r+1]) {
+                node.set_step_next_rank(ranks[g], ranks[g+1]);
+            }
+        }
+        node.clear_lock();
+    }
+    // finally link each run to the old end of its path and update the path metadata once
+    for (uint64_t r = 0; r < runs.size(); ++r) {
+        if (offsets[r] == offsets[r+1]) {
+            continue;
+        }
+        auto& p = get_path_metadata(runs[r].first);
+        step_handle_t first_step, last_step;
+        as_integers(first_step)[0] = as_integer(handles[offsets[r]]);
+        as_integers(first_step)[1] = ranks[offsets[r]];
+        as_integers(last_step)[0] = as_integer(handles[offsets[r+1]-1]);
+        as_integers(last_step)[1] = ranks[offsets[r+1]-1];
+        if (extends[r]) {
+            const uint64_t& last_rank = as_integers(prev_last[r])[1];
+            node_t& last_node = get_node_ref(get_handle_of_step(prev_last[r]));
+            last_node.get_lock();
+            last_node.set_step_next_id(last_rank, get_id(handles[offsets[r]]));
+            last_node.set_step_next_rank(last_rank, ranks[offsets[r]]);
+            last_node.set_step_is_end(last_rank, false);
+            last_node.clear_lock();
+        } else {
+            p.first.store(first_step);
+        }
+        p.last.store(last_step);
+        p.length += offsets[r+1] - offsets[r];
+    }
+}
+
 /// helper to handle the case where we remove an step from a given path
 /// on a node that has other steps from the same path, thus invalidating the
 /// ranks used to refer to it
@@ -1542,58 +1833,244 @@ void graph_t::display() const {
 
 }
 
-void graph_t::to_gfa(std::ostream& out, const bool& emit_node_annotation) const {
-    out << "H\tVN:Z:1.0" << std::endl;
-    // for each node
-    for_each_handle([&out,&emit_node_annotation, this](const handle_t& h) {
-            out << "S\t" << get_id(h) << "\t" << get_sequence(h);
-            if (emit_node_annotation) {
-                out << "\t"
-                << "DP:i:" << get_step_count(h) << "\t"
-                << "RC:i:" << get_step_count(h) * get_length(h);
-            }
-            out << std::endl;
+namespace {
+
+/// Nodes formatted by one task when writing GFA
+const uint64_t gfa_node_block = 1 << 14;
+/// Paths with more steps than this are streamed rather than formatted in parallel
+const uint64_t gfa_stream_steps = 1 << 20;
+/// Bytes buffered by a streamed path line between writes
+const uint64_t gfa_stream_buffer = 1 << 20;
+
+inline void append_number(std::string& buf, uint64_t n) {
+    char digits[20];
+    auto r = std::to_chars(digits, digits + sizeof(digits), n);
+    buf.append(digits, r.ptr - digits);
+}
 
-            {
+inline bool is_number(const std::string& s, uint64_t begin, uint64_t end) {
+    if (begin >= end) return false;
+    for (uint64_t i = begin; i < end; ++i) {
+        if (s[i] < '0' || s[i] > '9') return false;
+    }
+    return true;
+}
+
+/// Split a PanSN path name, sample#haplotype#contig with an optional :start-end
+/// suffix, into the leading fields of a W-line. Returns false for other names.
+bool walk_fields(const std::string& name, std::string& fields, bool& has_range) {
+    const uint64_t a = name.find('#');
+    if (a == std::string::npos) return false;
+    const uint64_t b = name.find('#', a + 1);
+    if (b == std::string::npos || name.find('#', b + 1) != std::string::npos) return false;
+    if (a == 0 || b == name.size() - 1 || !is_number(name, a + 1, b)) return false;
+    uint64_t contig_end = name.size();
+    std::string start = "0", end;
+    const uint64_t colon = name.rfind(':');
+    const uint64_t dash = name.rfind('-');
+    if (colon != std::string::npos && colon > b + 1 && dash != std::string::npos && dash > colon
+        && is_number(name, colon + 1, dash) && is_number(name, dash + 1, name.size())) {
+        contig_end = colon;
+        start = name.substr(colon + 1, dash - colon - 1);
+        end = name.substr(dash + 1);
+    }
+    has_range = !end.empty();
+    fields = name.substr(0, a) + "\t" + name.substr(a + 1, b - a - 1) + "\t"
+        + name.substr(b + 1, contig_end - b - 1) + "\t" + start + "\t" + end;
+    return true;
+}
+
+uint64_t hash_mix(uint64_t x) {
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdull;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ull;
+    x ^= x >> 33;
+    return x;
+}
+
+/// An order-dependent hash of the words and strings added to it
+class content_hash_t {
+public:
+    void add(const uint64_t& word) {
+        hash = hash_mix(hash ^ word) + ++count;
+    }
+    void add(const std::string& s) {
+        add((uint64_t)s.size());
+        uint64_t i = 0;
+        for ( ; i + 8 <= s.size(); i += 8) {
+            uint64_t word;
+            std::memcpy(&word, s.data() + i, 8);
+            add(word);
+        }
+        if (i < s.size()) {
+            uint64_t word = 0;
+            std::memcpy(&word, s.data() + i, s.size() - i);
+            add(word);
+        }
+    }
+    uint64_t digest(void) const {
+        return hash_mix(hash ^ count);
+    }
+private:
+    uint64_t hash = 0x9e3779b97f4a7c15ull;
+    uint64_t count = 0;
+};
+
+}
+
+void graph_t::to_gfa(std::ostream& out, const bool& emit_node_annotation, const bool& emit_walks) const {
+    telemetry::phase_t phase("write GFA", _num_threads);
+    phase.add_items(get_node_count());
+    out << (emit_walks ? "H\tVN:Z:1.1" : "H\tVN:Z:1.0") << std::endl;
+    const uint64_t num_threads = std::max(_num_threads, (uint64_t)1);
+    // format a block of nodes and the edges starting on them
+    auto format_nodes =
+        [&](uint64_t begin, uint64_t end, std::string& buf) {
+            for (uint64_t i = begin; i < end; ++i) {
+                if (node_v[i] == nullptr) continue;
+                const handle_t h = number_bool_packing::pack(i, false);
+                const nid_t node_id = get_id(h);
+                buf.append("S\t");
+                append_number(buf, node_id);
+                buf.push_back('\t');
+                buf.append(get_sequence(h));
+                if (emit_node_annotation) {
+                    buf.append("\tDP:i:");
+                    append_number(buf, get_step_count(h));
+                    buf.append("\tRC:i:");
+                    append_number(buf, get_step_count(h) * get_length(h));
+                }
+                buf.push_back('\n');
                 // use this direct iteration to avoid double counting edges
                 // we only consider write the edges relative to their start
-                const node_t& node = get_node_cref(h);
-                bool is_rev = get_is_reverse(h);
-                nid_t node_id = get_id(h);
-                node.for_each_edge(
+                get_node_cref(h).for_each_edge(
                     [&](nid_t other_id,
                         bool other_rev,
                         bool to_curr,
                         bool on_rev) {
                         if (!to_curr) {
-                            out << "L\t" << node_id << "\t"
-                                << (on_rev?"-":"+") << "\t"
-                                << other_id << "\t"
-                                << (other_rev?"-":"+") << "\t"
-                                << "0M" << std::endl;
+                            buf.append("L\t");
+                            append_number(buf, node_id);
+                            buf.append(on_rev ? "\t-\t" : "\t+\t");
+                            append_number(buf, other_id);
+                            buf.append(other_rev ? "\t-\t0M\n" : "\t+\t0M\n");
                         }
                         return true;
                     });
             }
-        });
-    for_each_path_handle([&out,this](const path_handle_t& p) {
-            out << "P\t" << get_path_name(p) << "\t";
-            auto& path_meta = path_metadata(p);
+        };
+    // format the steps of a path, handing the buffer to flush whenever it grows past limit
+    auto format_path =
+        [&](const path_handle_t& p, std::string& buf, uint64_t limit,
+            const std::function<void(std::string&)>& flush) {
+            std::string fields;
+            bool has_range = false;
+            if (emit_walks && !get_is_circular(p) && walk_fields(get_path_name(p), fields, has_range)) {
+                buf.append("W\t");
+                buf.append(fields);
+                if (!has_range) {
+                    // the walk covers the whole contig, whose length we need before the walk
+                    uint64_t length = 0;
+                    for_each_step_in_path(p, [&](const step_handle_t& step) {
+                            length += get_length(get_handle_of_step(step));
+                        });
+                    append_number(buf, length);
+                }
+                buf.push_back('\t');
+                for_each_step_in_path(p, [&](const step_handle_t& step) {
+                        handle_t h = get_handle_of_step(step);
+                        buf.push_back(get_is_reverse(h) ? '<' : '>');
+                        append_number(buf, get_id(h));
+                        if (buf.size() > limit) flush(buf);
+                    });
+                buf.push_back('\n');
+                return;
+            }
+            buf.append("P\t");
+            buf.append(get_path_name(p));
+            buf.push_back('\t');
             uint64_t i = 0;
-            for_each_step_in_path(p, [this,&i,&out](const step_handle_t& step) {
+            for_each_step_in_path(p, [&](const step_handle_t& step) {
                     handle_t h = get_handle_of_step(step);
-                    out << get_id(h) << (get_is_reverse(h)?"-":"+");
-                    if (has_next_step(step)) out << ",";
-                    ++i;
+                    if (i++) buf.push_back(',');
+                    append_number(buf, get_id(h));
+                    buf.push_back(get_is_reverse(h) ? '-' : '+');
+                    if (buf.size() > limit) flush(buf);
                 });
-            out << "\t" << "*"; // always put at least a "*" in the overlaps field
+            if (i > 0 && has_next_step(path_back(p))) {
+                // as written before, the last step of a path that goes on, as a circular one can, keeps its comma
+                buf.push_back(',');
+            }
+            buf.append("\t*"); // always put at least a "*" in the overlaps field
             if (get_is_circular(p)) {
-                out << "\t" << "TP:Z:circular";
+                buf.append("\tTP:Z:circular");
             }
-            assert(i == path_meta.length);
-            //out << "\t" << "steps:i:" << path_meta.length;
-            out << std::endl;
-        });
+            assert(i == path_metadata(p).length);
+            buf.push_back('\n');
+        };
+
+    // nodes and edges: rounds of blocks formatted in parallel and written in order
+    {
+        const uint64_t blocks = (node_v.size() + gfa_node_block - 1) / gfa_node_block;
+        const uint64_t round = num_threads * 4;
+        std::vector<std::string> bufs(std::min(round, blocks));
+        for (uint64_t first = 0; first < blocks; first += round) {
+            const uint64_t n = std::min(round, blocks - first);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+            for (uint64_t b = 0; b < n; ++b) {
+                bufs[b].clear();
+                const uint64_t begin = (first + b) * gfa_node_block;
+                format_nodes(begin, std::min(begin + gfa_node_block, (uint64_t)node_v.size()), bufs[b]);
+            }
+            for (uint64_t b = 0; b < n; ++b) {
+                out.write(bufs[b].data(), bufs[b].size());
+            }
+        }
+    }
+
+    // paths: runs of short paths formatted in parallel, long paths streamed through a fixed buffer
+    {
+        std::vector<path_handle_t> paths;
+        for_each_path_handle([&](const path_handle_t& p) { paths.push_back(p); });
+        std::vector<std::string> bufs;
+        auto no_flush = [](std::string&) {};
+        auto write_flush = [&](std::string& buf) {
+            out.write(buf.data(), buf.size());
+            buf.clear();
+        };
+        uint64_t i = 0;
+        while (i < paths.size()) {
+            // gather short paths up to a step budget
+            uint64_t j = i;
+            uint64_t steps = 0;
+            while (j < paths.size()
+                   && path_metadata(paths[j]).length <= gfa_stream_steps
+                   && steps < num_threads * gfa_stream_steps
+                   && j - i < num_threads * 64) {
+                steps += path_metadata(paths[j]).length;
+                ++j;
+            }
+            if (j > i) {
+                bufs.resize(std::max(bufs.size(), (size_t)(j - i)));
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+                for (uint64_t k = i; k < j; ++k) {
+                    bufs[k - i].clear();
+                    format_path(paths[k], bufs[k - i], std::numeric_limits<uint64_t>::max(), no_flush);
+                }
+                for (uint64_t k = i; k < j; ++k) {
+                    out.write(bufs[k - i].data(), bufs[k - i].size());
+                }
+                i = j;
+            } else {
+                std::string buf;
+                buf.reserve(gfa_stream_buffer + 64);
+                format_path(paths[i], buf, gfa_stream_buffer, write_flush);
+                write_flush(buf);
+                ++i;
+            }
+        }
+    }
 }
 
 uint32_t graph_t::get_magic_number() const {
@@ -1601,8 +2078,100 @@ uint32_t graph_t::get_magic_number() const {
 }
 
 void graph_t::serialize_members(std::ostream& out) const {
+    serialize_members(out, nullptr);
+}
+
+uint64_t graph_t::fingerprint(void) const {
+    // nodes and paths are hashed in parallel and their hashes combined in order, so
+    // the fingerprint depends on what the graph holds, not on how many threads we use
+    const uint64_t node_count = node_v.size();
+    std::vector<uint64_t> node_hashes(node_count, 0);
+#pragma omp parallel for schedule(dynamic, 4096) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_count; ++i) {
+        if (node_v[i] == nullptr) {
+            continue;
+        }
+        const handle_t h = number_bool_packing::pack(i, false);
+        content_hash_t hash;
+        hash.add((uint64_t)get_id(h));
+        hash.add(get_sequence(h));
+        for (const bool go_left : {false, true}) {
+            hash.add((uint64_t)go_left);
+            follow_edges(h, go_left, [&](const handle_t& next) {
+                hash.add(((uint64_t)get_id(next) << 1) | get_is_reverse(next));
+            });
+        }
+        // step handles carry the rank of the step on its node, which depends on the
+        // order the steps were added in, so indexes keyed on them see it here
+        for_each_step_on_handle(h, [&](const step_handle_t& step) {
+            hash.add((uint64_t)as_integers(step)[1]);
+            hash.add((uint64_t)as_integer(get_path_handle_of_step(step)));
+        });
+        node_hashes[i] = hash.digest();
+    }
+    std::vector<path_handle_t> paths;
+    for_each_path_handle([&](const path_handle_t& path) {
+        paths.push_back(path);
+    });
+    std::sort(paths.begin(), paths.end(), [](const path_handle_t& a, const path_handle_t& b) {
+        return as_integer(a) < as_integer(b);
+    });
+    std::vector<uint64_t> path_hashes(paths.size(), 0);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+    for (uint64_t k = 0; k < paths.size(); ++k) {
+        content_hash_t hash;
+        hash.add(get_path_name(paths[k]));
+        hash.add((uint64_t)get_is_circular(paths[k]));
+        for_each_step_in_path(paths[k], [&](const step_handle_t& step) {
+            const handle_t h = get_handle_of_step(step);
+            hash.add(((uint64_t)get_id(h) << 1) | get_is_reverse(h));
+        });
+        path_hashes[k] = hash.digest();
+    }
+    content_hash_t hash;
+    hash.add(node_count);
+    for (auto& node_hash : node_hashes) {
+        hash.add(node_hash);
+    }
+    hash.add((uint64_t)paths.size());
+    for (auto& path_hash : path_hashes) {
+        hash.add(path_hash);
+    }
+    return hash.digest();
+}
+
+void graph_t::serialize_external(std::ostream& out, const external_steps_t& steps) {
+    for_each_path_handle([&](const path_handle_t& path) {
+            auto& m = get_path_metadata(path);
+            m.length.store(steps.path_length(path));
+            if (m.length) {
+                for (auto& end : {std::make_pair(&m.first, steps.path_front(path)),
+                                  std::make_pair(&m.last, steps.path_back(path))}) {
+                    step_handle_t step;
+                    as_integers(step)[0] = as_integer(get_handle(end.second.id, end.second.is_rev));
+                    as_integers(step)[1] = end.second.rank;
+                    end.first->store(step);
+                }
+            }
+        });
+    // the same header as SerializableHandleGraph::serialize writes
+    uint32_t magic_number = htonl(get_magic_number());
+    out.write((char*)&magic_number, sizeof(magic_number));
+    serialize_members(out, &steps);
+}
+
+void graph_t::serialize_members(std::ostream& out, const external_steps_t* steps) const {
     //rebuild_id_handle_mapping();
+    telemetry::phase_t phase("serialize graph", _num_threads);
+    phase.add_items(get_node_count());
     uint64_t written = 0;
+    // versioned layouts start with a marker that can't be a valid _max_node_id
+    uint64_t marker = serialization_marker;
+    out.write((char*)&marker,sizeof(marker));
+    written += sizeof(marker);
+    uint64_t version = serialization_version;
+    out.write((char*)&version,sizeof(version));
+    written += sizeof(version);
     out.write((char*)&_max_node_id,sizeof(_max_node_id));
     written += sizeof(_max_node_id);
     out.write((char*)&_min_node_id,sizeof(_min_node_id));
@@ -1618,41 +2187,93 @@ void graph_t::serialize_members(std::ostream& out) const {
     written += sizeof(_path_handle_next);
     out.write((char*)&_id_increment,sizeof(_id_increment));
     written += sizeof(_id_increment);
-    //assert(node_count == node_v.size());
-    // hack
-    // todo big mess, middle of removal of deleted node bv
+    uint64_t block_size = serialization_block_size;
+    out.write((char*)&block_size,sizeof(block_size));
+    written += sizeof(block_size);
+    uint64_t flags = _compact_sequences ? serialization_flag_compact_sequences : 0;
+    out.write((char*)&flags,sizeof(flags));
+    written += sizeof(flags);
+    // nodes are written in blocks of block_size records, serialized in parallel
+    // a group of blocks at a time, each group preceded by its block offset table
+    const uint64_t block_count = (node_count + block_size - 1) / block_size;
+    // the group size is stored, since readers may use other thread counts than we do
+    uint64_t group_size = 4 * std::max(_num_threads, (uint64_t)1);
+    out.write((char*)&group_size,sizeof(group_size));
+    written += sizeof(group_size);
     node_t empty_node;
-    for (auto& node : node_v) {
-        // check if node is null
-        if (node == nullptr) {
-            written += empty_node.serialize(out);
-        } else {
-            written += node->serialize(out);
+    for (uint64_t first = 0; first < block_count; first += group_size) {
+        const uint64_t n_blocks = std::min(group_size, block_count - first);
+        std::vector<std::string> blocks(n_blocks);
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+        for (uint64_t b = 0; b < n_blocks; ++b) {
+            std::ostringstream block;
+            const uint64_t begin = (first + b) * block_size;
+            const uint64_t end = std::min(node_count, begin + block_size);
+            for (uint64_t i = begin; i < end; ++i) {
+                // deleted nodes are stored as empty node records
+                if (node_v[i] == nullptr) {
+                    empty_node.serialize(block);
+                } else if (steps != nullptr) {
+                    node_t node;
+                    node.copy(*node_v[i]);
+                    steps->for_each_step_of_node(get_id(number_bool_packing::pack(i, false)), [&](const node_t::step_t& step) {
+                            node.add_path_step(step);
+                        });
+                    node.serialize(block);
+                } else {
+                    node_v[i]->serialize(block);
+                }
+            }
+            blocks[b] = block.str();
+        }
+        std::vector<uint64_t> offsets(n_blocks + 1, 0);
+        for (uint64_t b = 0; b < n_blocks; ++b) {
+            offsets[b+1] = offsets[b] + blocks[b].size();
+        }
+        out.write((char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+        written += offsets.size() * sizeof(uint64_t);
+        for (auto& block : blocks) {
+            out.write(block.data(), block.size());
+            written += block.size();
         }
     }
+    serialize_path_metadata(out);
+}
+
+void graph_t::serialize_path_metadata(std::ostream& out) const {
     // there are _path_count of these to write
     uint64_t j = 0;
     for_each_path_handle(
         [&](const path_handle_t& path) {
             auto& m = path_metadata(path);
             out.write((char*)&m.length,sizeof(m.length));
-            written += sizeof(m.length);
             out.write((char*)&m.first,sizeof(m.first));
-            written += sizeof(m.first);
             out.write((char*)&m.last,sizeof(m.last));
-            written += sizeof(m.last);
             size_t k = m.name.size();
             out.write((char*)&k,sizeof(k));
-            written += sizeof(k);
             out.write((char*)m.name.c_str(),m.name.size());
-            written += k;
             ++j;
         });
     assert(j == _path_count);
 }
 
 void graph_t::deserialize_members(std::istream& in) {
-    in.read((char*)&_max_node_id,sizeof(_max_node_id));
+    telemetry::phase_t phase("deserialize graph", _num_threads);
+    uint64_t version = 0;
+    uint64_t first_word = 0;
+    in.read((char*)&first_word,sizeof(first_word));
+    if (first_word == serialization_marker) {
+        in.read((char*)&version,sizeof(version));
+        if (version > serialization_version) {
+            throw std::runtime_error("[odgi::graph_t] error: the graph was written in format version "
+                                     + std::to_string(version) + ", but this odgi only reads up to version "
+                                     + std::to_string(serialization_version) + ".");
+        }
+        in.read((char*)&_max_node_id,sizeof(_max_node_id));
+    } else {
+        // the unversioned layout starts with _max_node_id
+        _max_node_id = (nid_t)first_word;
+    }
     in.read((char*)&_min_node_id,sizeof(_min_node_id));
     uint64_t node_count = node_v.size();
     in.read((char*)&node_count,sizeof(node_count));
@@ -1661,15 +2282,51 @@ void graph_t::deserialize_members(std::istream& in) {
     in.read((char*)&_path_handle_next,sizeof(_path_handle_next));
     in.read((char*)&_id_increment,sizeof(_id_increment));
     node_v.resize(node_count,nullptr);
+    node_arena.reserve(node_count);
+    for (size_t i = 0; i < node_count; ++i) {
+        node_v[i] = node_arena.allocate();
+    }
+    if (version == 0) {
+        for (size_t i = 0; i < node_count; ++i) {
+            node_v[i]->load(in);
+        }
+    } else {
+        uint64_t block_size = 0;
+        in.read((char*)&block_size,sizeof(block_size));
+        uint64_t flags = 0;
+        in.read((char*)&flags,sizeof(flags));
+        _compact_sequences = flags & serialization_flag_compact_sequences;
+        // the writer's group size, which depends on its thread count rather than ours
+        uint64_t group_size = 0;
+        in.read((char*)&group_size,sizeof(group_size));
+        if (block_size == 0 || group_size == 0) {
+            throw std::runtime_error("[odgi::graph_t] error: the graph has an empty node block layout.");
+        }
+        const uint64_t block_count = (node_count + block_size - 1) / block_size;
+        for (uint64_t first = 0; first < block_count; first += group_size) {
+            const uint64_t n_blocks = std::min(group_size, block_count - first);
+            std::vector<uint64_t> offsets(n_blocks + 1);
+            in.read((char*)offsets.data(), offsets.size() * sizeof(uint64_t));
+            std::string buffer(offsets.back(), '\0');
+            in.read((char*)buffer.data(), buffer.size());
+#pragma omp parallel for schedule(dynamic, 1) num_threads(_num_threads)
+            for (uint64_t b = 0; b < n_blocks; ++b) {
+                std::istringstream block(buffer.substr(offsets[b], offsets[b+1] - offsets[b]));
+                const uint64_t begin = (first + b) * block_size;
+                const uint64_t end = std::min(node_count, begin + block_size);
+                for (uint64_t i = begin; i < end; ++i) {
+                    node_v[i]->load(block);
+                }
+            }
+        }
+    }
     for (size_t i = 0; i < node_count; ++i) {
-        node_v[i] = new node_t;
         auto& node = node_v[i];
-        node->load(in);
         if (node->get_id() == 0) {
             // detect which nodes are deleted
             // these must be the only ones with id == 0
             // they have been stored as empty node records
-            delete node;
+            node_arena.release(node);
             node = nullptr;
             deleted_nodes.insert(i+1);
         }
@@ -1689,9 +2346,25 @@ void graph_t::deserialize_members(std::istream& in) {
         path_metadata_h->Insert(as_integer(m.handle), _p);
         path_name_h->Insert(m.name, _p);
     }
+    phase.add_items(get_node_count());
 }
 
 
+void graph_t::set_compact_sequences(bool compact) {
+    _compact_sequences = compact;
+    // repack the sequences we already have
+#pragma omp parallel for schedule(dynamic, 1024) num_threads(_num_threads)
+    for (uint64_t i = 0; i < node_v.size(); ++i) {
+        if (node_v[i] != nullptr && node_v[i]->is_packed() != compact) {
+            node_v[i]->set_sequence(node_v[i]->get_sequence(), compact);
+        }
+    }
+}
+
+bool graph_t::get_compact_sequences(void) const {
+    return _compact_sequences;
+}
+
 void graph_t::set_number_of_threads(uint64_t num_threads) {
     _num_threads = num_threads;
 }
@@ -1708,11 +2381,14 @@ void graph_t::copy(const graph_t& other) {
     _path_count.store(other._path_count);
     _path_handle_next.store(other._path_handle_next);
     _id_increment.store(other._id_increment);
-    node_v.resize(other.node_v.size());
+    _compact_sequences = other._compact_sequences;
+    node_v.resize(other.node_v.size(), nullptr);
+    node_arena.reserve(other.node_arena.size());
     for (size_t i = 0; i < other.node_v.size(); ++i) {
-        node_v[i] = new node_t;
-        auto* node = node_v[i];
-        node->copy(other.get_node_cref(as_handle(i)));
+        if (other.node_v[i] != nullptr) {
+            node_v[i] = node_arena.allocate();
+            node_v[i]->copy(*other.node_v[i]);
+        }
     }
     deleted_nodes = other.deleted_nodes;
     // copy the path metadata
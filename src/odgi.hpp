@@ -11,6 +11,10 @@
 #include <cstdio>
 #include <cstdint>
 #include <vector>
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
 #include <utility>
 #include <functional>
 #include <thread>
@@ -31,6 +35,7 @@
 #include "dna.hpp"
 #include "hash_map.hpp"
 #include "node.hpp"
+#include "node_arena.hpp"
 
 #include <omp.h>
 #include "atomic_bitvector.hpp"
@@ -43,6 +48,8 @@ using namespace handlegraph;
 // Resolve ambiguous nid_t typedef by putting it in our namespace.
 using nid_t = handlegraph::nid_t;
 
+class external_steps_t;
+
 class graph_t : public MutablePathDeletableHandleGraph, public SerializableHandleGraph, public RankedHandleGraph {
 
 public:
@@ -84,6 +91,15 @@ public:
     /// Get the sequence of a node, presented in the handle's local forward orientation.
     std::string get_sequence(const handle_t& handle) const;
 
+    /// Get a base of a node without decoding the rest of its sequence
+    char get_base(const handle_t& handle, size_t index) const;
+
+    /// Get a substring of a node's sequence without decoding the rest of it
+    std::string get_subsequence(const handle_t& handle, size_t index, size_t size) const;
+
+    /// Loop over the bases of a node in the handle's orientation without allocating
+    bool for_each_base(const handle_t& handle, const std::function<bool(const char&)>& iteratee) const;
+
 protected:
     /// Loop over all the handles to next/previous (right/left) nodes. Passes
     /// them to a callback which returns false to stop iterating and true to
@@ -258,6 +274,10 @@ public:
     /// Create a new node with the given id and sequence, then return the handle.
     handle_t create_handle(const std::string& sequence, const nid_t& id);
 
+    /// Create a node with the given id and sequence as create_handle does, but allow the
+    /// sequence to be empty, as a node read from a serialized or frozen graph may be
+    handle_t load_node(const std::string& sequence, const nid_t& id);
+
     /// Remove the node belonging to the given handle and all of its edges.
     /// Does not update any stored paths.
     /// Invalidates the destroyed handle.
@@ -384,6 +404,20 @@ public:
      */
     step_handle_t append_step(const path_handle_t& path, const handle_t& to_append);
 
+    /**
+     * Append visits to the given nodes to the end of the given path, in order.
+     * Steps are grouped by node, so each node is locked twice per call however
+     * often the path visits it, and the path metadata is updated once. As with
+     * append_step, the path must not be extended by another thread meanwhile.
+     */
+    void append_steps(const path_handle_t& path, const std::vector<handle_t>& to_append);
+
+    /**
+     * Append runs of steps to several distinct paths at once. The nodes are
+     * split among the graph's threads, so no two threads contend for a lock.
+     */
+    void append_steps(const std::vector<std::pair<path_handle_t, std::vector<handle_t>>>& to_append);
+
     /**
      * Insert a visit to a node to the given path between the given steps.
      * Returns a handle to the new step on the path which is appended.
@@ -402,8 +436,12 @@ public:
     /// A helper function to visualize the state of the graph
     void display(void) const;
 
-    /// Convert to GFA (for debugging)
-    void to_gfa(std::ostream& out, const bool& emit_node_annotation = false) const;
+    /// Convert to GFA. Blocks of nodes with their edges, and runs of short paths,
+    /// are formatted in parallel with the graph's thread count and written in
+    /// graph order. Long path lines are streamed through a fixed size buffer.
+    /// With emit_walks, linear paths with PanSN names (sample#haplotype#contig,
+    /// optionally :start-end) are written as GFA 1.1 W-lines.
+    void to_gfa(std::ostream& out, const bool& emit_node_annotation = false, const bool& emit_walks = false) const;
 
     /// Magic number header for serialization
     uint32_t get_magic_number(void) const;
@@ -411,9 +449,34 @@ public:
     /// Serialize
     void serialize_members(std::ostream& out) const;
 
+    /// Hash of the graph's nodes, edges and path steps, and of the order of the steps
+    /// on each node, which changes whenever they do
+    uint64_t fingerprint(void) const;
+
+    /// Serialize as SerializableHandleGraph::serialize does, taking the path
+    /// steps and path metadata from steps, which were staged for our paths,
+    /// while our own nodes hold no steps. Steps are read from disk for one
+    /// group of node blocks at a time.
+    void serialize_external(std::ostream& out, const external_steps_t& steps);
+
     /// Load
     void deserialize_members(std::istream& in);
 
+    /// Marker that starts versioned serializations, in place of _max_node_id
+    static const uint64_t serialization_marker = std::numeric_limits<uint64_t>::max();
+    /// Current serialization format version, 0 is the unversioned layout and 1 the
+    /// blocked one, which stores its block and group sizes and the flags below
+    static const uint64_t serialization_version = 1;
+    /// Flags stored with the graph in the blocked layout
+    static const uint64_t serialization_flag_compact_sequences = 1;
+    /// Node records per block in the serialized node table
+    static const uint64_t serialization_block_size = 1 << 16;
+
+    /// Store node sequences at 2 bits per base where that saves memory, repacking existing nodes
+    void set_compact_sequences(bool compact);
+
+    bool get_compact_sequences(void) const;
+
     void set_number_of_threads(uint64_t num_threads);
 
     uint64_t get_number_of_threads();
@@ -421,6 +484,12 @@ public:
     /// copy the other graph into this one
     void copy(const graph_t& other);
 
+    /// Write the metadata of all paths
+    void serialize_path_metadata(std::ostream& out) const;
+
+    /// Serialize, filling each node's path steps in from steps if given
+    void serialize_members(std::ostream& out, const external_steps_t* steps) const;
+
 /// These are the backing data structures that we use to fulfill the above functions
 
     /// Records the handle to node_id mapping
@@ -431,16 +500,24 @@ public:
     // TODO use it in create_handle and friends
     std::atomic_flag node_lock = ATOMIC_FLAG_INIT;
     std::vector<node_t*> node_v; // not threadsafe
+    /// Backing storage for the records node_v points to
+    node_arena_t node_arena;
     node_t& get_node_ref(const handle_t& handle) const;
     const node_t& get_node_cref(const handle_t& handle) const;
     /// Mark deleted nodes here for translating graph ids into internal ranks
     //dyn::hacked_vector deleted_nodes;
     hash_set<uint64_t> deleted_nodes;
+    /// Nodes that lost a neighbor since the last optimize()
+    hash_set<uint64_t> dirty_nodes;
+    /// Fraction of empty node slots above which optimize() rebuilds the whole graph
+    /// rather than only rewriting the nodes affected by compacting the ids
+    static constexpr double optimize_rebuild_fraction = 0.2;
     /// efficient id to handle/sequence conversion
     std::atomic<nid_t> _max_node_id = 0;
     std::atomic<nid_t> _min_node_id = 0;
     std::atomic<nid_t> _id_increment = 0;
     uint64_t _num_threads = 1;
+    bool _compact_sequences = false;
 
     inline void canonicalize_edge(handle_t& left, handle_t& right) const {
         if (number_bool_packing::unpack_bit(left) && number_bool_packing::unpack_bit(right)
@@ -460,11 +537,10 @@ public:
         std::atomic<bool> is_circular;
         std::atomic_flag lock = ATOMIC_FLAG_INIT;
         inline void get_lock(void) {
-            while (lock.test_and_set(std::memory_order_acquire))  // acquire lock
-                ; // spin
+            spin_lock::acquire(lock, spin_lock::path_lock, as_integer(handle.load(std::memory_order_relaxed)));
         }
         inline void clear_lock(void) {
-            lock.clear(std::memory_order_release);
+            spin_lock::release(lock);
         }
         void copy(const path_metadata_t& other) {
             handle.store(other.handle);
@@ -509,6 +585,10 @@ public:
     /// Helper to stitch up partially built paths
     void link_steps(const step_handle_t& from, const step_handle_t& to);
 
+    /// Helper to append each run of steps to its path, using the given number of threads
+    void append_step_runs(const std::vector<std::pair<path_handle_t, const std::vector<handle_t>*>>& runs,
+                          const uint64_t& num_threads);
+
     /// Decrement the step rank references for this step
     void decrement_rank(const step_handle_t& step_handle);
 
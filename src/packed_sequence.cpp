@@ -0,0 +1,169 @@
+#include "packed_sequence.hpp"
+#include "dna.hpp"
+
+#include <cstring>
+#include <limits>
+#include <vector>
+#include <algorithm>
+
+namespace odgi {
+
+namespace packed_sequence {
+
+namespace {
+
+const uint64_t header_size = 2 * sizeof(uint32_t);
+const uint64_t run_size = 2 * sizeof(uint32_t) + 1;
+const char bases[4] = {'A', 'C', 'G', 'T'};
+
+inline int8_t code_of(char c) {
+    switch (c) {
+    case 'A': return 0;
+    case 'C': return 1;
+    case 'G': return 2;
+    case 'T': return 3;
+    default: return -1;
+    }
+}
+
+/// 4 decoded bases for every possible packed byte
+struct byte_table_t {
+    char bases[256][4];
+    byte_table_t(void) {
+        for (uint64_t b = 0; b < 256; ++b) {
+            for (uint64_t i = 0; i < 4; ++i) {
+                bases[b][i] = packed_sequence::bases[(b >> (2 * i)) & 3];
+            }
+        }
+    }
+};
+const byte_table_t byte_table;
+
+struct run_t {
+    uint32_t start;
+    uint32_t length;
+    char base;
+};
+
+inline uint32_t run_count(const std::string& packed) {
+    uint32_t n;
+    packed.copy((char*)&n, sizeof(n), sizeof(uint32_t));
+    return n;
+}
+
+inline run_t get_run(const std::string& packed, uint64_t i) {
+    run_t run;
+    const char* p = packed.data() + header_size + i * run_size;
+    std::memcpy(&run.start, p, sizeof(uint32_t));
+    std::memcpy(&run.length, p + sizeof(uint32_t), sizeof(uint32_t));
+    run.base = p[2 * sizeof(uint32_t)];
+    return run;
+}
+
+inline const uint8_t* codes(const std::string& packed) {
+    return (const uint8_t*)packed.data() + header_size + run_count(packed) * run_size;
+}
+
+}
+
+bool pack(const std::string& seq, std::string& packed) {
+    const uint64_t len = seq.size();
+    if (len <= 15 || len > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+    std::vector<run_t> runs;
+    for (uint64_t i = 0; i < len; ++i) {
+        if (code_of(seq[i]) < 0) {
+            if (!runs.empty() && runs.back().base == seq[i]
+                && runs.back().start + runs.back().length == i) {
+                ++runs.back().length;
+            } else {
+                runs.push_back({(uint32_t)i, 1, seq[i]});
+            }
+        }
+    }
+    const uint64_t size = header_size + runs.size() * run_size + (len + 3) / 4;
+    if (size >= len) {
+        return false;
+    }
+    packed.assign(size, '\0');
+    char* p = &packed[0];
+    uint32_t l = len, n = runs.size();
+    std::memcpy(p, &l, sizeof(l));
+    std::memcpy(p + sizeof(l), &n, sizeof(n));
+    p += header_size;
+    for (auto& run : runs) {
+        std::memcpy(p, &run.start, sizeof(run.start));
+        std::memcpy(p + sizeof(uint32_t), &run.length, sizeof(run.length));
+        p[2 * sizeof(uint32_t)] = run.base;
+        p += run_size;
+    }
+    uint8_t* c = (uint8_t*)p;
+    for (uint64_t i = 0; i < len; ++i) {
+        // bases covered by runs are stored as A and patched on unpacking
+        int8_t code = code_of(seq[i]);
+        c[i / 4] |= (code < 0 ? 0 : code) << (2 * (i % 4));
+    }
+    return true;
+}
+
+char base(const std::string& packed, uint64_t i) {
+    // runs are sorted by start, so we can find the one that may cover i by binary search
+    uint64_t lo = 0, hi = run_count(packed);
+    while (lo < hi) {
+        uint64_t mid = (lo + hi) / 2;
+        run_t run = get_run(packed, mid);
+        if (run.start + run.length <= i) {
+            lo = mid + 1;
+        } else if (run.start > i) {
+            hi = mid;
+        } else {
+            return run.base;
+        }
+    }
+    return bases[(codes(packed)[i / 4] >> (2 * (i % 4))) & 3];
+}
+
+void unpack(const std::string& packed, uint64_t begin, uint64_t len, bool reverse, char* out) {
+    if (reverse) {
+        // decode the mirrored range forward, then reverse complement it in place
+        begin = length(packed) - begin - len;
+    }
+    const uint8_t* c = codes(packed);
+    const uint64_t end = begin + len;
+    uint64_t i = begin;
+    char* o = out;
+    for ( ; i < end && i % 4; ++i) {
+        *o++ = bases[(c[i / 4] >> (2 * (i % 4))) & 3];
+    }
+    for ( ; i + 4 <= end; i += 4) {
+        std::memcpy(o, byte_table.bases[c[i / 4]], 4);
+        o += 4;
+    }
+    for ( ; i < end; ++i) {
+        *o++ = bases[(c[i / 4] >> (2 * (i % 4))) & 3];
+    }
+    const uint32_t n_runs = run_count(packed);
+    for (uint32_t r = 0; r < n_runs; ++r) {
+        run_t run = get_run(packed, r);
+        if (run.start >= end) break;
+        uint64_t from = std::max<uint64_t>(run.start, begin);
+        uint64_t to = std::min<uint64_t>(run.start + run.length, end);
+        if (from < to) {
+            std::memset(out + (from - begin), run.base, to - from);
+        }
+    }
+    if (reverse) {
+        reverse_complement_in_place(out, len);
+    }
+}
+
+std::string unpack(const std::string& packed) {
+    std::string seq(length(packed), '\0');
+    unpack(packed, 0, seq.size(), false, &seq[0]);
+    return seq;
+}
+
+}
+
+}
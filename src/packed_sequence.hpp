@@ -0,0 +1,49 @@
+//
+//  odgi
+//
+//  packed_sequence.hpp
+//
+//  2-bit packed node sequences
+//
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace odgi {
+
+/// Helpers for sequences stored at 2 bits per base. A packed sequence is kept
+/// in a std::string laid out as
+///   uint32 length | uint32 run count | runs | 2-bit codes
+/// where each run is a (uint32 start, uint32 length, char base) record of 9
+/// bytes covering a maximal stretch of one base that is not A, C, G or T
+/// (N, IUPAC codes, lowercase), and the codes are A=0 C=1 G=2 T=3, four to
+/// a byte, first base in the low bits.
+namespace packed_sequence {
+
+/// Pack seq into packed if that saves memory, otherwise leave packed
+/// untouched and return false. Short sequences fit in the small string
+/// buffer anyway, and sequences made mostly of runs don't pack well.
+bool pack(const std::string& seq, std::string& packed);
+
+/// Number of bases in a packed sequence
+inline uint64_t length(const std::string& packed) {
+    uint32_t len;
+    packed.copy((char*)&len, sizeof(len), 0);
+    return len;
+}
+
+/// Base at position i of a packed sequence
+char base(const std::string& packed, uint64_t i);
+
+/// Write the bases [begin, begin+len) of a packed sequence to out, or, if
+/// reverse is set, the reverse complement of that range
+void unpack(const std::string& packed, uint64_t begin, uint64_t len, bool reverse, char* out);
+
+/// Unpack the whole sequence
+std::string unpack(const std::string& packed);
+
+}
+
+}
@@ -0,0 +1,97 @@
+#include "response_cache.hpp"
+
+#include <algorithm>
+#include <functional>
+
+namespace odgi {
+
+namespace {
+
+/// bookkeeping of an entry, beyond its strings, so that many small answers still count
+const uint64_t entry_overhead_bytes = 64;
+
+}
+
+response_cache_t::response_cache_t(uint64_t max_bytes, uint64_t shard_count)
+    : max_bytes(max_bytes),
+      shard_max_bytes(max_bytes / std::max(shard_count, (uint64_t)1)),
+      shards(std::max(shard_count, (uint64_t)1)) { }
+
+response_cache_t::shard_t& response_cache_t::shard_of(const std::string& key) {
+    return shards[std::hash<std::string>()(key) % shards.size()];
+}
+
+std::shared_ptr<const cached_response_t> response_cache_t::get(const std::string& key) {
+    shard_t& shard = shard_of(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto f = shard.by_key.find(key);
+    if (f == shard.by_key.end()) {
+        return nullptr;
+    }
+    shard.entries.splice(shard.entries.begin(), shard.entries, f->second);
+    return f->second->response;
+}
+
+void response_cache_t::put(const std::string& key, std::shared_ptr<const cached_response_t> response) {
+    const uint64_t size = key.size() + response->body.size() + response->content_type.size() + entry_overhead_bytes;
+    shard_t& shard = shard_of(key);
+    std::lock_guard<std::mutex> guard(shard.mutex);
+    auto f = shard.by_key.find(key);
+    if (f != shard.by_key.end()) {
+        // another thread answered the same query first
+        const auto entry = f->second;
+        shard.bytes -= entry->bytes;
+        shard.by_key.erase(f);
+        shard.entries.erase(entry);
+    }
+    if (size > shard_max_bytes) {
+        return;
+    }
+    make_room(shard, size);
+    shard.entries.push_front(entry_t{key, std::move(response), size});
+    shard.by_key.emplace(shard.entries.front().key, shard.entries.begin());
+    shard.bytes += size;
+}
+
+void response_cache_t::make_room(shard_t& shard, uint64_t room) {
+    while (!shard.entries.empty() && shard.bytes + room > shard_max_bytes) {
+        auto& last = shard.entries.back();
+        shard.bytes -= last.bytes;
+        shard.by_key.erase(last.key);
+        shard.entries.pop_back();
+        ++shard.evictions;
+    }
+}
+
+uint64_t response_cache_t::get_bytes(void) const {
+    uint64_t bytes = 0;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        bytes += shard.bytes;
+    }
+    return bytes;
+}
+
+uint64_t response_cache_t::get_max_bytes(void) const {
+    return max_bytes;
+}
+
+uint64_t response_cache_t::get_entry_count(void) const {
+    uint64_t count = 0;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        count += shard.entries.size();
+    }
+    return count;
+}
+
+uint64_t response_cache_t::get_eviction_count(void) const {
+    uint64_t evictions = 0;
+    for (auto& shard : shards) {
+        std::lock_guard<std::mutex> guard(shard.mutex);
+        evictions += shard.evictions;
+    }
+    return evictions;
+}
+
+}
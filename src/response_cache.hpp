@@ -0,0 +1,77 @@
+//
+//  odgi
+//
+//  response_cache.hpp
+//
+//  answers of odgi server kept by query, up to a size in bytes
+//
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace odgi {
+
+/// A cached answer to a request
+struct cached_response_t {
+    std::string body;
+    std::string content_type;
+};
+
+/// Answers kept by a key naming their query, holding no more than a number of
+/// bytes of keys and bodies, and dropping the least recently used answers first.
+/// Answers are shared rather than copied, so a hit only holds a lock while
+/// the answer is looked up. Safe to use from several threads: keys are spread
+/// by their hash over shards, each with its own lock, its own share of the
+/// bytes and its own order of use, so that threads asking different queries
+/// rarely wait on each other.
+class response_cache_t {
+public:
+    explicit response_cache_t(uint64_t max_bytes, uint64_t shard_count = 16);
+    response_cache_t(const response_cache_t& other) = delete;
+    response_cache_t& operator=(const response_cache_t& other) = delete;
+    /// The answer kept for the key, now the most recently used, or null if none is kept
+    std::shared_ptr<const cached_response_t> get(const std::string& key);
+    /// Keep an answer for the key, dropping the least recently used ones of its shard
+    /// to make room. Answers larger than a shard's share of the bytes are not kept.
+    void put(const std::string& key, std::shared_ptr<const cached_response_t> response);
+    /// Bytes the kept answers take, counting keys, bodies and content types
+    uint64_t get_bytes(void) const;
+    /// Most bytes the kept answers may take
+    uint64_t get_max_bytes(void) const;
+    /// Number of answers kept
+    uint64_t get_entry_count(void) const;
+    /// Number of answers dropped to make room
+    uint64_t get_eviction_count(void) const;
+private:
+    struct entry_t {
+        std::string key;
+        std::shared_ptr<const cached_response_t> response;
+        uint64_t bytes = 0;
+    };
+    struct shard_t {
+        mutable std::mutex mutex;
+        uint64_t bytes = 0;
+        uint64_t evictions = 0;
+        /// most recently used first
+        std::list<entry_t> entries;
+        /// keys are views of the keys held in entries, whose nodes never move
+        std::unordered_map<std::string_view, std::list<entry_t>::iterator> by_key;
+    };
+    const uint64_t max_bytes;
+    const uint64_t shard_max_bytes;
+    std::vector<shard_t> shards;
+    /// The shard holding the key
+    shard_t& shard_of(const std::string& key);
+    /// Drop the least recently used answers of the shard until room bytes are free
+    void make_room(shard_t& shard, uint64_t room);
+};
+
+}
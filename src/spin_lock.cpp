@@ -0,0 +1,148 @@
+#include "spin_lock.hpp"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <algorithm>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+namespace odgi {
+
+namespace spin_lock {
+
+namespace {
+
+/// Pause iterations of the last backoff round before we start yielding
+const uint32_t max_backoff = 1 << 10;
+
+inline void cpu_relax(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    _mm_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield" ::: "memory");
+#endif
+}
+
+struct lock_counts_t {
+    uint64_t contended = 0;
+    uint64_t attempts = 0;
+    uint64_t yields = 0;
+};
+
+/// Counters are sharded by record so that recording rarely contends itself
+const uint64_t stats_shards = 64;
+
+struct lock_stats_t {
+    std::atomic<bool> enabled{false};
+    std::string filename;
+    std::mutex shard_mutex[stats_shards];
+    std::unordered_map<uint64_t, lock_counts_t> shard[stats_shards];
+    lock_stats_t(void) {
+        const char* f = std::getenv("ODGI_LOCK_STATS");
+        if (f != nullptr && *f != '\0') {
+            filename = f;
+            enabled.store(true);
+        }
+    }
+    ~lock_stats_t(void);
+};
+
+lock_stats_t& stats(void) {
+    static lock_stats_t s;
+    return s;
+}
+
+// make sure the environment is read, and the dump scheduled, before main runs
+const bool stats_initialized = (stats(), true);
+
+inline uint64_t stats_key(const lock_kind_t& kind, const uint64_t& id) {
+    return (id << 1) | kind;
+}
+
+void write_counts(lock_stats_t& s, const std::string& filename) {
+    std::vector<std::pair<uint64_t, lock_counts_t>> all;
+    for (uint64_t i = 0; i < stats_shards; ++i) {
+        std::lock_guard<std::mutex> guard(s.shard_mutex[i]);
+        all.insert(all.end(), s.shard[i].begin(), s.shard[i].end());
+    }
+    std::sort(all.begin(), all.end(),
+              [](const std::pair<uint64_t, lock_counts_t>& a,
+                 const std::pair<uint64_t, lock_counts_t>& b) {
+                  return a.second.contended > b.second.contended
+                      || (a.second.contended == b.second.contended && a.first < b.first);
+              });
+    std::ofstream out(filename.c_str());
+    if (!out) {
+        std::cerr << "[odgi::spin_lock] error: could not write lock statistics to " << filename << std::endl;
+        return;
+    }
+    out << "#kind\tid\tcontended\tattempts\tyields" << std::endl;
+    for (auto& p : all) {
+        out << ((p.first & 1) == path_lock ? "path" : "node") << "\t"
+            << (p.first >> 1) << "\t"
+            << p.second.contended << "\t"
+            << p.second.attempts << "\t"
+            << p.second.yields << "\n";
+    }
+}
+
+lock_stats_t::~lock_stats_t(void) {
+    if (enabled.load() && !filename.empty()) {
+        write_counts(*this, filename);
+    }
+}
+
+void record(const lock_kind_t& kind, const uint64_t& id, const uint64_t& attempts, const uint64_t& yields) {
+    auto& s = stats();
+    const uint64_t key = stats_key(kind, id);
+    const uint64_t i = (key * 0x9e3779b97f4a7c15ULL) >> 58;
+    std::lock_guard<std::mutex> guard(s.shard_mutex[i]);
+    auto& counts = s.shard[i][key];
+    ++counts.contended;
+    counts.attempts += attempts;
+    counts.yields += yields;
+}
+
+}
+
+void acquire_contended(std::atomic_flag& lock, const lock_kind_t& kind, const uint64_t& id) {
+    uint64_t attempts = 1;
+    uint64_t yields = 0;
+    uint32_t backoff = 1;
+    while (true) {
+        if (backoff < max_backoff) {
+            for (uint32_t i = 0; i < backoff; ++i) {
+                cpu_relax();
+            }
+            backoff <<= 1;
+        } else {
+            std::this_thread::yield();
+            ++yields;
+        }
+        if (!lock.test_and_set(std::memory_order_acquire)) {
+            break;
+        }
+        ++attempts;
+    }
+    if (stats().enabled.load(std::memory_order_relaxed)) {
+        record(kind, id, attempts, yields);
+    }
+}
+
+void enable_stats(bool enabled) {
+    stats().enabled.store(enabled);
+}
+
+void write_stats(const std::string& filename) {
+    write_counts(stats(), filename);
+}
+
+}
+
+}
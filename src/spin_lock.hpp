@@ -0,0 +1,58 @@
+//
+//  odgi
+//
+//  spin_lock.hpp
+//
+//  adaptive spin locks for node and path records
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace odgi {
+
+/// The one-byte locks guarding node and path records. An uncontended
+/// acquisition is a single test_and_set. Under contention we spin with
+/// exponential backoff and, once the backoff is at its ceiling, yield the
+/// core, so that oversubscribed parallel builds don't burn it spinning.
+///
+/// Setting ODGI_LOCK_STATS=FILE in the environment counts every contended
+/// acquisition per record and writes the counts, busiest first, to FILE at
+/// exit as tab separated lines of kind, id, contended acquisitions, failed
+/// attempts and yields. odgi build --lock-stats FILE does the same for the
+/// build alone.
+namespace spin_lock {
+
+/// What a lock guards, for the contention counters
+enum lock_kind_t : uint8_t {
+    node_lock = 0,
+    path_lock = 1
+};
+
+/// Slow path of acquire: back off until the lock is free
+void acquire_contended(std::atomic_flag& lock, const lock_kind_t& kind, const uint64_t& id);
+
+/// Take the lock on the record of the given kind and id
+inline void acquire(std::atomic_flag& lock, const lock_kind_t& kind, const uint64_t& id) {
+    if (lock.test_and_set(std::memory_order_acquire)) {
+        acquire_contended(lock, kind, id);
+    }
+}
+
+/// Release the lock
+inline void release(std::atomic_flag& lock) {
+    lock.clear(std::memory_order_release);
+}
+
+/// Start, or stop, counting contended acquisitions
+void enable_stats(bool enabled = true);
+
+/// Write the counts gathered so far to filename, busiest records first
+void write_stats(const std::string& filename);
+
+}
+
+}
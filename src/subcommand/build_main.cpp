@@ -1,11 +1,15 @@
 #include "subcommand.hpp"
 #include "odgi.hpp"
 #include "gfa_to_handle.hpp"
+#include "telemetry.hpp"
+#include "external_steps.hpp"
+#include "spin_lock.hpp"
 #include "args.hxx"
 #include <cstdio>
 #include <algorithm>
 #include <filesystem>
 #include "algorithms/topological_sort.hpp"
+#include "algorithms/xp.hpp"
 
 namespace odgi {
 
@@ -24,13 +28,24 @@ int main_build(int argc, char** argv) {
     args::ArgumentParser parser("Construct a dynamic succinct variation graph in ODGI format from a GFAv1.");
     args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
     args::ValueFlag<std::string> gfa_file(mandatory_opts, "FILE", "GFAv1 FILE containing the nodes, edges and "
-                                                          "paths to build a dynamic succinct variation graph from.", {'g', "gfa"});
+                                                          "paths to build a dynamic succinct variation graph from,"
+                                                          " optionally compressed with gzip or bgzip.", {'g', "gfa"});
     args::ValueFlag<std::string> dg_out_file(mandatory_opts, "FILE", "Write the dynamic succinct variation graph to this *FILE*. A file ending with *.og* is recommended.", {'o', "out"});
     args::Group graph_sorting(parser, "[ Graph Sorting ]");
     args::Flag optimize(graph_sorting, "optimize", "Compact the graph id space into a dense integer range.", {'O', "optimize"});
     args::Flag toposort(graph_sorting, "sort", "Apply a general topological sort to the graph and order the node ids"
                                         "  accordingly. A bidirected adaptation of Kahn’s topological sort (1962)"
                                         "  is used, which can handle components with no heads or tails. Here, both heads and tails are taken into account.", {'s', "sort"});
+    args::Group storage_opts(parser, "[ Graph Storage ]");
+    args::Flag compact_sequences(storage_opts, "compact", "Store node sequences at 2 bits per base, keeping runs of N and other"
+                                                          " non-ACGT characters aside. This cuts the memory used by long node"
+                                                          " sequences about 4-fold and is kept when the graph is saved.", {'C', "compact-sequences"});
+    args::Flag external_memory(storage_opts, "external", "Keep the path steps on disk while building. Steps are sorted in"
+                                                         " memory-mapped files and written to the graph one block of nodes"
+                                                         " at a time, so only the nodes and edges have to fit in memory."
+                                                         " Can't be combined with -O, --optimize or -s, --sort.", {'X', "external-memory"});
+    args::ValueFlag<std::string> tmp_base(storage_opts, "PATH", "Directory for the temporary files of -X, --external-memory"
+                                                                 " (default: the current working directory).", {'T', "temp-dir"});
     args::Group threading(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
     args::Group processing_information(parser, "[ Processing Information ]");
@@ -38,6 +53,8 @@ int main_build(int argc, char** argv) {
     args::Flag debug(processing_information, "debug", "Verbosely print graph information to stderr. This includes the maximum"
                                                       "  node_id, the minimum node_id, the handle to node_id mapping, the"
                                                       "  deleted nodes and the path metadata.", {'d', "debug"});
+    args::ValueFlag<std::string> lock_stats(processing_information, "FILE", "Count the contended acquisitions of each node"
+                                            " and path lock while building, and write them to *FILE*, busiest first.", {"lock-stats"});
     args::Group program_information(parser, "[ Program Information ]");
     args::HelpFlag help(program_information, "help", "Print a help message for odgi build.", {'h', "help"});
     try {
@@ -56,6 +73,7 @@ int main_build(int argc, char** argv) {
     }
 
     graph_t graph;
+    telemetry::set_threads(args::get(nthreads) ? args::get(nthreads) : 1);
     
     //make_graph();
     assert(argc > 0);
@@ -67,6 +85,26 @@ int main_build(int argc, char** argv) {
         std::cerr << "[odgi::build] error: please specify an output file to store the graph via -o=[FILE], --out=[FILE]." << std::endl;
         return 1;
     }
+    if (args::get(external_memory) && (args::get(optimize) || args::get(toposort))) {
+        std::cerr << "[odgi::build] error: -X, --external-memory builds can't be optimized or sorted, as the path steps"
+                     " are written straight to the output. Please run odgi sort on the built graph instead." << std::endl;
+        return 1;
+    }
+    const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
+    if (lock_stats) {
+        spin_lock::enable_stats();
+    }
+    std::unique_ptr<external_steps_t> external_steps;
+    std::string external_base;
+    if (args::get(external_memory)) {
+        if (tmp_base) {
+            xp::temp_file::set_dir(args::get(tmp_base));
+        } else {
+            xp::temp_file::set_dir(std::filesystem::current_path().string());
+        }
+        external_base = xp::temp_file::create("odgi-build");
+        external_steps = std::make_unique<external_steps_t>(external_base, num_threads);
+    }
     {
         const std::string gfa_filename = args::get(gfa_file);
         if (!std::filesystem::exists(gfa_filename)) {
@@ -74,14 +112,24 @@ int main_build(int argc, char** argv) {
             return 1;
         }
         if (!gfa_filename.empty()) {
-            gfa_to_handle(gfa_filename, &graph, args::get(optimize), args::get(nthreads), args::get(progress));
+            graph.set_compact_sequences(args::get(compact_sequences));
+            gfa_to_handle(gfa_filename, &graph, args::get(optimize), args::get(nthreads), args::get(progress),
+                          external_steps.get());
         }
     }
 
-    const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
     graph.set_number_of_threads(num_threads);
+    if (external_steps) {
+        telemetry::phase_t phase("index external steps", num_threads);
+        phase.add_items(external_steps->step_count());
+        if (args::get(progress)) {
+            std::cerr << "[odgi::build] sorting " << external_steps->step_count() << " path steps on disk" << std::endl;
+        }
+        external_steps->index();
+    }
 
     if (args::get(toposort)) {
+        telemetry::phase_t phase("toposort", num_threads);
         graph.apply_ordering(algorithms::topological_order(&graph, true, args::get(progress)), true);
     }
     // here we should measure memory usage etc.
@@ -91,13 +139,28 @@ int main_build(int argc, char** argv) {
     const std::string outfile = args::get(dg_out_file);
     if (!outfile.empty()) {
         if (outfile == "-") {
-            graph.serialize(std::cout);
+            if (external_steps) {
+                graph.serialize_external(std::cout, *external_steps);
+            } else {
+                graph.serialize(std::cout);
+            }
         } else {
             ofstream f(outfile.c_str());
-            graph.serialize(f);
+            if (external_steps) {
+                graph.serialize_external(f, *external_steps);
+            } else {
+                graph.serialize(f);
+            }
             f.close();
         }
     }
+    if (external_steps) {
+        external_steps.reset();
+        xp::temp_file::remove(external_base);
+    }
+    if (lock_stats) {
+        spin_lock::write_stats(args::get(lock_stats));
+    }
     return 0;
 }
 
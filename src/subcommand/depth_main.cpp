@@ -6,6 +6,7 @@
 #include "algorithms/bfs.hpp"
 #include "algorithms/depth.hpp"
 #include "algorithms/path_length.hpp"
+#include "algorithms/path_range_index.hpp"
 #include <omp.h>
 
 #include "src/algorithms/subgraph/extract.hpp"
@@ -138,16 +139,12 @@ namespace odgi {
 
 		const uint64_t num_threads = args::get(_num_threads) ? args::get(_num_threads) : 1;
 
-		odgi::graph_t graph;
+		odgi::graph_t loaded_graph;
+		std::unique_ptr<odgi::mmap_graph_t> frozen_graph;
         assert(argc > 0);
-        if (!args::get(og_file).empty()) {
-            const std::string infile = args::get(og_file);
-            if (infile == "-") {
-                graph.deserialize(std::cin);
-            } else {
-				utils::handle_gfa_odgi_input(infile, "depth", args::get(progress), num_threads, graph);
-            }
-        }
+        // we only read the graph, so a frozen one is used straight from its mapping
+        const PathHandleGraph& graph = utils::handle_read_only_input(args::get(og_file), "depth", args::get(progress),
+                                                                     num_threads, loaded_graph, frozen_graph);
 
         omp_set_num_threads((int) num_threads);
 		const uint64_t shift = graph.min_node_id();
@@ -183,7 +180,7 @@ namespace odgi {
         std::vector<odgi::path_pos_t> path_positions;
         std::vector<odgi::path_range_t> path_ranges;
 
-        auto add_graph_pos = [&graph_positions](const odgi::graph_t &graph,
+        auto add_graph_pos = [&graph_positions](const PathHandleGraph &graph,
                                                 const std::string &buffer) {
             auto vals = split(buffer, ',');
             /*
@@ -215,7 +212,7 @@ namespace odgi {
             graph_positions.push_back(make_pos_t(id, is_rev, offset));
         };
 
-        auto add_path_pos = [&path_positions](const odgi::graph_t &graph,
+        auto add_path_pos = [&path_positions](const PathHandleGraph &graph,
                                               const std::string &buffer) {
             if (!buffer.empty()) {
                 auto vals = split(buffer, ',');
@@ -366,18 +363,14 @@ namespace odgi {
                     [&](const path_handle_t &path) { add_bed_range(path_ranges, graph, graph.get_path_name(path)); });
         }
 
-        auto get_graph_pos = [](const odgi::graph_t &graph,
-                                const path_pos_t &pos) {
-            const auto path_end = graph.path_end(pos.path);
-            uint64_t walked = 0;
-            for (step_handle_t s = graph.path_begin(pos.path);
-                 s != path_end; s = graph.get_next_step(s)) {
-                handle_t h = graph.get_handle_of_step(s);
-                uint64_t node_length = graph.get_length(h);
-                if (walked + node_length > pos.offset) {
-                    return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
-                }
-                walked += node_length;
+        algorithms::path_range_index_t range_index(graph);
+        auto get_graph_pos = [&range_index](const PathHandleGraph &graph,
+                                            const path_pos_t &pos) {
+            const uint64_t rank = range_index.get_rank(pos.path, pos.offset);
+            if (rank < range_index.get_step_count(pos.path)) {
+                handle_t h = graph.get_handle_of_step(range_index.get_step(pos.path, rank));
+                return make_pos_t(graph.get_id(h), graph.get_is_reverse(h),
+                                  pos.offset - range_index.get_offset(pos.path, rank));
             }
 
 #pragma omp critical (cout)
@@ -386,7 +379,7 @@ namespace odgi {
             return make_pos_t(0, false, 0);
         };
 
-        auto get_offset_in_path = [](const odgi::graph_t &graph,
+        auto get_offset_in_path = [](const PathHandleGraph &graph,
                                      const path_handle_t &path, const step_handle_t &target) {
             const auto path_end = graph.path_end(path);
             uint64_t walked = 0;
@@ -399,7 +392,7 @@ namespace odgi {
             return walked;
         };
 
-        auto get_graph_node_depth = [](const odgi::graph_t &graph, const nid_t node_id,
+        auto get_graph_node_depth = [](const PathHandleGraph &graph, const nid_t node_id,
                                        const std::vector<bool>& paths_to_consider) {
 
             uint64_t node_depth = 0;
@@ -413,7 +406,7 @@ namespace odgi {
                     if (paths_to_consider[
                             as_integer(graph.get_path_handle_of_step(occ))]) {
                         ++node_depth;
-                        unique_paths.insert(as_integer(graph.get_path(occ)));
+                        unique_paths.insert(as_integer(graph.get_path_handle_of_step(occ)));
                     }
                 });
 
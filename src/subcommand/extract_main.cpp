@@ -9,6 +9,7 @@
 #include "atomic_bitvector.hpp"
 #include "src/algorithms/subgraph/extract.hpp"
 #include "path_length.hpp"
+#include "algorithms/path_range_index.hpp"
 
 namespace odgi {
 
@@ -470,6 +471,8 @@ namespace odgi {
                 }
 
                 atomicbitvector::atomic_bv_t keep_bv(source.get_node_count()+1);
+                // each path is indexed by the first range on it, after which ranges are found by binary search
+                algorithms::path_range_index_t range_index(source);
 
 #pragma omp parallel for schedule(dynamic,1)
                 for (auto &path_range : path_ranges) {
@@ -487,22 +490,21 @@ namespace odgi {
                     const uint64_t start = path_range.begin.offset;
                     const uint64_t end = path_range.end.offset;
 
-                    uint64_t walked = 0;
-                    const auto path_end = source.path_end(path_handle);
-                    for (step_handle_t cur_step = source.path_begin(path_handle);
-                        cur_step != path_end && walked < end; cur_step = source.get_next_step(cur_step)) {
-                        const handle_t cur_handle = source.get_handle_of_step(cur_step);
-                        walked += source.get_length(cur_handle);
-                        if (walked > start) {
-                            keep_bv.set(source.get_id(cur_handle) - shift);
-
-                            if (first) {
-                                first = false;
-                                new_start = walked - source.get_length(cur_handle);
-                            }
+                    range_index.for_each_step_in_range(path_handle, start, end,
+                                                       [&](const step_handle_t& step, const uint64_t& offset) {
+                        keep_bv.set(source.get_id(source.get_handle_of_step(step)) - shift);
+
+                        if (first) {
+                            first = false;
+                            new_start = offset;
                         }
+                    });
+                    // the range ends with the last node starting before its end, or with the path
+                    if (end > 0) {
+                        new_end = range_index.get_offset(path_handle,
+                                                         std::min(range_index.get_rank(path_handle, end - 1) + 1,
+                                                                  range_index.get_step_count(path_handle)));
                     }
-                    new_end = walked;
 
                     // Extend path range to entirely include the first and the last node of the range.
                     // Thi is important to path names with the correct path ranges.
@@ -4,6 +4,7 @@
 #include "args.hxx"
 #include <omp.h>
 #include "algorithms/xp.hpp"
+#include "algorithms/index_cache.hpp"
 #include "algorithms/sgd_layout.hpp"
 #include "algorithms/path_sgd_layout.hpp"
 #include "algorithms/draw.hpp"
@@ -34,6 +35,8 @@ int main_layout(int argc, char **argv) {
     args::ValueFlag<std::string> tsv_out_file(files_io_opts, "FILE", "Write the layout in TSV format to this FILE.", {'T', "tsv"});
     args::ValueFlag<std::string> xp_in_file(files_io_opts, "FILE", "Load the path index from this FILE so that it does not have to be created for the layout calculation.", {'X', "path-index"});
     args::ValueFlag<std::string> tmp_base(files_io_opts, "PATH", "directory for temporary files", {'C', "temp-dir"});
+    args::ValueFlag<uint64_t> xp_memory(files_io_opts, "N", "Build the path index in memory, without temporary files, when it is estimated to need at most N MiB (default: a quarter of the physical memory).", {"xp-memory"});
+    args::ValueFlag<std::string> index_cache_dir(files_io_opts, "DIR", "Keep the path index built for the input graph in the cache directory *DIR*, and reuse it on later runs while the graph is unchanged.", {"index-cache"});
     /// Path-guided-2D-SGD parameters
     args::ValueFlag<std::string> p_sgd_in_file(files_io_opts, "FILE",
                                                "Specify a line separated list of paths to sample from for the on the fly term generation process in the path guided 2D SGD (default: sample from all paths).",
@@ -144,6 +147,9 @@ int main_layout(int argc, char **argv) {
         getcwd(cwd, sizeof(cwd));
         xp::temp_file::set_dir(std::string(cwd));
     }
+    if (xp_memory) {
+        xp::set_memory_budget(args::get(xp_memory) << 20);
+    }
 
     if (!graph.is_optimized()) {
 		std::cerr << "[odgi::layout] error: the graph is not optimized. Please run 'odgi sort' using -O, --optimize." << std::endl;
@@ -223,7 +229,11 @@ int main_layout(int argc, char **argv) {
         path_index.load(in);
         in.close();
     } else {
-        path_index.from_handle_graph(graph, num_threads);
+        std::unique_ptr<algorithms::index_cache_t> index_cache;
+        if (index_cache_dir) {
+            index_cache = std::make_unique<algorithms::index_cache_t>(args::get(index_cache_dir), args::get(dg_in_file));
+        }
+        algorithms::cached_path_index(index_cache.get(), graph, path_index, num_threads, args::get(progress));
     }
     // do we only want so sample from a subset of paths?
     if (p_sgd_in_file) {
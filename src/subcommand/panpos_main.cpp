@@ -59,10 +59,8 @@ namespace odgi {
 			std::cerr << "[odgi::" << "panpos" << "] error: the given file \"" << args::get(dg_in_file) << "\" does not exist. Please specify an existing input file in xp format via -i=[FILE], --idx=[FILE]." << std::endl;
 			return 1;
 		}
-        std::ifstream in;
-        in.open(args::get(dg_in_file));
-        path_index.load(in);
-        in.close();
+        // paths are mapped from the file and only loaded once they are queried
+        path_index.load(args::get(dg_in_file));
 
         // we have a 0-based positioning
         const uint64_t nucleotide_pos = args::get(nuc_pos) - 1;
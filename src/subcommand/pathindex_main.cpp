@@ -22,6 +22,8 @@ namespace odgi {
         args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
         args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph in ODGI format from this *FILE*. The file name usually ends with *.og*.", {'i', "idx"});
         args::ValueFlag<std::string> idx_out_file(mandatory_opts, "FILE", "Write the succinct variation graph index to this FILE. A file ending with *.xp* is recommended.", {'o', "out"});
+        args::Group index_opts(parser, "[ Index Construction ]");
+        args::ValueFlag<std::uint64_t> xp_memory(index_opts, "N", "Build the path index in memory, without temporary files, when it is estimated to need at most N MiB (default: a quarter of the physical memory).", {"xp-memory"});
         args::Group threading_opts(parser, "[ Threading ]");
         args::ValueFlag<std::uint64_t> nthreads(threading_opts, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -73,6 +75,9 @@ namespace odgi {
             }
         }
 
+        if (xp_memory) {
+            set_memory_budget(args::get(xp_memory) << 20);
+        }
         XP path_index;
         path_index.from_handle_graph(graph, num_threads);
 		if (progress) {
@@ -6,6 +6,7 @@
 #include <omp.h>
 #include "utils.hpp"
 #include "algorithms/path_keep.hpp"
+#include "mmap_graph.hpp"
 
 namespace odgi {
 
@@ -28,6 +29,41 @@ bool isValid(const std::string& levels, double max_val) {
     return true;
 }
 
+static void list_paths(const PathHandleGraph& graph, bool with_start_end, uint64_t num_threads) {
+    if (with_start_end) {
+        std::vector<path_handle_t> paths;
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            paths.push_back(p);
+        });
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (auto path : paths) {
+            uint64_t path_len = 0;
+            graph.for_each_step_in_path(path, [&](const step_handle_t& s) {
+                handle_t h = graph.get_handle_of_step(s);
+                path_len += graph.get_length(h);
+            });
+#pragma omp critical (cout)
+            std::cout << graph.get_path_name(path) << "\t" << 1 << "\t" << path_len << std::endl;
+        }
+    } else {
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+                std::cout << graph.get_path_name(p) << std::endl;
+            });
+    }
+}
+
+static void write_paths_fasta(const PathHandleGraph& graph) {
+    graph.for_each_path_handle(
+        [&](const path_handle_t& p) {
+            std::cout << ">" << graph.get_path_name(p) << std::endl;
+            graph.for_each_step_in_path(
+                p, [&](const step_handle_t& s) {
+                       std::cout << graph.get_sequence(graph.get_handle_of_step(s));
+                   });
+            std::cout << std::endl;
+        });
+}
+
 int main_paths(int argc, char** argv) {
 
     // trick argumentparser to do the right thing with the subcommand
@@ -152,9 +188,23 @@ int main_paths(int argc, char** argv) {
 	const uint64_t num_threads = args::get(threads) ? args::get(threads) : 1;
     omp_set_num_threads(num_threads);
 
+    std::string infile = args::get(dg_in_file);
+    if (infile != "-" && utils::is_frozen_graph(infile)
+        && !haplo_matrix && !overlaps_file && !non_reference_nodes && !non_reference_ranges
+        && !coverage_levels && !fraction_levels && !keep_paths_file && !drop_paths_file) {
+        // listing and FASTA output only need read access, so we work straight from the mapping
+        mmap_graph_t frozen(infile);
+        if (args::get(list_names)) {
+            list_paths(frozen, args::get(list_path_start_end), num_threads);
+        }
+        if (args::get(write_fasta)) {
+            write_paths_fasta(frozen);
+        }
+        return 0;
+    }
+
 	graph_t graph;
     assert(argc > 0);
-    std::string infile = args::get(dg_in_file);
     if (infile.size()) {
         if (infile == "-") {
             graph.deserialize(std::cin);
@@ -176,37 +226,12 @@ int main_paths(int argc, char** argv) {
         }
     }
 
-    if (list_path_start_end && list_names) {
-    	std::vector<path_handle_t> paths;
-		graph.for_each_path_handle([&](const path_handle_t& p) {
-			paths.push_back(p);
-		});
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-		for (auto path : paths) {
-			uint64_t path_len = 0;
-			graph.for_each_step_in_path(path, [&](const step_handle_t& s) {
-				handle_t h = graph.get_handle_of_step(s);
-				path_len += graph.get_length(h);
-			});
-#pragma omp critical (cout)
-			std::cout << graph.get_path_name(path) << "\t" << 1 << "\t" << path_len << std::endl;
-		}
-	} else if (args::get(list_names)) {
-        graph.for_each_path_handle([&](const path_handle_t& p) {
-                std::cout << graph.get_path_name(p) << std::endl;
-            });
+    if (args::get(list_names)) {
+        list_paths(graph, args::get(list_path_start_end), num_threads);
     }
 
     if (args::get(write_fasta)) {
-        graph.for_each_path_handle(
-            [&](const path_handle_t& p) {
-                std::cout << ">" << graph.get_path_name(p) << std::endl;
-                graph.for_each_step_in_path(
-                    p, [&](const step_handle_t& s) {
-                           std::cout << graph.get_sequence(graph.get_handle_of_step(s));
-                       });
-                std::cout << std::endl;
-            });
+        write_paths_fasta(graph);
     }
 
     const uint16_t delim_pos = path_delim_pos ? args::get(path_delim_pos) - 1 : 0;
@@ -482,11 +507,12 @@ int main_paths(int argc, char** argv) {
                 }
 
                 uint64_t n_count = 0;
-                for (auto c : graph.get_sequence(handle)) {
+                graph.for_each_base(handle, [&](const char& c) {
                     if (c == 'N' || c == 'n') { // Increment n_count if character is 'N' or 'n'
                         ++n_count;
                     }
-                }
+                    return true;
+                });
 
                 std::cout << graph.get_id(handle) << "\t" << graph.get_length(handle) << "\t" << n_count << "\t" << result << std::endl;
             }
@@ -7,7 +7,9 @@
 #include "utils.hpp"
 #include "split.hpp"
 #include "subgraph/region.hpp"
-#include "IITree.h"
+#include "algorithms/path_range_index.hpp"
+#include "algorithms/node_path_membership.hpp"
+#include "algorithms/pansn_index.hpp"
 
 namespace odgi {
 
@@ -76,19 +78,13 @@ int main_pav(int argc, char **argv) {
 
     const bool show_progress = args::get(_progress);
 
-    graph_t graph;
+    graph_t loaded_graph;
+    std::unique_ptr<mmap_graph_t> frozen_graph;
     assert(argc > 0);
-    {
-        const std::string infile = args::get(og_in_file);
-        if (!infile.empty()) {
-            if (infile == "-") {
-                graph.deserialize(std::cin);
-            } else {
-                utils::handle_gfa_odgi_input(infile, "pav", show_progress, num_threads, graph);
-            }
-        }
-    }
-    graph.set_number_of_threads(num_threads);
+    // we only read the graph, so a frozen one is used straight from its mapping
+    const PathHandleGraph& graph = utils::handle_read_only_input(args::get(og_in_file), "pav", show_progress,
+                                                                 num_threads, loaded_graph, frozen_graph);
+    loaded_graph.set_number_of_threads(num_threads);
 
     if (args::get(_binary_values) && (args::get(_binary_values) < 0 || args::get(_binary_values) > 1)) {
         std::cerr
@@ -140,34 +136,19 @@ int main_pav(int argc, char **argv) {
                         << std::endl;
                 return 1;
             }
-        } else if (_group_by_sample) {
-            graph.for_each_path_handle([&](const path_handle_t& p) {
-                auto path_name = graph.get_path_name(p);
-                // split and decide
-                const auto vals = split(path_name, '#');
-                const auto group = vals.front();
-                path_2_group[p] = group;
-                group_2_index[group] = 0;
-            });
-        } else if (_group_by_haplotype) {
-            graph.for_each_path_handle([&](const path_handle_t& p) {
-                auto path_name = graph.get_path_name(p);
-                // split and decide
-                const auto vals = split(path_name, '#');
-                if (vals.size() == 1) { // Assume ctg
-                    const auto group = vals.front();
-                    path_2_group[p] = group;
-                    group_2_index[group] = 0;
-                } else if (vals.size() == 2) { // Assume sample#ctg
-                    const auto group = vals.front();
-                    path_2_group[p] = group;
-                    group_2_index[group] = 0;
-                } else if (vals.size() == 3) { // Assume sample#hap#ctg
-                    const auto group = vals[0] + '#' + vals[1];
-                    path_2_group[p] = group;
-                    group_2_index[group] = 0;
+        } else {
+            // samples are the first level of PanSN names (sample#hap#ctg), haplotypes the second,
+            // where a sample#ctg name has no haplotype and stays with its sample
+            const odgi::algorithms::pansn_index_t pansn_index(graph, '#', 2);
+            const uint64_t level = _group_by_sample ? 0 : 1;
+            for (uint64_t group = 0; group < pansn_index.get_group_count(level); ++group) {
+                const auto& group_name = pansn_index.get_group_name(level, group);
+                const auto range = pansn_index.get_paths_of_group(level, group);
+                for (uint64_t i = range.first; i < range.second; ++i) {
+                    path_2_group[pansn_index.get_paths()[i]] = group_name;
                 }
-            });
+                group_2_index[group_name] = 0;
+            }
         }
 
         uint64_t group_index = 0;
@@ -195,73 +176,44 @@ int main_pav(int argc, char **argv) {
     std::vector<unordered_set<handle_t>> path_range_node_handles;
     path_range_node_handles.resize(path_ranges.size());
 
-    // Check the min/max coordinates for each target path
-    ska::flat_hash_map<path_handle_t, std::pair<uint64_t, uint64_t>> path_name_2_min_max;
-    for (uint64_t i = 0; i < path_ranges.size(); ++i) {
-        auto &path_range = path_ranges[i];
-        path_name_2_min_max[path_range.begin.path] = { std::numeric_limits<uint64_t>::max(), 0 };
-    }
-    for (uint64_t i = 0; i < path_ranges.size(); ++i) {
-        auto &path_range = path_ranges[i];
-        const uint64_t begin = path_range.begin.offset;
-        const uint64_t end = path_range.end.offset;
-
-        if (begin < path_name_2_min_max[path_range.begin.path].first) {
-            path_name_2_min_max[path_range.begin.path].first = begin;
-        }
-        if (end > path_name_2_min_max[path_range.begin.path].second) {
-            path_name_2_min_max[path_range.begin.path].second = end;
-        }
-    }
-
-    // Prepare target path handles to run in parallel on them
-    ska::flat_hash_map<path_handle_t, uint64_t> path_handle_2_index;
+    // Index the target paths, so that each range only visits its own steps
     std::vector<path_handle_t> path_handles;
-    path_handles.reserve(path_name_2_min_max.size());
-    uint64_t i = 0;
-    for (auto& p2mm : path_name_2_min_max) {
-        path_handles.push_back(p2mm.first);
-        path_handle_2_index[p2mm.first] = i++;
+    for (auto& path_range : path_ranges) {
+        path_handles.push_back(path_range.begin.path);
     }
-
-    // Prepare the interval trees for querying target path ranges
-    std::unique_ptr <odgi::algorithms::progress_meter::ProgressMeter> operation_progress;
+    std::sort(path_handles.begin(), path_handles.end(),
+              [](const path_handle_t& a, const path_handle_t& b) { return as_integer(a) < as_integer(b); });
+    path_handles.erase(std::unique(path_handles.begin(), path_handles.end()), path_handles.end());
     if (show_progress) {
-        std::string banner = "[odgi::pav] preparing the interval trees for querying target path ranges:";
-		operation_progress = std::make_unique<odgi::algorithms::progress_meter::ProgressMeter>(path_handles.size(), banner);
+        std::cerr << "[odgi::pav] indexing the step offsets of " << path_handles.size() << " target paths" << std::endl;
     }
-    std::vector<IITree<uint64_t, uint64_t>> trees;
-    trees.resize(path_handles.size());
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-    for (uint64_t i = 0; i < path_handles.size(); ++i) {
-        const auto& path_handle = path_handles[i];
-        const uint64_t min = path_name_2_min_max[path_handle].first;
-        const uint64_t max = path_name_2_min_max[path_handle].second;
-
-        const uint64_t index = path_handle_2_index[path_handle];
-        auto& tree = trees[index];
-
-        uint64_t walked = 0;
-        const auto path_end = graph.path_end(path_handle);
-        for (step_handle_t cur_step = graph.path_begin(path_handle);
-        cur_step != path_end && walked < max; cur_step = graph.get_next_step(cur_step)) {
-            const handle_t cur_handle = graph.get_handle_of_step(cur_step);
-            const uint64_t len_cur_handle = graph.get_length(cur_handle);
-            walked += len_cur_handle;
-            if (walked > min) {
-                tree.add(walked - len_cur_handle, walked, graph.get_id(cur_handle));
-            }
+    odgi::algorithms::path_range_index_t range_index(graph);
+    range_index.index_paths(path_handles, num_threads);
+
+    // Index the paths or groups on each node, so that ranges read them instead of the nodes' steps
+    std::vector<uint32_t> path_ranks(1, odgi::algorithms::node_path_membership_t::no_rank);
+    graph.for_each_path_handle([&](const path_handle_t& path_handle) {
+        const uint64_t i = as_integer(path_handle);
+        if (path_ranks.size() <= i) {
+            path_ranks.resize(i + 1, odgi::algorithms::node_path_membership_t::no_rank);
         }
-
-        tree.index(); // index
-
-        if (show_progress) {
-            operation_progress->increment(1);
+        if (!group_paths) {
+            path_ranks[i] = i - 1;
+        } else {
+            auto group = path_2_group.find(path_handle);
+            // paths that do not belong to any group are not counted
+            if (group != path_2_group.end()) {
+                path_ranks[i] = group_2_index[group->second];
+            }
         }
-    }
+    });
+    const uint32_t rank_count = group_paths ? group_2_index.size() : path_ranks.size() - 1;
     if (show_progress) {
-        operation_progress->finish();
+        std::cerr << "[odgi::pav] indexing the " << (group_paths ? "groups" : "paths") << " on each node" << std::endl;
     }
+    const odgi::algorithms::node_path_membership_t membership(graph, path_ranks, rank_count);
+
+    std::unique_ptr <odgi::algorithms::progress_meter::ProgressMeter> operation_progress;
     const bool emit_matrix_else_table = args::get(_matrix_output);
 
     // Emit the PAV matrix
@@ -286,7 +238,7 @@ int main_pav(int argc, char **argv) {
 
     auto print_pav_table_row = [](
             const basic_ostream<char>& stream,
-            graph_t& graph,
+            const PathHandleGraph& graph,
             const uint64_t len_unique_nodes_in_range,
             const std::vector<uint64_t>& len_unique_nodes_in_range_for_each_group,
             const std::string& group_name,
@@ -317,39 +269,23 @@ int main_pav(int argc, char **argv) {
         const uint64_t begin = path_range.begin.offset;
         const uint64_t end = path_range.end.offset;
 
-        const uint64_t index = path_handle_2_index[path_range.begin.path];
-        auto& tree = trees[index];
-
-        std::vector<size_t> node_ids_info;
-        tree.overlap(begin, end, node_ids_info); // retrieve overlaps
+        std::vector<nid_t> node_ids;
+        range_index.for_each_step_in_range(path_range.begin.path, begin, end,
+                                           [&](const step_handle_t& step, const uint64_t& offset) {
+                                               node_ids.push_back(graph.get_id(graph.get_handle_of_step(step)));
+                                           });
 
         uint64_t len_unique_nodes_in_range = 0;
-        std::vector<uint64_t> len_unique_nodes_in_range_for_each_group(
-                group_paths ? group_2_index.size() : graph.get_path_count(),
-                0);
+        std::vector<uint64_t> len_unique_nodes_in_range_for_each_group(rank_count, 0);
 
         // For each node in the range
-        for (const auto& node_id_info : node_ids_info) {
-            const auto& node_id = tree.data(node_id_info);
-            const auto& handle = graph.get_handle(node_id);
-
-            // Get paths that cross the node
-            unordered_set<uint64_t> group_ranks_on_node_handle;
-            graph.for_each_step_on_handle(handle, [&](const step_handle_t &source_step) {
-                const auto& path_handle = graph.get_path_handle_of_step(source_step);
-                // Check if the paths are grouped and there are paths that do not belong to any group
-                if (!group_paths || path_2_group.find(path_handle) != path_2_group.end()) {
-                    const uint64_t group_rank = group_paths ?
-                            group_2_index[path_2_group[path_handle]] :
-                            as_integer(path_handle) - 1;
-                    group_ranks_on_node_handle.insert(group_rank);
-                }
-            });
+        for (const auto& node_id : node_ids) {
+            const uint64_t len_handle = graph.get_length(graph.get_handle(node_id));
 
-            const uint64_t len_handle = graph.get_length(handle);
-            for (const auto& group_rank: group_ranks_on_node_handle) {
+            // Add the node to the paths or groups that cross it
+            membership.for_each_member(node_id, [&](const uint32_t& group_rank, const uint32_t& steps) {
                 len_unique_nodes_in_range_for_each_group[group_rank] += len_handle;
-            }
+            });
 
             len_unique_nodes_in_range += len_handle;
         }
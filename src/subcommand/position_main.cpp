@@ -6,6 +6,7 @@
 #include "subgraph/region.hpp"
 #include "algorithms/bfs.hpp"
 #include "algorithms/path_jaccard.hpp"
+#include "algorithms/path_range_index.hpp"
 #include <omp.h>
 #include "utils.hpp"
 #include "picosha2.h"
@@ -482,61 +483,46 @@ int main_position(int argc, char** argv) {
         lift_path_set_target.insert(as_integer(path));
     }
 
+    // paths are indexed by the first position looked up on them
+    algorithms::path_range_index_t target_range_index(target_graph);
+    algorithms::path_range_index_t source_range_index(source_graph);
     auto get_graph_pos =
         [](const odgi::graph_t& graph,
+           const algorithms::path_range_index_t& range_index,
            const path_pos_t& pos,
            step_handle_t& step) {
-            auto path_end = graph.path_end(pos.path);
-            uint64_t walked = 0;
-            for (step_handle_t s = graph.path_begin(pos.path);
-                 s != path_end; s = graph.get_next_step(s)) {
-                handle_t h = graph.get_handle_of_step(s);
-                uint64_t node_length = graph.get_length(h);
-                if (walked + node_length - 1 >= pos.offset) {
-                	step = s;
-                    return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - walked);
-                }
-                walked += node_length;
+            const uint64_t rank = range_index.get_rank(pos.path, pos.offset);
+            if (rank < range_index.get_step_count(pos.path)) {
+                step = range_index.get_step(pos.path, rank);
+                handle_t h = graph.get_handle_of_step(step);
+                return make_pos_t(graph.get_id(h), graph.get_is_reverse(h), pos.offset - range_index.get_offset(pos.path, rank));
             }
 #pragma omp critical (cout)
-            std::cerr << "[odgi::position] warning: position " << graph.get_path_name(pos.path) << ":" << pos.offset << " outside of path. Walked " << walked << std::endl;
+            std::cerr << "[odgi::position] warning: position " << graph.get_path_name(pos.path) << ":" << pos.offset << " outside of path. Walked " << range_index.get_path_length(pos.path) << std::endl;
             return make_pos_t(0, false, 0);
         };
 
 	auto get_graph_node_ids_annotation =
-			[](const odgi::graph_t& graph,
+			[&target_range_index](const odgi::graph_t& graph,
 			   const path_range_t& path_range) {
-				auto path_end = graph.path_end(path_range.begin.path);
 				std::unordered_map<uint64_t , std::set<std::string>> node_annotation_map;
-				uint64_t walked = 0;
 				uint64_t path_pos_start = path_range.begin.offset;
 				uint64_t path_pos_end = path_range.end.offset;
-				for (step_handle_t s = graph.path_begin(path_range.begin.path);
-					 s != path_end; s = graph.get_next_step(s)) {
-					handle_t h = graph.get_handle_of_step(s);
-					uint64_t nid = graph.get_id(h);
-					uint64_t node_length = graph.get_length(h);
-					uint64_t local_min_pos = walked;
-					uint64_t local_max_pos = local_min_pos + node_length - 1;
-					if ((path_pos_start >= local_min_pos && path_pos_start <= local_max_pos)
-						|| (path_pos_end <= local_max_pos && path_pos_end >= local_min_pos)
-						|| (path_pos_start <= local_min_pos && path_pos_end >= local_max_pos)) {
-						// TODO add to our hashmap of node_id -> hash_set of annotation
-						if (node_annotation_map.count(nid) == 0) {
-							std::set<std::string> anno_set;
-							anno_set.insert(path_range.data);
-							node_annotation_map[nid] = anno_set;
-							// we just blindly at the value again
-						} else {
-							std::set<std::string> anno_set = node_annotation_map[nid];
-							anno_set.insert(path_range.data);
-						}
-					} else if (local_min_pos > path_pos_end) {
-						// we can return here, nothing more to do
-						return node_annotation_map;
+				// the nodes overlapping the range, including its end position
+				target_range_index.for_each_step_in_range(path_range.begin.path, path_pos_start, path_pos_end + 1,
+														  [&](const step_handle_t& s, const uint64_t& offset) {
+					uint64_t nid = graph.get_id(graph.get_handle_of_step(s));
+					// TODO add to our hashmap of node_id -> hash_set of annotation
+					if (node_annotation_map.count(nid) == 0) {
+						std::set<std::string> anno_set;
+						anno_set.insert(path_range.data);
+						node_annotation_map[nid] = anno_set;
+						// we just blindly at the value again
+					} else {
+						std::set<std::string> anno_set = node_annotation_map[nid];
+						anno_set.insert(path_range.data);
 					}
-					walked += node_length;
-				}
+				});
 				return node_annotation_map;
 			};
 
@@ -754,7 +740,7 @@ int main_position(int argc, char** argv) {
 		step_handle_t step_handle_graph_pos;
         if (lifting) {
             if (get_position(source_graph, lift_path_set_source, _pos, source_result, step_handle_graph_pos, false)) {
-                pos = get_graph_pos(target_graph,
+                pos = get_graph_pos(target_graph, target_range_index,
                                     { target_graph.get_path_handle(
                                             source_graph.get_path_name(
                                                 source_graph.get_path_handle_of_step(
@@ -818,9 +804,9 @@ int main_position(int argc, char** argv) {
         // handle the lift into the target graph
         if (lifting) {
             lift_result_t source_result;
-            pos_t _pos = get_graph_pos(source_graph, path_pos, step_handle_graph_pos);
+            pos_t _pos = get_graph_pos(source_graph, source_range_index, path_pos, step_handle_graph_pos);
             if (id(_pos) && get_position(source_graph, lift_path_set_source, _pos, source_result, step_handle_graph_pos, true)) {
-                pos = get_graph_pos(target_graph,
+                pos = get_graph_pos(target_graph, target_range_index,
                                     { target_graph.get_path_handle(
                                             source_graph.get_path_name(
                                                 source_graph.get_path_handle_of_step(
@@ -834,7 +820,7 @@ int main_position(int argc, char** argv) {
 
         } else {
             //path_pos = _path_pos;
-            pos = get_graph_pos(target_graph, path_pos, step_handle_graph_pos);
+            pos = get_graph_pos(target_graph, target_range_index, path_pos, step_handle_graph_pos);
         }
         lift_result_t result;
         //std::cerr << "Got graph pos " << id(pos) << std::endl;
@@ -868,11 +854,11 @@ int main_position(int argc, char** argv) {
 		step_handle_t step_handle_graph_pos_end;
         if (lifting) {
             lift_result_t source_begin_result, source_end_result;
-            pos_t _pos_begin = get_graph_pos(source_graph, path_range.begin, step_handle_graph_pos_begin);
-            pos_t _pos_end = get_graph_pos(source_graph, path_range.end, step_handle_graph_pos_end);
+            pos_t _pos_begin = get_graph_pos(source_graph, source_range_index, path_range.begin, step_handle_graph_pos_begin);
+            pos_t _pos_end = get_graph_pos(source_graph, source_range_index, path_range.end, step_handle_graph_pos_end);
             if (id(_pos_begin) && get_position(source_graph, lift_path_set_source, _pos_begin, source_begin_result, step_handle_graph_pos_begin, true)
                 && id(_pos_end) && get_position(source_graph, lift_path_set_source, _pos_end, source_end_result, step_handle_graph_pos_end, true)) {
-                pos_begin = get_graph_pos(target_graph,
+                pos_begin = get_graph_pos(target_graph, target_range_index,
                                           { target_graph.get_path_handle(
                                                   source_graph.get_path_name(
                                                       source_graph.get_path_handle_of_step(
@@ -880,7 +866,7 @@ int main_position(int argc, char** argv) {
                                             (uint64_t)source_begin_result.path_offset,
                                             source_begin_result.is_rev_vs_ref },
 										  step_handle_graph_pos_begin);
-                pos_end = get_graph_pos(target_graph,
+                pos_end = get_graph_pos(target_graph, target_range_index,
                                         { target_graph.get_path_handle(
                                                 source_graph.get_path_name(
                                                     source_graph.get_path_handle_of_step(
@@ -899,8 +885,8 @@ int main_position(int argc, char** argv) {
 #pragma omp critical (node_annotation_maps)
 				node_annotation_maps.push_back(node_annotation_map);
 			} else {
-				pos_begin = get_graph_pos(target_graph, path_range.begin, step_handle_graph_pos_begin);
-				pos_end = get_graph_pos(target_graph, path_range.end, step_handle_graph_pos_end);
+				pos_begin = get_graph_pos(target_graph, target_range_index, path_range.begin, step_handle_graph_pos_begin);
+				pos_end = get_graph_pos(target_graph, target_range_index, path_range.end, step_handle_graph_pos_end);
 			}
         }
         if (id(pos_begin) && id(pos_end) && !gff_input) {
@@ -1,8 +1,25 @@
 #include "subcommand.hpp"
 #include "args.hxx"
 #include "algorithms/xp.hpp"
+#include "algorithms/position_batch.hpp"
+#include "algorithms/path_range_index.hpp"
+#include "algorithms/index_cache.hpp"
+#include "algorithms/node_path_membership.hpp"
+#include "algorithms/subgraph/extract.hpp"
+#include "odgi.hpp"
+#include "utils.hpp"
+#include "telemetry.hpp"
+#include "response_cache.hpp"
 #include <httplib.h>
 #include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <sstream>
+#include <unordered_set>
 
 namespace odgi {
 
@@ -10,6 +27,103 @@ namespace odgi {
     using namespace xp;
     using namespace httplib;
 
+    namespace {
+
+    /// Writes request logs from a thread of its own, so that answering a request never waits on stdout
+    class async_log_t {
+    public:
+        explicit async_log_t(const bool& enabled) : enabled(enabled) {
+            if (enabled) {
+                writer = std::thread([this]() { write_lines(); });
+            }
+        }
+
+        ~async_log_t() {
+            if (enabled) {
+                {
+                    std::lock_guard<std::mutex> guard(mutex);
+                    done = true;
+                }
+                ready.notify_one();
+                writer.join();
+            }
+        }
+
+        /// Queue a line for writing, if logging is on
+        void log(std::string line) {
+            if (!enabled) return;
+            {
+                std::lock_guard<std::mutex> guard(mutex);
+                lines.push_back(std::move(line));
+            }
+            ready.notify_one();
+        }
+
+        const bool enabled;
+
+    private:
+        std::mutex mutex;
+        std::condition_variable ready;
+        std::vector<std::string> lines;
+        bool done = false;
+        std::thread writer;
+
+        void write_lines(void) {
+            std::vector<std::string> batch;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                ready.wait(lock, [&]() { return done || !lines.empty(); });
+                batch.swap(lines);
+                const bool finished = done;
+                lock.unlock();
+                for (auto& line : batch) {
+                    std::cout << line << "\n";
+                }
+                std::cout.flush();
+                batch.clear();
+                lock.lock();
+                if (finished && lines.empty()) break;
+            }
+        }
+    };
+
+    void allow_cross_origin(Response& res) {
+        res.set_header("Access-Control-Allow-Origin", "*");
+        res.set_header("Access-Control-Expose-Headers", "text/plain");
+        res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
+        res.set_header("Access-Control-Allow-Headers", "Content-Type");
+    }
+
+    /// Requests, cache hits and latencies of one kind of request
+    struct endpoint_stats_t {
+        std::atomic<uint64_t> requests{0};
+        std::atomic<uint64_t> cache_hits{0};
+        telemetry::latency_histogram_t latency;
+    };
+
+    void append_field(std::string& key, const std::string& field) {
+        key.append(std::to_string(field.size()));
+        key.push_back(':');
+        key.append(field);
+    }
+
+    /// The query a request asks, as a cache key: its method, decoded path, parameters and body. Each
+    /// field is prefixed by its length, so that no two queries share a key, and the parameters come
+    /// ordered by name, so that the order they were given in does not matter.
+    std::string cache_key(const Request& req) {
+        std::string key;
+        append_field(key, req.method);
+        append_field(key, req.path);
+        for (auto& param : req.params) {
+            append_field(key, param.first);
+            append_field(key, param.second);
+        }
+        append_field(key, req.body);
+        return key;
+    }
+
+    }
+
     int main_server(int argc, char** argv) {
 
         for (uint64_t i = 1; i < argc-1; ++i) {
@@ -23,8 +137,18 @@ namespace odgi {
         args::Group mandatory_opts(parser, "[ MANDATORY OPTIONS ]");
         args::ValueFlag<std::string> dg_in_file(mandatory_opts, "FILE", "Load the succinct variation graph index from this *FILE*. The file name usually ends with *.xp*.", {'i', "idx"});
         args::ValueFlag<std::string> port(mandatory_opts, "N", "Run the server under this port.", {'p', "port"});
+        args::Group graph_opts(parser, "[ Range Query Options ]");
+        args::ValueFlag<std::string> og_in_file(graph_opts, "FILE", "Also load this graph in *ODGI* (*.og*) or *GFAv1* (*.gfa*) format, keeping it in memory to answer the /subgraph, /depth and /steps range queries.", {'g', "graph"});
+        args::ValueFlag<std::string> index_cache_dir(graph_opts, "DIR", "Keep the step offsets of the paths of the graph in the cache directory *DIR*, and reuse them on later runs while the graph is unchanged. Without it, each path is indexed when it is first queried.", {"index-cache"});
         args::Group http_opts(parser, "[ HTTP Options ]");
         args::ValueFlag<std::string> ip_address(http_opts, "IP", "Run the server under this IP address. If not specified, *IP* will be *localhost*.", {'a', "ip"});
+        args::ValueFlag<uint64_t> keep_alive_max_count(http_opts, "N", "Serve up to *N* requests on one keep-alive connection before closing it (default: 1000).", {"keep-alive-max-count"});
+        args::ValueFlag<uint64_t> keep_alive_timeout(http_opts, "N", "Close keep-alive connections idle for *N* seconds (default: 5).", {"keep-alive-timeout"});
+        args::Flag log_requests(http_opts, "log", "Log each request and its answer to stdout, from a thread of its own.", {'l', "log"});
+        args::ValueFlag<uint64_t> cache_size(http_opts, "N", "Keep the answers to up to *N* bytes of queries in memory, to answer them again without work, dropping the least recently used first. Each of the 16 cache shards holds a sixteenth of *N*, and an answer larger than that is never kept, so with the default, /subgraph answers over 4 MiB are always computed again. Set to 0 to keep none (default: 67108864, which is 64 MiB).", {"cache-size"});
+        args::Group threading_opts(parser, "[ Threading ]");
+        args::ValueFlag<uint64_t> nthreads(threading_opts, "N", "Answer up to *N* requests at the same time (default: the number of cores, at least 8).", {'t', "threads"});
+        args::ValueFlag<uint64_t> batch_nthreads(threading_opts, "N", "Answer the lookups of one POST /batch request, or find the subpaths of one /subgraph request, with *N* threads (default: 1).", {'T', "batch-threads"});
         args::Group program_information(parser, "[ Program Information ]");
         args::HelpFlag help(program_information, "help", "Print a help message for odgi server.", {'h', "help"});
 
@@ -53,15 +177,46 @@ namespace odgi {
             exit(1);
         }
 
+        if (index_cache_dir && !og_in_file) {
+            std::cerr << "[odgi::server] error: --index-cache keeps an index of the graph given with -g=[FILE], --graph=[FILE], so please give one." << std::endl;
+            return 1;
+        }
+
         XP path_index;
 		if (!std::filesystem::exists(args::get(dg_in_file))) {
 			std::cerr << "[odgi::" << "panpos" << "] error: the given file \"" << args::get(dg_in_file) << "\" does not exist. Please specify an existing input file in xp format via -i=[FILE], --idx=[FILE]." << std::endl;
 			return 1;
 		}
-        std::ifstream in;
-        in.open(args::get(dg_in_file));
-        path_index.load(in);
-        in.close();
+        // paths are mapped from the file and only loaded once they are queried
+        path_index.load(args::get(dg_in_file));
+
+        // a resident graph answers range queries, which would otherwise each need odgi extract or odgi depth to load it
+        graph_t graph;
+        std::unique_ptr<algorithms::path_range_index_t> range_index;
+        std::unique_ptr<algorithms::node_path_membership_t> membership;
+        if (og_in_file) {
+            if (!std::filesystem::exists(args::get(og_in_file))) {
+                std::cerr << "[odgi::server] error: the given file \"" << args::get(og_in_file) << "\" does not exist. Please specify an existing input graph via -g=[FILE], --graph=[FILE]." << std::endl;
+                return 1;
+            }
+            const uint64_t load_threads = nthreads && args::get(nthreads) > 0 ? args::get(nthreads) : std::thread::hardware_concurrency();
+            utils::handle_gfa_odgi_input(args::get(og_in_file), "server", false, std::max(load_threads, (uint64_t)1), graph);
+            range_index = std::make_unique<algorithms::path_range_index_t>(graph);
+            if (index_cache_dir) {
+                const algorithms::index_cache_t index_cache(args::get(index_cache_dir), args::get(og_in_file));
+                algorithms::cached_path_range_index(&index_cache, graph, *range_index, std::max(load_threads, (uint64_t)1), false);
+            }
+            // each path is its own rank, for the depth of nodes and the paths crossing a subgraph
+            std::vector<uint32_t> path_ranks(1, algorithms::node_path_membership_t::no_rank);
+            graph.for_each_path_handle([&](const path_handle_t& path) {
+                const uint64_t i = as_integer(path);
+                if (path_ranks.size() <= i) {
+                    path_ranks.resize(i + 1, algorithms::node_path_membership_t::no_rank);
+                }
+                path_ranks[i] = i - 1;
+            });
+            membership = std::make_unique<algorithms::node_path_membership_t>(graph, path_ranks, path_ranks.size() - 1);
+        }
 
         /*
         const char* pattern = R"(/(\d+)/(\w+))";
@@ -87,36 +242,257 @@ namespace odgi {
         */
 
         Server svr;
+        if (nthreads && args::get(nthreads) > 0) {
+            const uint64_t n = args::get(nthreads);
+            svr.new_task_queue = [n] { return new ThreadPool(n); };
+        }
+        svr.set_keep_alive_max_count(keep_alive_max_count ? args::get(keep_alive_max_count) : 1000);
+        svr.set_keep_alive_timeout(keep_alive_timeout ? args::get(keep_alive_timeout) : 5);
+        const uint64_t batch_threads = batch_nthreads && args::get(batch_nthreads) > 0 ? args::get(batch_nthreads) : 1;
+        async_log_t request_log(args::get(log_requests));
+        const uint64_t cache_bytes = cache_size ? args::get(cache_size) : 64 * 1024 * 1024;
+        std::unique_ptr<response_cache_t> cache;
+        if (cache_bytes > 0) {
+            cache = std::make_unique<response_cache_t>(cache_bytes);
+        }
+
+        // filled in while routes are registered, before any request comes in, so it is only read while serving
+        std::map<std::string, endpoint_stats_t> endpoint_stats;
+
+        // Count and time each request of an endpoint, answering it from the cache if it is cacheable and
+        // its query was answered before. Only successful answers are kept.
+        auto measured = [&](const std::string& endpoint, const bool cacheable, Server::Handler handler) -> Server::Handler {
+            endpoint_stats_t& stats = endpoint_stats[endpoint];
+            return [&stats, &cache, &request_log, cacheable, handler](const Request& req, Response& res) {
+                const auto begin = std::chrono::steady_clock::now();
+                ++stats.requests;
+                std::string key;
+                std::shared_ptr<const cached_response_t> cached;
+                if (cacheable && cache) {
+                    key = cache_key(req);
+                    cached = cache->get(key);
+                }
+                if (cached) {
+                    ++stats.cache_hits;
+                    allow_cross_origin(res);
+                    res.set_content(cached->body, cached->content_type);
+                    request_log.log("CACHE HIT: " + req.method + " " + req.path);
+                } else {
+                    handler(req, res);
+                    // httplib only sets the status of a successful answer once the handler returns
+                    if (!key.empty() && (res.status == -1 || res.status == 200)) {
+                        cache->put(key, std::make_shared<const cached_response_t>(
+                                cached_response_t{res.body, res.get_header_value("Content-Type")}));
+                    }
+                }
+                stats.latency.record(std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count());
+            };
+        };
 
-        svr.Get("/hi", [](const Request& req, Response& res) {
-            res.set_header("Access-Control-Allow-Origin", "*");
-            res.set_header("Access-Control-Expose-Headers", "text/plain");
-            res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
+        svr.Get("/hi", measured("hi", false, [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
             res.set_content("Hello World!", "text/plain");
-            std::cout << "GOT REQUEST : HELLO WORLD!" << std::endl;
+            request_log.log("GOT REQUEST : HELLO WORLD!");
+        }));
+
+        // request counts, cache hit ratios and latency quantiles of each endpoint, in the Prometheus text format
+        svr.Get("/metrics", [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
+            std::ostringstream out;
+            out << "# TYPE odgi_server_requests_total counter\n";
+            for (auto& e : endpoint_stats) {
+                out << "odgi_server_requests_total{endpoint=\"" << e.first << "\"} " << e.second.requests.load() << "\n";
+            }
+            out << "# TYPE odgi_server_cache_hits_total counter\n";
+            for (auto& e : endpoint_stats) {
+                out << "odgi_server_cache_hits_total{endpoint=\"" << e.first << "\"} " << e.second.cache_hits.load() << "\n";
+            }
+            out << "# TYPE odgi_server_cache_hit_ratio gauge\n";
+            for (auto& e : endpoint_stats) {
+                const uint64_t requests = e.second.requests.load();
+                out << "odgi_server_cache_hit_ratio{endpoint=\"" << e.first << "\"} "
+                    << (requests > 0 ? (double)e.second.cache_hits.load() / requests : 0.0) << "\n";
+            }
+            // quantiles are the upper bounds of the histogram buckets holding them, which double in width
+            out << "# TYPE odgi_server_latency_seconds summary\n";
+            for (auto& e : endpoint_stats) {
+                auto& latency = e.second.latency;
+                for (const double q : {0.5, 0.99}) {
+                    out << "odgi_server_latency_seconds{endpoint=\"" << e.first << "\",quantile=\"" << q << "\"} "
+                        << latency.quantile(q) << "\n";
+                }
+                out << "odgi_server_latency_seconds_sum{endpoint=\"" << e.first << "\"} " << latency.sum() << "\n"
+                    << "odgi_server_latency_seconds_count{endpoint=\"" << e.first << "\"} " << latency.count() << "\n";
+            }
+            out << "# TYPE odgi_server_cache_bytes gauge\n"
+                << "odgi_server_cache_bytes " << (cache ? cache->get_bytes() : 0) << "\n"
+                << "# TYPE odgi_server_cache_max_bytes gauge\n"
+                << "odgi_server_cache_max_bytes " << cache_bytes << "\n"
+                << "# TYPE odgi_server_cache_entries gauge\n"
+                << "odgi_server_cache_entries " << (cache ? cache->get_entry_count() : 0) << "\n"
+                << "# TYPE odgi_server_cache_evictions_total counter\n"
+                << "odgi_server_cache_evictions_total " << (cache ? cache->get_eviction_count() : 0) << "\n";
+            res.set_content(out.str(), "text/plain; version=0.0.4");
         });
 
-        svr.Get(R"(/(\w*.*)/(\d+))", [&](const Request& req, Response& res) {
-            /*
-            for (size_t i = 0; i < req.matches.size(); i++) {
-                std::cout << req.matches[i] << std::endl;
-            }
-             */
-            auto path_name = req.matches[1];
-            auto nuc_pos_1 = req.matches[2];
-            std::cout << "GOT REQUEST : path name: " << path_name << "; 1-based nucleotide position: " << nuc_pos_1 << std::endl;
-            size_t nuc_pos_0 = std::stoi(nuc_pos_1) - 1;
-            size_t pan_pos = 0;
-            if (path_index.has_path(path_name)) {
-                if (path_index.has_position(path_name, nuc_pos_0)) {
-                    pan_pos = path_index.get_pangenome_pos(path_name, nuc_pos_0) + 1;
+        // Read the path and the 1-based, inclusive range of a range query into the path's [begin, end)
+        auto get_range = [&](const Request& req, Response& res, path_handle_t& path, uint64_t& begin, uint64_t& end) {
+            if (!range_index) {
+                res.status = 404;
+                res.set_content("[odgi::server] error: range queries need a graph, given via -g=[FILE], --graph=[FILE].", "text/plain");
+                return false;
+            }
+            const std::string path_name = req.matches[1].str();
+            if (!graph.has_path(path_name)) {
+                res.status = 404;
+                res.set_content("[odgi::server] error: path " + path_name + " is not in the graph.", "text/plain");
+                return false;
+            }
+            path = graph.get_path_handle(path_name);
+            try {
+                begin = algorithms::parse_position(req.matches[2].str());
+                end = algorithms::parse_position(req.matches[3].str());
+            } catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(e.what(), "text/plain");
+                return false;
+            }
+            if (begin == 0 || end < begin) {
+                res.status = 400;
+                res.set_content("[odgi::server] error: ranges start at 1 and end at or after their start.", "text/plain");
+                return false;
+            }
+            --begin;
+            return true;
+        };
+
+        // the subgraph of a path range in GFA, expanded by ?context-steps=N or ?context-bases=N, with the subpaths crossing it
+        svr.Get(R"(/subgraph/(.+)/(\d+)/(\d+))", measured("subgraph", true, [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
+            path_handle_t path;
+            uint64_t begin, end;
+            if (!get_range(req, res, path, begin, end)) return;
+            uint64_t context_steps = 0;
+            uint64_t context_bases = 0;
+            try {
+                if (req.has_param("context-steps")) context_steps = algorithms::parse_position(req.get_param_value("context-steps"));
+                if (req.has_param("context-bases")) context_bases = algorithms::parse_position(req.get_param_value("context-bases"));
+            } catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(e.what(), "text/plain");
+                return;
+            }
+            graph_t subgraph;
+            algorithms::extract_path_range(graph, *range_index, path, begin, end, subgraph);
+            if (context_steps > 0) {
+                algorithms::expand_subgraph_by_steps(graph, subgraph, context_steps, false);
+            } else if (context_bases > 0) {
+                algorithms::expand_subgraph_by_length(graph, subgraph, context_bases, false);
+            }
+            algorithms::add_connecting_edges_to_subgraph(graph, subgraph);
+            // only the paths crossing the subgraph are walked for their subpaths
+            std::vector<bool> crossing(membership->get_rank_count(), false);
+            subgraph.for_each_handle([&](const handle_t& h) {
+                membership->for_each_member(subgraph.get_id(h), [&](const uint32_t& rank, const uint32_t& steps) {
+                    crossing[rank] = true;
+                });
+            });
+            std::vector<path_handle_t> paths;
+            for (uint64_t rank = 0; rank < crossing.size(); ++rank) {
+                if (crossing[rank]) {
+                    paths.push_back(as_path_handle(rank + 1));
                 }
             }
-            std::cout << "SEND RESPONSE: pangenome position: " << pan_pos << std::endl;
-            res.set_header("Access-Control-Allow-Origin", "*");
-            res.set_header("Access-Control-Expose-Headers", "text/plain");
-            res.set_header("Access-Control-Allow-Methods", "GET, POST, DELETE, PUT");
+            algorithms::add_subpaths_to_subgraph(graph, paths, subgraph, batch_threads);
+            std::ostringstream gfa;
+            subgraph.to_gfa(gfa);
+            request_log.log("GOT SUBGRAPH REQUEST: " + req.path + "; " + std::to_string(subgraph.get_node_count()) + " nodes");
+            res.set_content(gfa.str(), "text/plain");
+        }));
+
+        // the depth and unique depth of each node of a path range, in path order
+        svr.Get(R"(/depth/(.+)/(\d+)/(\d+))", measured("depth", true, [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
+            path_handle_t path;
+            uint64_t begin, end;
+            if (!get_range(req, res, path, begin, end)) return;
+            std::string out = "#node.id\tdepth\tdepth.uniq\n";
+            std::unordered_set<nid_t> seen;
+            range_index->for_each_step_in_range(path, begin, end, [&](const step_handle_t& step, const uint64_t& offset) {
+                const nid_t id = graph.get_id(graph.get_handle_of_step(step));
+                if (!seen.insert(id).second) return;
+                uint64_t depth = 0;
+                membership->for_each_member(id, [&](const uint32_t& rank, const uint32_t& steps) {
+                    depth += steps;
+                });
+                out.append(std::to_string(id) + "\t" + std::to_string(depth) + "\t"
+                           + std::to_string(membership->get_member_count(id)) + "\n");
+            });
+            request_log.log("GOT DEPTH REQUEST: " + req.path);
+            res.set_content(out, "text/plain");
+        }));
+
+        // the steps of a path range, with their 1-based, inclusive ranges on the path
+        svr.Get(R"(/steps/(.+)/(\d+)/(\d+))", measured("steps", true, [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
+            path_handle_t path;
+            uint64_t begin, end;
+            if (!get_range(req, res, path, begin, end)) return;
+            std::string out = "#step.rank\tnode.id\tnode.orientation\tpath.start\tpath.end\n";
+            uint64_t rank = range_index->get_rank(path, begin);
+            range_index->for_each_step_in_range(path, begin, end, [&](const step_handle_t& step, const uint64_t& offset) {
+                const handle_t h = graph.get_handle_of_step(step);
+                out.append(std::to_string(rank++) + "\t" + std::to_string(graph.get_id(h)) + "\t"
+                           + (graph.get_is_reverse(h) ? "-" : "+") + "\t" + std::to_string(offset + 1) + "\t"
+                           + std::to_string(offset + graph.get_length(h)) + "\n");
+            });
+            request_log.log("GOT STEPS REQUEST: " + req.path);
+            res.set_content(out, "text/plain");
+        }));
+
+        // a single position is lifted faster than its answer is looked up and kept, so it bypasses the cache
+        svr.Get(R"(/(\w*.*)/(\d+))", measured("position", false, [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
+            std::vector<algorithms::path_position_query_t> queries(1);
+            queries[0].path_name = req.matches[1].str();
+            uint64_t pan_pos = 0;
+            try {
+                queries[0].position = algorithms::parse_position(req.matches[2].str());
+                pan_pos = algorithms::lift_position_batch(path_index, queries, 1)[0];
+            } catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(e.what(), "text/plain");
+                return;
+            }
+            if (request_log.enabled) {
+                request_log.log("GOT REQUEST : path name: " + queries[0].path_name + "; 1-based nucleotide position: " + req.matches[2].str()
+                                + "\nSEND RESPONSE: pangenome position: " + std::to_string(pan_pos));
+            }
             res.set_content(std::to_string(pan_pos), "text/plain");
+        }));
+
+        // a batch of path:position lookups, as a JSON array or as NAME<TAB>N lines, answered in the same form
+        svr.Post("/batch", measured("batch", true, [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
+            bool is_json = false;
+            std::vector<algorithms::path_position_query_t> queries;
+            std::vector<uint64_t> positions;
+            try {
+                queries = algorithms::parse_position_batch(req.body, is_json);
+                positions = algorithms::lift_position_batch(path_index, queries, batch_threads);
+            } catch (const std::exception& e) {
+                res.status = 400;
+                res.set_content(e.what(), "text/plain");
+                return;
+            }
+            request_log.log("GOT BATCH REQUEST: " + std::to_string(queries.size()) + " lookups");
+            res.set_content(algorithms::format_position_batch(queries, positions, is_json),
+                            is_json ? "application/json" : "text/tab-separated-values");
+        }));
+
+        // browsers ask before posting JSON across origins
+        svr.Options("/batch", [&](const Request& req, Response& res) {
+            allow_cross_origin(res);
         });
 
         svr.Get("/stop", [&](const Request& req, Response& res) {
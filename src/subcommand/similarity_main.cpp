@@ -4,6 +4,8 @@
 #include "split.hpp"
 #include <omp.h>
 #include "utils.hpp"
+#include "algorithms/node_path_membership.hpp"
+#include "algorithms/pansn_index.hpp"
 
 namespace odgi {
 
@@ -76,68 +78,41 @@ args::Group threading_opts(parser, "[ Threading ]");
 	const uint64_t num_threads = args::get(threads) ? args::get(threads) : 1;
     omp_set_num_threads(num_threads);
 
-	graph_t graph;
+	graph_t loaded_graph;
+	std::unique_ptr<mmap_graph_t> frozen_graph;
     assert(argc > 0);
-    {
-        const std::string infile = args::get(dg_in_file);
-        if (infile.size()) {
-            if (infile == "-") {
-                graph.deserialize(std::cin);
-            } else {
-                utils::handle_gfa_odgi_input(infile, "similarity", args::get(progress), num_threads, graph);
-            }
-        }
-    }
+    // we only read the graph, so a frozen one is used straight from its mapping
+    const PathHandleGraph& graph = utils::handle_read_only_input(args::get(dg_in_file), "similarity", args::get(progress),
+                                                                 num_threads, loaded_graph, frozen_graph);
 
     const uint16_t delim_pos = path_delim_pos ? args::get(path_delim_pos) - 1 : 0;
 
     const bool emit_distances = args::get(distances);
 
-    auto group_identified_pos = [](const std::string& path_name, char delim, uint16_t delim_pos) -> std::pair<int32_t, int32_t> {
-        int32_t pos = -1;
-        int32_t cnt = -1;
-
-        while (cnt != delim_pos) {
-            ++pos;
-            const int32_t current_pos = path_name.find(delim, pos);
-            if (current_pos == std::string::npos) {
-                return std::make_pair(cnt, pos - 1);
-            }
-            pos = current_pos;
-            ++cnt;
-        }
-
-        return std::make_pair(cnt, pos);
-    };
-
     // We support up to 4 billion paths (there are uint32_t variables in the implementation)
 
     bool using_delim = !args::get(path_delim).empty();
     char delim = '\0';
-    ska::flat_hash_map<std::string, uint32_t> path_group_ids;
     ska::flat_hash_map<path_handle_t, uint32_t> path_handle_group_ids;
     std::vector<std::string> path_groups;
     if (using_delim) {
         delim = args::get(path_delim).at(0);
-        uint32_t i = 0;
-        graph.for_each_path_handle(
-            [&](const path_handle_t& p) {
-                const std::pair<int32_t, int32_t> cnt_pos = delim ? group_identified_pos(graph.get_path_name(p), delim, delim_pos) : std::make_pair(0, 0);
-                if (cnt_pos.first < 0) {
-                    std::cerr << "[odgi::similarity] error: path name '" << graph.get_path_name(p) << "' has not occurrences of '" << delim << "'." << std::endl;
-                    exit(-1);
-                } else if (cnt_pos.first != delim_pos) {
-                    std::cerr << "[odgi::similarity] warning: path name '" << graph.get_path_name(p) << "' has too few occurrences of '" << delim << "'. "
-                            << "The " << cnt_pos.first + 1 << "-th occurrence is used." << std::endl;
-                }
-                std::string group_name = graph.get_path_name(p).substr(0, cnt_pos.second);
-                auto f = path_group_ids.find(group_name);
-                if (f == path_group_ids.end()) {
-                    path_group_ids[group_name] = i++;
-                    path_groups.push_back(group_name);
-                }
-                path_handle_group_ids[p] = path_group_ids[group_name];
-            });
+        // the group of a path is the part of its name before the delimiter picked by -p,--delim-pos
+        const algorithms::pansn_index_t pansn_index(graph, delim, delim_pos + 1);
+        for (auto& p : pansn_index.get_paths()) {
+            const uint64_t delimiters = pansn_index.get_delimiter_count(p);
+            if (delimiters == 0) {
+                std::cerr << "[odgi::similarity] error: path name '" << graph.get_path_name(p) << "' has not occurrences of '" << delim << "'." << std::endl;
+                exit(-1);
+            } else if (delimiters != delim_pos + 1) {
+                std::cerr << "[odgi::similarity] warning: path name '" << graph.get_path_name(p) << "' has too few occurrences of '" << delim << "'. "
+                        << "The " << delimiters << "-th occurrence is used." << std::endl;
+            }
+            path_handle_group_ids[p] = pansn_index.get_group(p, delim_pos);
+        }
+        for (uint64_t group = 0; group < pansn_index.get_group_count(delim_pos); ++group) {
+            path_groups.push_back(pansn_index.get_group_name(delim_pos, group));
+        }
     }
 
     // ska::flat_hash_map<std::pair<uint64_t, uint64_t>, uint64_t> leads to huge memory usage with deep graphs
@@ -234,32 +209,49 @@ args::Group threading_opts(parser, "[ Threading ]");
                 graph.get_node_count(), "[odgi::similarity] collecting path intersection lengths");
     }
 
-    ska::flat_hash_map<uint64_t, uint64_t> path_intersection_length;
-    graph.for_each_handle(
-        [&](const handle_t& h) {
-            // Skip masked-out nodes
-            if (!node_mask[graph.get_id(h) - 1]) {
-                return;
-            }
-            ska::flat_hash_map<uint32_t, uint64_t> local_path_lengths;
-            size_t l = graph.get_length(h);
-            graph.for_each_step_on_handle(
-                h,
-                [&](const step_handle_t& s) {
-                    local_path_lengths[get_path_id(graph.get_path_handle_of_step(s))] += l;
-                });
-
-#pragma omp critical (path_intersection_length)
-            for (auto& p : local_path_lengths) {
-                for (auto& q : local_path_lengths) {
-                    path_intersection_length[encode_pair(p.first, q.first)] += std::min(p.second, q.second);
+    // Index the paths or groups on each node, so that nodes read them instead of their steps
+    std::vector<uint32_t> path_ranks(path_max + 1, algorithms::node_path_membership_t::no_rank);
+    for (uint32_t i = 0; i < path_max; ++i) {
+        path_ranks[i + 1] = get_path_id(as_path_handle(i + 1));
+    }
+    const algorithms::node_path_membership_t membership(graph, path_ranks, bp_count.size());
+
+    // Pairs are partitioned by their first path or group, and each thread sums the intersections
+    // of the pairs of its own partition over all nodes, so that no pair is kept by two threads
+    const uint64_t partitions = std::max(num_threads, (uint64_t)1);
+    std::vector<ska::flat_hash_map<uint64_t, uint64_t>> partition_intersection_lengths(partitions);
+#pragma omp parallel for schedule(static, 1) num_threads(partitions)
+    for (uint64_t t = 0; t < partitions; ++t) {
+        auto& intersection_length = partition_intersection_lengths[t];
+        std::vector<std::pair<uint32_t, uint64_t>> local_path_lengths;
+        graph.for_each_handle(
+            [&](const handle_t& h) {
+                // Skip masked-out nodes
+                if (!node_mask[graph.get_id(h) - 1]) {
+                    return;
+                }
+                local_path_lengths.clear();
+                size_t l = graph.get_length(h);
+                membership.for_each_member(
+                    graph.get_id(h),
+                    [&](const uint32_t& id, const uint32_t& steps) {
+                        local_path_lengths.push_back(std::make_pair(id, steps * l));
+                    });
+
+                for (auto& p : local_path_lengths) {
+                    if (p.first % partitions != t) {
+                        continue;
+                    }
+                    for (auto& q : local_path_lengths) {
+                        intersection_length[encode_pair(p.first, q.first)] += std::min(p.second, q.second);
+                    }
                 }
-            }
 
-            if (show_progress) {
-                progress_meter->increment(1);
-            }
-        }, true);
+                if (show_progress && t == 0) {
+                    progress_meter->increment(1);
+                }
+            });
+    }
 
     if (show_progress) {
         progress_meter->finish();
@@ -298,38 +290,40 @@ args::Group threading_opts(parser, "[ Threading ]");
     }
 
     std::cout << std::endl;
-    for (auto& p : path_intersection_length) {
-        uint32_t id_a, id_b;
-        decode_pair(p.first, &id_a, &id_b);
-
-        auto& intersection = p.second;
-
-        // From https://stats.stackexchange.com/questions/58706/distance-metrics-for-binary-vectors
-        const double jaccard = (double)intersection / (double)(bp_count[id_a] + bp_count[id_b] - intersection);
-        const double cosine = (double)intersection / std::sqrt((double)(bp_count[id_a] * bp_count[id_b]));
-        const double dice = 2.0 * ((double) intersection / (double)(bp_count[id_a] + bp_count[id_b]));
-        const double estimated_identity = 2.0 * jaccard / (1.0 + jaccard);
-
-        std::cout << get_path_name(id_a) << "\t"
-                  << get_path_name(id_b) << "\t"
-                  << bp_count[id_a] << "\t"
-                  << bp_count[id_b] << "\t"
-                  << intersection << "\t";
-
-        if (emit_distances) {
-            const double euclidian_distance = std::sqrt((double)((bp_count[id_a] + bp_count[id_b] - intersection) - intersection));
-            const uint64_t manhattan_distance = (bp_count[id_a] + bp_count[id_b] - intersection) - intersection;
-            std::cout << (1.0 - jaccard) << "\t"
-                      << (1.0 - cosine) << "\t"
-                      << (1.0 - dice) << "\t"
-                      << (1.0 - estimated_identity) << "\t"
-                      << euclidian_distance << "\t"
-                      << manhattan_distance << std::endl;
-        } else {
-            std::cout << jaccard << "\t"
-                      << cosine << "\t"
-                      << dice << "\t"
-                      << estimated_identity << std::endl;
+    for (auto& path_intersection_length : partition_intersection_lengths) {
+        for (auto& p : path_intersection_length) {
+            uint32_t id_a, id_b;
+            decode_pair(p.first, &id_a, &id_b);
+
+            auto& intersection = p.second;
+
+            // From https://stats.stackexchange.com/questions/58706/distance-metrics-for-binary-vectors
+            const double jaccard = (double)intersection / (double)(bp_count[id_a] + bp_count[id_b] - intersection);
+            const double cosine = (double)intersection / std::sqrt((double)(bp_count[id_a] * bp_count[id_b]));
+            const double dice = 2.0 * ((double) intersection / (double)(bp_count[id_a] + bp_count[id_b]));
+            const double estimated_identity = 2.0 * jaccard / (1.0 + jaccard);
+
+            std::cout << get_path_name(id_a) << "\t"
+                      << get_path_name(id_b) << "\t"
+                      << bp_count[id_a] << "\t"
+                      << bp_count[id_b] << "\t"
+                      << intersection << "\t";
+
+            if (emit_distances) {
+                const double euclidian_distance = std::sqrt((double)((bp_count[id_a] + bp_count[id_b] - intersection) - intersection));
+                const uint64_t manhattan_distance = (bp_count[id_a] + bp_count[id_b] - intersection) - intersection;
+                std::cout << (1.0 - jaccard) << "\t"
+                          << (1.0 - cosine) << "\t"
+                          << (1.0 - dice) << "\t"
+                          << (1.0 - estimated_identity) << "\t"
+                          << euclidian_distance << "\t"
+                          << manhattan_distance << std::endl;
+            } else {
+                std::cout << jaccard << "\t"
+                          << cosine << "\t"
+                          << dice << "\t"
+                          << estimated_identity << std::endl;
+            }
         }
     }
 
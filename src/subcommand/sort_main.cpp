@@ -10,6 +10,7 @@
 #include "algorithms/dagify_sort.hpp"
 #include "algorithms/random_order.hpp"
 #include "algorithms/xp.hpp"
+#include "algorithms/index_cache.hpp"
 #include "algorithms/path_sgd.hpp"
 #include "algorithms/groom.hpp"
 
@@ -38,6 +39,8 @@ int main_sort(int argc, char** argv) {
     args::ValueFlag<std::string> xp_in_file(files_io_opts, "FILE", "Load the succinct variation graph index from this *FILE*. The file name usually ends with *.xp*.", {'X', "path-index"});
     args::ValueFlag<std::string> sort_order_in(files_io_opts, "FILE", "*FILE* containing the sort order. Each line contains one node identifer.", {'s', "sort-order"});
     args::ValueFlag<std::string> tmp_base(files_io_opts, "PATH", "directory for temporary files", {'C', "temp-dir"});
+    args::ValueFlag<uint64_t> xp_memory(files_io_opts, "N", "Build the path index in memory, without temporary files, when it is estimated to need at most N MiB (default: a quarter of the physical memory).", {"xp-memory"});
+    args::ValueFlag<std::string> index_cache_dir(files_io_opts, "DIR", "Keep the path index built for the input graph in the cache directory *DIR*, and reuse it on later runs while the graph is unchanged.", {"index-cache"});
     args::Group topo_sorts_opts(parser, "[ Topological Sort Options ]");
     args::Flag breadth_first(topo_sorts_opts, "breadth_first", "Use a (chunked) breadth first topological sort.", {'b', "breadth-first"});
     args::ValueFlag<uint64_t> breadth_first_chunk(topo_sorts_opts, "N", "Chunk size for breadth first topological sort. Specify how many"
@@ -221,6 +224,9 @@ int main_sort(int argc, char** argv) {
         getcwd(cwd, sizeof(cwd));
         xp::temp_file::set_dir(std::string(cwd));
     }
+    if (xp_memory) {
+        xp::set_memory_budget(args::get(xp_memory) << 20);
+    }
 
     // If required, first of all, optimize the graph so that it is optimized for subsequent algorithms (if required)
     if (args::get(optimize)) {
@@ -343,7 +349,11 @@ int main_sort(int argc, char** argv) {
             path_index.load(in);
             in.close();
         } else {
-            path_index.from_handle_graph(graph, num_threads);
+            std::unique_ptr<algorithms::index_cache_t> index_cache;
+            if (index_cache_dir) {
+                index_cache = std::make_unique<algorithms::index_cache_t>(args::get(index_cache_dir), args::get(dg_in_file));
+            }
+            algorithms::cached_path_index(index_cache.get(), graph, path_index, num_threads, args::get(progress));
         }
         fresh_path_index = true;
         // do we only want so sample from a subset of paths?
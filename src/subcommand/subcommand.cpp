@@ -1,6 +1,7 @@
 // subcommand.cpp: subcommand registry system implementation
 
 #include "subcommand.hpp"
+#include "../telemetry.hpp"
 
 #include <algorithm>
 #include <utility>
@@ -69,7 +70,32 @@ const int& Subcommand::get_priority() const {
 }
 
 const int Subcommand::operator()(int argc, char** argv) const {
-    return main_function(argc, argv);
+    // --timings FILE applies to every subcommand, so we take it out before
+    // the subcommand parses its own arguments
+    std::string timings_file;
+    std::vector<char*> args;
+    for (int i = 0; i < argc; ++i) {
+        const std::string arg = argv[i];
+        if (arg == "--timings") {
+            if (i + 1 == argc) {
+                std::cerr << "[odgi::" << name << "] error: --timings needs a file to write the timings to." << std::endl;
+                return 1;
+            }
+            timings_file = argv[++i];
+        } else if (arg.rfind("--timings=", 0) == 0) {
+            timings_file = arg.substr(std::string("--timings=").size());
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (timings_file.empty()) {
+        return main_function(argc, argv);
+    }
+    telemetry::start(name, std::vector<std::string>(args.begin(), args.end()), timings_file);
+    args.push_back(nullptr);
+    const int ret = main_function((int)args.size() - 1, args.data());
+    telemetry::finish(ret);
+    return ret;
 }
 
 const Subcommand* Subcommand::get(int argc, char** argv) {
@@ -23,7 +23,8 @@
  * brains and off their screen.
  *
  * Subcommands get passed all of argv, so they have to skip past their names
- * when parsing arguments.
+ * when parsing arguments. The global --timings FILE option is removed from
+ * argv before that, and records the run's phases (see telemetry.hpp).
  *
  * To make a subcommand, do something like this in a cpp file in this
  * "subcommand" directory:
@@ -121,7 +122,8 @@ public:
     const int& get_priority() const;
     
     /**
-     * Run the main function of a subcommand. Return the return code.
+     * Run the main function of a subcommand, recording its timings if asked
+     * to with --timings. Return the return code.
      */
     const int operator()(int argc, char** argv) const;
     
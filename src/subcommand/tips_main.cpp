@@ -3,6 +3,7 @@
 #include "args.hxx"
 #include <omp.h>
 #include "algorithms/stepindex.hpp"
+#include "algorithms/index_cache.hpp"
 #include "algorithms/tips.hpp"
 #include "algorithms/tips_bed_writer_thread.hpp"
 #include "vector"
@@ -45,6 +46,8 @@ namespace odgi {
 		args::Group step_index_opts(parser, "[ Step Index Options ]");
 		args::ValueFlag<std::string> _step_index(step_index_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: build the step index from scratch with a sampling rate of 8).",
 												{'a', "step-index"});
+		args::ValueFlag<std::string> _index_cache(step_index_opts, "DIR", "Keep the step index built for the input graph in the cache directory *DIR*, and reuse it on later runs while the graph is unchanged.",
+												  {"index-cache"});
 		args::Group threading(parser, "[ Threading ]");
 		args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
 		args::Group processing_info_opts(parser, "[ Processing Information ]");
@@ -195,98 +198,62 @@ namespace odgi {
 			return graph.has_previous_step(step);
 		};
 
+		std::unique_ptr<algorithms::step_index_t> step_index;
 		if (!_step_index) {
+			std::unique_ptr<algorithms::index_cache_t> index_cache;
+			if (_index_cache) {
+				index_cache = std::make_unique<algorithms::index_cache_t>(args::get(_index_cache), infile);
+			}
 			if (progress) {
 				std::cerr << "[odgi::tips] warning: no step index specified. Building one with a sample rate of 8. This may take additional time. "
 							 "A step index can be provided via -a, --step-index. A step index can be built using odgi stepindex." << std::endl;
 			}
-			algorithms::step_index_t step_index(graph, paths, num_threads, progress, 8);
-			for (auto target_path_t: target_paths) {
-				// make bit vector across nodes to tell us if we have a hit
-				// this is a speed up compared to iterating through all steps of a potential node for each walked step
-				std::vector<bool> target_handles;
-				target_handles.resize(graph.get_node_count(), false);
-				graph.for_each_step_in_path(target_path_t, [&](const step_handle_t &step) {
-					handle_t h = graph.get_handle_of_step(step);
-					target_handles[number_bool_packing::unpack_number(h)] = true;
-				});
-				ska::flat_hash_set<std::string> not_visited_set;
-				/// walk from the front
-				algorithms::walk_tips(graph, query_paths, target_path_t, target_handles, step_index, num_threads,
-									  get_path_begin,
-									  get_next_step, has_next_step, bed_writer_thread, progress, true, not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				std::vector<path_handle_t> visitable_query_paths;
-				for (auto query_path: query_paths) {
-					if (!not_visited_set.count(graph.get_path_name(query_path))) {
-						visitable_query_paths.push_back(query_path);
-					}
-				}
-				/// walk from the back
-				algorithms::walk_tips(graph, visitable_query_paths, target_path_t, target_handles, step_index,
-									  num_threads, get_path_back,
-									  get_prev_step, has_previous_step, bed_writer_thread, progress, false,
-									  not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				/// let's write our paths we did not visit
-				std::string query_path = graph.get_path_name(target_path_t);
-				for (auto not_visited_path: not_visited_set) {
-					not_visited_out << query_path << "\t" << not_visited_path << std::endl;
-				}
-			}
-			bed_writer_thread.close_writer();
-			if (_not_visited_tsv) {
-				not_visited_out.close();
-			}
+			step_index = algorithms::cached_step_index(index_cache.get(), graph, paths, num_threads, progress, 8);
 		} else {
-			algorithms::step_index_t step_index;
-			step_index.load(args::get(_step_index));
-			for (auto target_path_t: target_paths) {
-				// make bit vector across nodes to tell us if we have a hit
-				// this is a speed up compared to iterating through all steps of a potential node for each walked step
-				std::vector<bool> target_handles;
-				target_handles.resize(graph.get_node_count(), false);
-				graph.for_each_step_in_path(target_path_t, [&](const step_handle_t &step) {
-					handle_t h = graph.get_handle_of_step(step);
-					target_handles[number_bool_packing::unpack_number(h)] = true;
-				});
-				ska::flat_hash_set<std::string> not_visited_set;
-				/// walk from the front
-				algorithms::walk_tips(graph, query_paths, target_path_t, target_handles, step_index, num_threads,
-									  get_path_begin,
-									  get_next_step, has_next_step, bed_writer_thread, progress, true, not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				std::vector<path_handle_t> visitable_query_paths;
-				for (auto query_path: query_paths) {
-					if (!not_visited_set.count(graph.get_path_name(query_path))) {
-						visitable_query_paths.push_back(query_path);
-					}
-				}
-				/// walk from the back
-				algorithms::walk_tips(graph, visitable_query_paths, target_path_t, target_handles, step_index,
-									  num_threads, get_path_back,
-									  get_prev_step, has_previous_step, bed_writer_thread, progress, false,
-									  not_visited_set,
-									  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-									  (_walking_dist ? args::get(_walking_dist) : 10000),
-									  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
-				/// let's write our paths we did not visit
-				std::string query_path = graph.get_path_name(target_path_t);
-				for (auto not_visited_path: not_visited_set) {
-					not_visited_out << query_path << "\t" << not_visited_path << std::endl;
+			step_index = std::make_unique<algorithms::step_index_t>();
+			step_index->load(args::get(_step_index));
+		}
+		for (auto target_path_t: target_paths) {
+			// make bit vector across nodes to tell us if we have a hit
+			// this is a speed up compared to iterating through all steps of a potential node for each walked step
+			std::vector<bool> target_handles;
+			target_handles.resize(graph.get_node_count(), false);
+			graph.for_each_step_in_path(target_path_t, [&](const step_handle_t &step) {
+				handle_t h = graph.get_handle_of_step(step);
+				target_handles[number_bool_packing::unpack_number(h)] = true;
+			});
+			ska::flat_hash_set<std::string> not_visited_set;
+			/// walk from the front
+			algorithms::walk_tips(graph, query_paths, target_path_t, target_handles, *step_index, num_threads,
+								  get_path_begin,
+								  get_next_step, has_next_step, bed_writer_thread, progress, true, not_visited_set,
+								  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
+								  (_walking_dist ? args::get(_walking_dist) : 10000),
+								  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
+			std::vector<path_handle_t> visitable_query_paths;
+			for (auto query_path: query_paths) {
+				if (!not_visited_set.count(graph.get_path_name(query_path))) {
+					visitable_query_paths.push_back(query_path);
 				}
 			}
-			bed_writer_thread.close_writer();
-			if (_not_visited_tsv) {
-				not_visited_out.close();
+			/// walk from the back
+			algorithms::walk_tips(graph, visitable_query_paths, target_path_t, target_handles, *step_index,
+								  num_threads, get_path_back,
+								  get_prev_step, has_previous_step, bed_writer_thread, progress, false,
+								  not_visited_set,
+								  (_best_n_mappings ? args::get(_best_n_mappings) : 1),
+								  (_walking_dist ? args::get(_walking_dist) : 10000),
+								  (_report_additional_jaccards ? args::get(_report_additional_jaccards) : false));
+			/// let's write our paths we did not visit
+			std::string query_path = graph.get_path_name(target_path_t);
+			for (auto not_visited_path: not_visited_set) {
+				not_visited_out << query_path << "\t" << not_visited_path << std::endl;
 			}
 		}
+		bed_writer_thread.close_writer();
+		if (_not_visited_tsv) {
+			not_visited_out.close();
+		}
 
 		exit(0);
 	}
@@ -1,4 +1,5 @@
 #include "algorithms/untangle.hpp"
+#include "algorithms/index_cache.hpp"
 #include "args.hxx"
 #include "odgi.hpp"
 #include "subcommand.hpp"
@@ -64,6 +65,8 @@ int main_untangle(int argc, char **argv) {
 	args::Group step_index_opts(parser, "[ Step Index Options ]");
 	args::ValueFlag<std::string> _step_index(step_index_opts, "FILE", "Load the step index from this *FILE*. The file name usually ends with *.stpidx*. (default: build the step index from scratch with a sampling rate of 8).",
 											 {'a', "step-index"});
+	args::ValueFlag<std::string> _index_cache(step_index_opts, "DIR", "Keep the step index built for the input graph in the cache directory *DIR*, and reuse it on later runs while the graph is unchanged.",
+											  {"index-cache"});
     args::Group threading(parser, "[ Threading ]");
     args::ValueFlag<uint64_t> nthreads(
         threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
@@ -207,48 +210,38 @@ int main_untangle(int argc, char **argv) {
             algorithms::self_dotplot(graph, query);
         }
     } else {
+		std::unique_ptr<algorithms::step_index_t> step_index;
 		if (!_step_index) {
+			std::unique_ptr<algorithms::index_cache_t> index_cache;
+			if (_index_cache) {
+				index_cache = std::make_unique<algorithms::index_cache_t>(args::get(_index_cache), args::get(og_in_file));
+			}
 			if (progress) {
 				std::cerr
 						<< "[odgi::untangle] warning: no step index specified. Building one with a sample rate of 8. This may take additional time. "
 						   "A step index can be provided via -a, --step-index. A step index can be built using odgi stepindex."
 						<< std::endl;
 			}
-			algorithms::step_index_t step_index(graph, paths, num_threads, progress, 8);
-			algorithms::untangle(graph,
-								 query_paths,
-								 target_paths,
-								 args::get(merge_dist),
-								 (_max_self_coverage ? args::get(_max_self_coverage) : 0),
-								 (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-								 (_jaccard_threshold ? args::get(_jaccard_threshold) : 0.0),
-								 (_cut_every ? args::get(_cut_every) : 0),
-                                 output_type,
-								 args::get(input_cut_points),
-								 args::get(output_cut_points),
-								 num_threads,
-								 progress,
-								 step_index,
-								 paths);
+			step_index = algorithms::cached_step_index(index_cache.get(), graph, paths, num_threads, progress, 8);
 		} else {
-			algorithms::step_index_t step_index;
-			step_index.load(args::get(_step_index));
-			algorithms::untangle(graph,
-								 query_paths,
-								 target_paths,
-								 args::get(merge_dist),
-								 (_max_self_coverage ? args::get(_max_self_coverage) : 0),
-								 (_best_n_mappings ? args::get(_best_n_mappings) : 1),
-								 (_jaccard_threshold ? args::get(_jaccard_threshold) : 0.0),
-								 (_cut_every ? args::get(_cut_every) : 0),
-                                 output_type,
-								 args::get(input_cut_points),
-								 args::get(output_cut_points),
-								 num_threads,
-								 progress,
-								 step_index,
-                                 paths);
+			step_index = std::make_unique<algorithms::step_index_t>();
+			step_index->load(args::get(_step_index));
 		}
+		algorithms::untangle(graph,
+							 query_paths,
+							 target_paths,
+							 args::get(merge_dist),
+							 (_max_self_coverage ? args::get(_max_self_coverage) : 0),
+							 (_best_n_mappings ? args::get(_best_n_mappings) : 1),
+							 (_jaccard_threshold ? args::get(_jaccard_threshold) : 0.0),
+							 (_cut_every ? args::get(_cut_every) : 0),
+							 output_type,
+							 args::get(input_cut_points),
+							 args::get(output_cut_points),
+							 num_threads,
+							 progress,
+							 *step_index,
+							 paths);
     }
 
     return 0;
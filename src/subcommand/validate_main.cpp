@@ -6,11 +6,53 @@
 #include "algorithms/bfs.hpp"
 #include <omp.h>
 #include "utils.hpp"
+#include "mmap_graph.hpp"
 
 namespace odgi {
 
     using namespace odgi::subcommand;
 
+    namespace {
+
+    /// Check that each step of every path is joined by an edge to the one after it, including the
+    /// last and first steps of circular paths, reporting each missing edge
+    bool validate_paths(const PathHandleGraph& graph, const uint64_t& num_threads) {
+        bool valid_graph = true;
+
+        std::vector<path_handle_t> paths;
+        paths.reserve(graph.get_path_count());
+        graph.for_each_path_handle([&](const path_handle_t &path) {
+            paths.push_back(path);
+        });
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
+        for (auto path : paths) {
+            graph.for_each_step_in_path(path, [&](const step_handle_t &step) {
+                if (graph.has_next_step(step)) {
+                    step_handle_t next_step = graph.get_next_step(step);
+                    handle_t h = graph.get_handle_of_step(step);
+                    handle_t next_h = graph.get_handle_of_step(next_step);
+
+                    if (!graph.has_edge(h, next_h)) {
+#pragma omp critical (cout)
+                        std::cerr << "[odgi::validate] error: the path " << graph.get_path_name(path) << " does not "
+                                  << "respect the graph topology: the link "
+                                  << graph.get_id(h) << (graph.get_is_reverse(h) ? "-" : "+")
+                                  << ","
+                                  << graph.get_id(next_h) << (graph.get_is_reverse(next_h) ? "-" : "+")
+                                  << " is missing." << std::endl;
+
+                        valid_graph = false;
+                    }
+                }
+            });
+        }
+
+        return valid_graph;
+    }
+
+    }
+
     int main_validate(int argc, char **argv) {
 
         // trick argumentparser to do the right thing with the subcommand
@@ -55,9 +97,15 @@ namespace odgi {
 
 		const uint64_t num_threads = args::get(nthreads) ? args::get(nthreads) : 1;
 
+        std::string infile = args::get(og_file);
+        if (infile != "-" && utils::is_frozen_graph(infile)) {
+            // validation only reads the graph, so we work straight from the mapping
+            mmap_graph_t frozen(infile);
+            return (validate_paths(frozen, num_threads) ? 0 : 1);
+        }
+
 		odgi::graph_t graph;
         assert(argc > 0);
-        std::string infile = args::get(og_file);
         if (!infile.empty()) {
             if (infile == "-") {
                 graph.deserialize(std::cin);
@@ -68,38 +116,7 @@ namespace odgi {
 
         omp_set_num_threads(num_threads);
 
-        bool valid_graph = true;
-
-        std::vector<path_handle_t> paths;
-        paths.reserve(graph.get_path_count());
-        graph.for_each_path_handle([&](const path_handle_t &path) {
-            paths.push_back(path);
-        });
-
-#pragma omp parallel for schedule(dynamic, 1) num_threads(num_threads)
-        for (auto path : paths) {
-            graph.for_each_step_in_path(path, [&](const step_handle_t &step) {
-                if (graph.has_next_step(step)) {
-                    step_handle_t next_step = graph.get_next_step(step);
-                    handle_t h = graph.get_handle_of_step(step);
-                    handle_t next_h = graph.get_handle_of_step(next_step);
-
-                    if (!graph.has_edge(h, next_h)) {
-#pragma omp critical (cout)
-                        std::cerr << "[odgi::validate] error: the path " << graph.get_path_name(path) << " does not "
-                                  << "respect the graph topology: the link "
-                                  << graph.get_id(h) << (graph.get_is_reverse(h) ? "-" : "+")
-                                  << ","
-                                  << graph.get_id(next_h) << (graph.get_is_reverse(next_h) ? "-" : "+")
-                                  << " is missing." << std::endl;
-
-                        valid_graph = false;
-                    }
-                }
-            });
-        }
-
-        return (valid_graph ? 0 : 1);
+        return (validate_paths(graph, num_threads) ? 0 : 1);
     }
 
     static Subcommand odgi_validate("validate",
@@ -2,6 +2,8 @@
 #include "odgi.hpp"
 #include "args.hxx"
 #include "utils.hpp"
+#include "mmap_graph.hpp"
+#include "gzip_stream.hpp"
 
 namespace odgi {
 
@@ -23,12 +25,17 @@ int main_view(int argc, char** argv) {
     args::Group out_opts(parser, "[ Output Options ]");
     args::Flag to_gfa(out_opts, "to_gfa", "Write the graph in GFAv1 format to standard output.", {'g', "to-gfa"});
     args::Flag emit_node_annotation(out_opts, "node_annotation", "Emit node annotations for the graph in GFAv1 format.", {'a', "node-annotation"});
+    args::Flag emit_walks(out_opts, "walks", "Write paths whose names follow PanSN sample#haplotype#contig as GFA 1.1 W-lines.", {'W', "walks"});
+    args::Flag bgzip_gfa(out_opts, "bgzip", "Compress the GFAv1 output with BGZF, which gzip, bgzip and odgi build can all read.", {'z', "bgzip"});
+    args::ValueFlag<std::string> to_frozen(out_opts, "FILE", "Write the graph in the frozen, memory-mappable format to this *FILE*. odgi depth,"
+                                                            " pav, similarity, validate and paths -L/-f run on such a file straight from the"
+                                                            " mapping, while other subcommands load it into memory first.", {'F', "to-frozen"});
     args::Flag display(out_opts, "display", "Show the internal structures of a graph. Print to stderr the maximum"
                                           " node identifier, the minimum node identifier, the nodes vector, the"
                                           " delete nodes bit vector and the path metadata, each in a separate"
                                           " line.", {'d', "display"});
 	args::Group threading(parser, "[ Threading ]");
-	args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations.", {'t', "threads"});
+	args::ValueFlag<uint64_t> nthreads(threading, "N", "Number of threads to use for parallel operations, including formatting GFA output.", {'t', "threads"});
 	args::Group processing_info_opts(parser, "[ Processing Information ]");
 	args::Flag progress(processing_info_opts, "progress", "Write the current progress to stderr.", {'P', "progress"});
     args::Group program_information(parser, "[ Program Information ]");
@@ -72,8 +79,23 @@ int main_view(int argc, char** argv) {
     if (args::get(display)) {
         graph.display();
     }
+    if (args::get(bgzip_gfa) && !args::get(to_gfa)) {
+        std::cerr << "[odgi::view] error: -z, --bgzip compresses the GFA output, please also specify -g, --to-gfa." << std::endl;
+        return 1;
+    }
     if (args::get(to_gfa)) {
-        graph.to_gfa(std::cout, args::get(emit_node_annotation));
+        graph.set_number_of_threads(num_threads);
+        if (args::get(bgzip_gfa)) {
+            gzip::bgzf_streambuf_t buf(std::cout, num_threads);
+            std::ostream out(&buf);
+            graph.to_gfa(out, args::get(emit_node_annotation), args::get(emit_walks));
+            buf.close();
+        } else {
+            graph.to_gfa(std::cout, args::get(emit_node_annotation), args::get(emit_walks));
+        }
+    }
+    if (!args::get(to_frozen).empty()) {
+        mmap_graph_t::freeze(graph, args::get(to_frozen), num_threads);
     }
 
     return 0;
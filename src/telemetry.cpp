@@ -0,0 +1,309 @@
+#include "telemetry.hpp"
+#include "version.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace odgi {
+
+namespace telemetry {
+
+typedef std::chrono::steady_clock timer_clock;
+
+struct phase_record_t {
+    std::string name;
+    phase_record_t* parent = nullptr;
+    std::vector<std::unique_ptr<phase_record_t>> children;
+    timer_clock::time_point begin;
+    double seconds = 0;
+    bool open = true;
+    uint64_t threads = 0;
+    std::atomic<uint64_t> items{0};
+    uint64_t rss_begin = 0;
+    uint64_t rss_end = 0;
+    uint64_t peak_rss = 0;
+};
+
+namespace {
+
+struct run_t {
+    std::atomic<bool> enabled{false};
+    bool written = false;
+    std::mutex mutex;
+    std::string filename;
+    std::string command;
+    std::vector<std::string> args;
+    uint64_t threads = 0;
+    // the root holds the whole run, current the innermost open phase
+    phase_record_t root;
+    phase_record_t* current = &root;
+};
+
+run_t& run(void) {
+    static run_t r;
+    return r;
+}
+
+void open_record(phase_record_t& record) {
+    record.begin = timer_clock::now();
+    record.rss_begin = current_rss();
+}
+
+void close_record(phase_record_t& record) {
+    record.seconds = std::chrono::duration<double>(timer_clock::now() - record.begin).count();
+    record.rss_end = current_rss();
+    record.peak_rss = peak_rss();
+    record.open = false;
+}
+
+std::string escape(const std::string& s) {
+    std::stringstream ss;
+    for (auto c : s) {
+        switch (c) {
+        case '"': ss << "\\\""; break;
+        case '\\': ss << "\\\\"; break;
+        case '\n': ss << "\\n"; break;
+        case '\t': ss << "\\t"; break;
+        case '\r': ss << "\\r"; break;
+        default:
+            if ((unsigned char)c < 0x20) {
+                ss << "\\u" << std::hex << std::setw(4) << std::setfill('0') << (int)c << std::dec;
+            } else {
+                ss << c;
+            }
+        }
+    }
+    return ss.str();
+}
+
+void write_phase(std::ostream& out, const phase_record_t& record, const std::string& indent) {
+    out << indent << "{\"name\": \"" << escape(record.name) << "\", "
+        << "\"seconds\": " << record.seconds << ", "
+        << "\"threads\": " << record.threads << ", "
+        << "\"items\": " << record.items.load() << ", "
+        << "\"items_per_second\": " << (record.seconds > 0 ? record.items.load() / record.seconds : 0) << ", "
+        << "\"rss_begin_bytes\": " << record.rss_begin << ", "
+        << "\"rss_end_bytes\": " << record.rss_end << ", "
+        << "\"peak_rss_bytes\": " << record.peak_rss << ", "
+        << "\"phases\": [";
+    if (!record.children.empty()) {
+        out << std::endl;
+        for (uint64_t i = 0; i < record.children.size(); ++i) {
+            write_phase(out, *record.children[i], indent + "  ");
+            out << (i + 1 < record.children.size() ? "," : "") << std::endl;
+        }
+        out << indent;
+    }
+    out << "]}";
+}
+
+void write_run(run_t& r, const int* exit_code) {
+    std::lock_guard<std::mutex> guard(r.mutex);
+    if (r.written) {
+        return;
+    }
+    r.written = true;
+    for (phase_record_t* p = r.current; p != nullptr; p = p->parent) {
+        if (p->open) close_record(*p);
+    }
+    r.current = &r.root;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    std::ofstream out(r.filename.c_str());
+    if (!out) {
+        std::cerr << "[odgi::telemetry] error: could not write timings to " << r.filename << std::endl;
+        return;
+    }
+    out << std::setprecision(6) << std::fixed;
+    out << "{" << std::endl
+        << "  \"command\": \"" << escape(r.command) << "\"," << std::endl
+        << "  \"arguments\": [";
+    for (uint64_t i = 0; i < r.args.size(); ++i) {
+        out << (i ? ", " : "") << "\"" << escape(r.args[i]) << "\"";
+    }
+    out << "]," << std::endl
+        << "  \"version\": \"" << escape(Version::get_version()) << "\"," << std::endl
+        << "  \"exit_code\": ";
+    if (exit_code) {
+        out << *exit_code;
+    } else {
+        // the command called exit() itself
+        out << "null";
+    }
+    out << "," << std::endl
+        << "  \"threads\": " << r.threads << "," << std::endl
+        << "  \"seconds\": " << r.root.seconds << "," << std::endl
+        << "  \"user_seconds\": " << usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 << "," << std::endl
+        << "  \"system_seconds\": " << usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6 << "," << std::endl
+        << "  \"peak_rss_bytes\": " << r.root.peak_rss << "," << std::endl
+        << "  \"phases\": [";
+    if (!r.root.children.empty()) {
+        out << std::endl;
+        for (uint64_t i = 0; i < r.root.children.size(); ++i) {
+            write_phase(out, *r.root.children[i], "    ");
+            out << (i + 1 < r.root.children.size() ? "," : "") << std::endl;
+        }
+        out << "  ";
+    }
+    out << "]" << std::endl
+        << "}" << std::endl;
+}
+
+void write_at_exit(void) {
+    auto& r = run();
+    if (r.enabled.load()) {
+        write_run(r, nullptr);
+    }
+}
+
+}
+
+void start(const std::string& command, const std::vector<std::string>& args, const std::string& filename) {
+    auto& r = run();
+    r.command = command;
+    r.args = args;
+    r.filename = filename;
+    r.root.name = command;
+    open_record(r.root);
+    r.enabled.store(true);
+    std::atexit(write_at_exit);
+}
+
+bool enabled(void) {
+    return run().enabled.load(std::memory_order_relaxed);
+}
+
+void set_threads(uint64_t num_threads) {
+    if (!enabled()) return;
+    auto& r = run();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    r.threads = num_threads;
+    r.root.threads = num_threads;
+}
+
+void finish(int exit_code) {
+    auto& r = run();
+    if (r.enabled.load()) {
+        write_run(r, &exit_code);
+    }
+}
+
+phase_t::phase_t(const std::string& name, uint64_t num_threads) {
+    if (!enabled()) return;
+    auto& r = run();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    if (r.written) return;
+    r.current->children.emplace_back(new phase_record_t());
+    record = r.current->children.back().get();
+    record->name = name;
+    record->parent = r.current;
+    record->threads = num_threads ? num_threads : r.threads;
+    open_record(*record);
+    r.current = record;
+}
+
+phase_t::~phase_t(void) {
+    stop();
+}
+
+void phase_t::add_items(uint64_t n) {
+    if (record) record->items += n;
+}
+
+void phase_t::set_threads(uint64_t num_threads) {
+    if (record) record->threads = num_threads;
+}
+
+void phase_t::stop(void) {
+    if (!record) return;
+    auto& r = run();
+    std::lock_guard<std::mutex> guard(r.mutex);
+    if (!r.written && record->open) {
+        close_record(*record);
+        // phases closed out of order leave the innermost open one current
+        if (r.current == record) {
+            r.current = record->parent;
+            while (r.current->parent != nullptr && !r.current->open) {
+                r.current = r.current->parent;
+            }
+        }
+    }
+    record = nullptr;
+}
+
+uint64_t peak_rss(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return usage.ru_maxrss;
+#else
+    return (uint64_t)usage.ru_maxrss * 1024;
+#endif
+}
+
+uint64_t current_rss(void) {
+    std::ifstream statm("/proc/self/statm");
+    uint64_t size = 0, resident = 0;
+    if (statm >> size >> resident) {
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+    return 0;
+}
+
+void latency_histogram_t::record(double seconds) {
+    const uint64_t microseconds = seconds > 0 ? (uint64_t)std::llround(seconds * 1e6) : 0;
+    // bucket b > 0 holds [2^(b-1), 2^b) microseconds, and bucket 0 anything under one
+    uint64_t b = 0;
+    for (uint64_t m = microseconds; m > 0 && b + 1 < bucket_count; m >>= 1) {
+        ++b;
+    }
+    buckets[b].fetch_add(1, std::memory_order_relaxed);
+    total_microseconds.fetch_add(microseconds, std::memory_order_relaxed);
+    total.fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t latency_histogram_t::count(void) const {
+    return total.load(std::memory_order_relaxed);
+}
+
+double latency_histogram_t::sum(void) const {
+    return total_microseconds.load(std::memory_order_relaxed) / 1e6;
+}
+
+double latency_histogram_t::quantile(double q) const {
+    uint64_t counts[bucket_count];
+    uint64_t n = 0;
+    // a snapshot, as counts may grow while we read them
+    for (uint64_t b = 0; b < bucket_count; ++b) {
+        counts[b] = buckets[b].load(std::memory_order_relaxed);
+        n += counts[b];
+    }
+    if (n == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max((uint64_t)1, (uint64_t)std::ceil(std::min(std::max(q, 0.0), 1.0) * n));
+    uint64_t seen = 0;
+    for (uint64_t b = 0; b < bucket_count; ++b) {
+        seen += counts[b];
+        if (seen >= rank) {
+            return (double)((uint64_t)1 << b) / 1e6;
+        }
+    }
+    return (double)((uint64_t)1 << (bucket_count - 1)) / 1e6;
+}
+
+}
+
+}
@@ -0,0 +1,88 @@
+//
+//  odgi
+//
+//  telemetry.hpp
+//
+//  per-phase timing and memory records for a command run
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace odgi {
+
+/// Structured timing records, enabled for any subcommand by the global
+/// --timings FILE option. A run is a tree of named phases, each with its wall
+/// time, thread count, resident memory before and after, the peak resident
+/// memory of the process so far, and optionally the items it processed. The
+/// tree is written to FILE as JSON when the command returns or exits. While
+/// disabled, opening a phase costs a single load of a flag.
+namespace telemetry {
+
+/// Start recording a run of the given command with the given arguments
+void start(const std::string& command, const std::vector<std::string>& args, const std::string& filename);
+
+/// True if a run is being recorded
+bool enabled(void);
+
+/// Record the number of threads the command was asked to use
+void set_threads(uint64_t num_threads);
+
+/// Close any open phases and write the run with the command's exit code
+void finish(int exit_code);
+
+struct phase_record_t;
+
+/// A timed phase, open from construction until stop() or destruction. Phases
+/// opened while another is open are nested in it, so they should be opened
+/// by the thread driving the command rather than by its workers.
+class phase_t {
+public:
+    phase_t(const std::string& name, uint64_t num_threads = 0);
+    ~phase_t(void);
+    phase_t(const phase_t& other) = delete;
+    phase_t& operator=(const phase_t& other) = delete;
+    /// Count items processed in this phase, for throughput
+    void add_items(uint64_t n);
+    /// Set the number of threads used in this phase
+    void set_threads(uint64_t num_threads);
+    /// Close the phase early
+    void stop(void);
+private:
+    phase_record_t* record = nullptr;
+};
+
+/// Peak resident set size of the process so far in bytes
+uint64_t peak_rss(void);
+
+/// Current resident set size of the process in bytes, or 0 if unknown
+uint64_t current_rss(void);
+
+/// Counts of durations in buckets doubling in width from one microsecond, for
+/// the quantiles of request latencies. Recording takes no lock, so any thread
+/// may record while others read.
+class latency_histogram_t {
+public:
+    /// the last bucket holds everything from 2^30 microseconds, about 18 minutes
+    static const uint64_t bucket_count = 32;
+    /// Count a duration
+    void record(double seconds);
+    /// Number of durations counted
+    uint64_t count(void) const;
+    /// Sum of the durations counted, in seconds
+    double sum(void) const;
+    /// Upper bound in seconds of the bucket holding the q-quantile, or 0 if nothing was counted
+    double quantile(double q) const;
+private:
+    std::atomic<uint64_t> buckets[bucket_count] = {};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> total_microseconds{0};
+};
+
+}
+
+}
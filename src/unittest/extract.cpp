@@ -109,6 +109,24 @@ namespace odgi {
                 REQUIRE(z == "GCCGGC");
             }
 
+            SECTION("Extracting through a path range index takes the same nodes") {
+                algorithms::path_range_index_t range_index(graph);
+                for (auto& path : {path_x, path_y, path_z}) {
+                    for (int64_t start = 0; start < 18; ++start) {
+                        for (int64_t end = start; end < 18; end += 3) {
+                            graph_t walked, indexed;
+                            algorithms::extract_path_range(graph, path, start, end, walked);
+                            algorithms::extract_path_range(graph, range_index, path, start, end, indexed);
+                            REQUIRE(indexed.get_node_count() == walked.get_node_count());
+                            walked.for_each_handle([&](const handle_t& h) {
+                                REQUIRE(indexed.has_node(walked.get_id(h)));
+                                REQUIRE(indexed.get_sequence(indexed.get_handle(walked.get_id(h))) == walked.get_sequence(h));
+                            });
+                        }
+                    }
+                }
+            }
+
         }
 
     }
@@ -0,0 +1,277 @@
+/**
+ * \file
+ * unittest/gfa_to_handle.cpp: test cases for building graphs from GFA files.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "gfa_to_handle.hpp"
+#include "gzip_stream.hpp"
+#include "algorithms/temp_file.hpp"
+
+#include <zlib.h>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+
+namespace odgi {
+namespace unittest {
+
+using namespace std;
+using namespace handlegraph;
+
+namespace {
+
+/// Nodes of the test GFA, and the id of its first one
+const uint64_t test_nodes = 5000;
+const uint64_t test_first_id = 101;
+
+/// Sequence of the i-th node of the test GFA
+std::string test_sequence(uint64_t i) {
+    return std::string(1 + i % 7, "ACGT"[i % 4]);
+}
+
+/// A GFA whose paths come before the segments and links they refer to, with
+/// ids that don't start at 1, a walk and a few thousand nodes
+std::string test_gfa(void) {
+    std::stringstream gfa;
+    gfa << "H\tVN:Z:1.0\n";
+    gfa << "P\tx\t";
+    for (uint64_t i = 0; i < test_nodes; i += 2) {
+        gfa << (i ? "," : "") << test_first_id + i << "+";
+    }
+    gfa << "\t*\n";
+    gfa << "W\tHG1\t1\tchr1\t0\t10\t";
+    for (uint64_t i = test_nodes; i > 0; --i) {
+        gfa << "<" << test_first_id + i - 1;
+    }
+    gfa << "\n";
+    for (uint64_t i = 0; i < test_nodes; ++i) {
+        gfa << "S\t" << test_first_id + i << "\t" << test_sequence(i) << "\n";
+    }
+    for (uint64_t i = 0; i + 1 < test_nodes; ++i) {
+        gfa << "L\t" << test_first_id + i << "\t+\t" << test_first_id + i + 1 << "\t+\t0M\n";
+        if (i + 2 < test_nodes && i % 2 == 0) {
+            gfa << "L\t" << test_first_id + i << "\t+\t" << test_first_id + i + 2 << "\t" << (i % 4 ? "+" : "-") << "\t0M\n";
+        }
+    }
+    return gfa.str();
+}
+
+/// The graph the test GFA describes, built one handle at a time
+void build_test_graph(graph_t& graph) {
+    for (uint64_t i = 0; i < test_nodes; ++i) {
+        graph.create_handle(test_sequence(i), test_first_id + i);
+    }
+    for (uint64_t i = 0; i + 1 < test_nodes; ++i) {
+        const handle_t h = graph.get_handle(test_first_id + i);
+        graph.create_edge(h, graph.get_handle(test_first_id + i + 1));
+        if (i + 2 < test_nodes && i % 2 == 0) {
+            graph.create_edge(h, graph.get_handle(test_first_id + i + 2, i % 4 == 0));
+        }
+    }
+    path_handle_t x = graph.create_path_handle("x");
+    for (uint64_t i = 0; i < test_nodes; i += 2) {
+        graph.append_step(x, graph.get_handle(test_first_id + i));
+    }
+    path_handle_t walk = graph.create_path_handle("HG1#1#chr1");
+    for (uint64_t i = test_nodes; i > 0; --i) {
+        graph.append_step(walk, graph.get_handle(test_first_id + i - 1, true));
+    }
+}
+
+/// Write the text to a new temporary file, returning its name
+std::string write_gfa(const std::string& text) {
+    const std::string filename = algorithms::temp_file::create("gfa_to_handle");
+    std::ofstream out(filename);
+    out << text;
+    return filename;
+}
+
+/// The steps of a path, as node ids negated when reverse
+std::vector<int64_t> signed_steps(const graph_t& graph, const path_handle_t& path) {
+    std::vector<int64_t> steps;
+    graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+        handle_t h = graph.get_handle_of_step(step);
+        steps.push_back(graph.get_is_reverse(h) ? -graph.get_id(h) : graph.get_id(h));
+    });
+    return steps;
+}
+
+/// Write the text with zlib, as gzip would
+void write_gzip(const std::string& filename, const std::string& text) {
+    gzFile out = gzopen(filename.c_str(), "wb");
+    REQUIRE(out != nullptr);
+    REQUIRE(gzwrite(out, text.data(), text.size()) == (int)text.size());
+    gzclose(out);
+}
+
+/// Write the text in BGZF blocks, as bgzip would
+void write_bgzf(const std::string& filename, const std::string& text) {
+    std::ofstream out(filename, std::ios::binary);
+    gzip::bgzf_streambuf_t buf(out, 2);
+    std::ostream stream(&buf);
+    stream << text;
+    buf.close();
+}
+
+}
+
+TEST_CASE("GFA builds the same graph whatever the number of threads", "[gfa_to_handle]") {
+    const std::string filename = write_gfa(test_gfa());
+    graph_t expected;
+    build_test_graph(expected);
+    for (uint64_t threads : {1, 2, 3, 4, 8, 16}) {
+        graph_t graph;
+        gfa_to_handle(filename, &graph, false, threads, false);
+        REQUIRE(graph.get_node_count() == expected.get_node_count());
+        REQUIRE(graph.get_edge_count() == expected.get_edge_count());
+        REQUIRE(graph.get_path_handle("x") == expected.get_path_handle("x"));
+        REQUIRE(graph.get_path_handle("HG1#1#chr1") == expected.get_path_handle("HG1#1#chr1"));
+        REQUIRE(graph.get_step_count(graph.get_path_handle("x")) == test_nodes / 2);
+        REQUIRE(graph.fingerprint() == expected.fingerprint());
+    }
+    algorithms::temp_file::remove(filename);
+}
+
+TEST_CASE("Compressed GFA builds the same graph as plain GFA", "[gfa_to_handle]") {
+    const std::string text = test_gfa();
+    const std::string plain = write_gfa(text);
+    const std::string gz = algorithms::temp_file::create("gfa_to_handle");
+    const std::string bgz = algorithms::temp_file::create("gfa_to_handle");
+    write_gzip(gz, text);
+    write_bgzf(bgz, text);
+    REQUIRE(!gzip::is_gzip(plain));
+    REQUIRE(gzip::is_gzip(gz));
+    REQUIRE(!gzip::is_bgzf(gz));
+    REQUIRE(gzip::is_gzip(bgz));
+    REQUIRE(gzip::is_bgzf(bgz));
+
+    for (bool compact_ids : {false, true}) {
+        graph_t expected;
+        gfa_to_handle(plain, &expected, compact_ids, 1, false);
+        REQUIRE(expected.get_node_count() == test_nodes);
+        REQUIRE(expected.get_path_count() == 2);
+        REQUIRE(expected.min_node_id() == (compact_ids ? 1 : test_first_id));
+        for (uint64_t threads : {1, 2, 5}) {
+            for (const std::string& filename : {gz, bgz}) {
+                graph_t graph;
+                gfa_to_handle(filename, &graph, compact_ids, threads, false);
+                REQUIRE(graph.get_node_count() == expected.get_node_count());
+                REQUIRE(graph.get_edge_count() == expected.get_edge_count());
+                REQUIRE(graph.min_node_id() == expected.min_node_id());
+                REQUIRE(graph.get_path_handle("x") == expected.get_path_handle("x"));
+                REQUIRE(graph.get_path_handle("HG1#1#chr1") == expected.get_path_handle("HG1#1#chr1"));
+                REQUIRE(graph.fingerprint() == expected.fingerprint());
+            }
+        }
+    }
+
+    algorithms::temp_file::remove(plain);
+    algorithms::temp_file::remove(gz);
+    algorithms::temp_file::remove(bgz);
+}
+
+TEST_CASE("W-lines become paths named in PanSN style", "[gfa_to_handle]") {
+    const std::string filename = write_gfa(
+        "H\tVN:Z:1.1\n"
+        "S\t1\tACG\n"
+        "S\t2\tT\n"
+        "S\t3\tGG\n"
+        "L\t1\t+\t2\t+\t0M\n"
+        "L\t2\t+\t3\t-\t0M\n"
+        "W\tHG1\t1\tchr1\t0\t6\t>1>2<3\n"
+        "W\tHG2\t2\tchr1\t*\t*\t<3<2<1\n"
+        "W\tHG3\t1\tchr2\t2\t6\t>2<3\n"
+        "P\tx\t1+,2+\t*\n");
+    graph_t graph;
+    gfa_to_handle(filename, &graph, false, 2, false);
+    algorithms::temp_file::remove(filename);
+
+    SECTION("Names follow the sample, haplotype and contig, with a range unless the walk starts at 0 or *") {
+        REQUIRE(graph.get_path_count() == 4);
+        REQUIRE(graph.has_path("HG1#1#chr1"));
+        REQUIRE(graph.has_path("HG2#2#chr1"));
+        REQUIRE(graph.has_path("HG3#1#chr2:2-6"));
+        REQUIRE(graph.has_path("x"));
+        REQUIRE(!graph.has_path("HG2#2#chr1:*-*"));
+    }
+
+    SECTION("Steps keep their order and orientation") {
+        REQUIRE(signed_steps(graph, graph.get_path_handle("HG1#1#chr1")) == std::vector<int64_t>{1, 2, -3});
+        REQUIRE(signed_steps(graph, graph.get_path_handle("HG2#2#chr1")) == std::vector<int64_t>{-3, -2, -1});
+        REQUIRE(signed_steps(graph, graph.get_path_handle("HG3#1#chr2:2-6")) == std::vector<int64_t>{2, -3});
+        REQUIRE(signed_steps(graph, graph.get_path_handle("x")) == std::vector<int64_t>{1, 2});
+    }
+
+    SECTION("PanSN paths are written back as W-lines, and others as P-lines") {
+        std::stringstream out;
+        graph.to_gfa(out, false, true);
+        const std::string gfa = out.str();
+        REQUIRE(gfa.find("H\tVN:Z:1.1\n") == 0);
+        // a walk over a whole contig gets its length as the end
+        REQUIRE(gfa.find("W\tHG1\t1\tchr1\t0\t6\t>1>2<3\n") != std::string::npos);
+        REQUIRE(gfa.find("W\tHG2\t2\tchr1\t0\t6\t<3<2<1\n") != std::string::npos);
+        REQUIRE(gfa.find("W\tHG3\t1\tchr2\t2\t6\t>2<3\n") != std::string::npos);
+        REQUIRE(gfa.find("P\tx\t1+,2+\t*\n") != std::string::npos);
+    }
+}
+
+TEST_CASE("GFA written from several threads matches GFA written from one", "[gfa_to_handle]") {
+    graph_t graph;
+    // enough nodes for several blocks of them
+    const uint64_t n = 40000;
+    for (uint64_t i = 0; i < n; ++i) {
+        graph.create_handle(test_sequence(i));
+    }
+    for (uint64_t i = 1; i < n; ++i) {
+        graph.create_edge(graph.get_handle(i), graph.get_handle(i + 1, i % 3 == 0));
+    }
+    path_handle_t linear = graph.create_path_handle("linear");
+    for (uint64_t i = 1; i <= n; i += 3) {
+        graph.append_step(linear, graph.get_handle(i, i % 2 == 0));
+    }
+    path_handle_t circular = graph.create_path_handle("circular", true);
+    graph.append_step(circular, graph.get_handle(1));
+    graph.append_step(circular, graph.get_handle(2, true));
+    graph.append_step(circular, graph.get_handle(3));
+    for (uint64_t k = 0; k < 500; ++k) {
+        path_handle_t p = graph.create_path_handle("short" + std::to_string(k));
+        graph.append_step(p, graph.get_handle(k + 1));
+        graph.append_step(p, graph.get_handle(k + 2));
+    }
+
+    graph.set_number_of_threads(1);
+    std::stringstream serial;
+    graph.to_gfa(serial);
+
+    SECTION("Parallel output is identical") {
+        for (uint64_t threads : {2, 4, 8}) {
+            graph.set_number_of_threads(threads);
+            std::stringstream parallel;
+            graph.to_gfa(parallel);
+            REQUIRE(parallel.str() == serial.str());
+        }
+    }
+
+    SECTION("P-lines end with a comma after the last step only if the path goes on") {
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            std::string line = "P\t" + graph.get_path_name(p) + "\t";
+            graph.for_each_step_in_path(p, [&](const step_handle_t& step) {
+                handle_t h = graph.get_handle_of_step(step);
+                line += std::to_string(graph.get_id(h)) + (graph.get_is_reverse(h) ? "-" : "+");
+                if (graph.has_next_step(step)) line += ",";
+            });
+            line += "\t*";
+            if (graph.get_is_circular(p)) line += "\tTP:Z:circular";
+            line += "\n";
+            REQUIRE(serial.str().find(line) != std::string::npos);
+        });
+    }
+}
+
+}
+}
@@ -8,6 +8,8 @@
 #include <handlegraph/handle_graph.hpp>
 #include <handlegraph/util.hpp>
 #include "odgi.hpp"
+#include "external_steps.hpp"
+#include "algorithms/xp.hpp"
 
 #include <iostream>
 #include <limits>
@@ -16,6 +18,7 @@
 #include <unordered_map>
 #include <unordered_set>
 #include <random>
+#include <sstream>
 
 namespace odgi {
 namespace unittest {
@@ -2301,5 +2304,359 @@ TEST_CASE("Deletable handle graphs with mutable paths work", "[handle][packed][h
     
 }
 
+TEST_CASE("Graphs serialize in parallel blocks and old files still load", "[handle]") {
+    graph_t graph;
+    graph.set_number_of_threads(4);
+    // enough nodes to span more than one serialization block
+    const uint64_t n = graph_t::serialization_block_size + 1000;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < n; ++i) {
+        handles.push_back(graph.create_handle(i % 2 ? "A" : "GT"));
+        if (i) graph.create_edge(handles[i-1], handles[i]);
+    }
+    graph.destroy_handle(handles[10]);
+    path_handle_t p = graph.create_path_handle("x");
+    for (uint64_t i = 100; i < 200; ++i) {
+        graph.append_step(p, handles[i]);
+    }
+
+    auto check = [&](graph_t& loaded) {
+        REQUIRE(loaded.get_node_count() == graph.get_node_count());
+        REQUIRE(loaded.get_edge_count() == graph.get_edge_count());
+        REQUIRE(!loaded.has_node(graph.get_id(handles[10])));
+        graph.for_each_handle([&](const handle_t& h) {
+            handle_t l = loaded.get_handle(graph.get_id(h));
+            REQUIRE(loaded.get_sequence(l) == graph.get_sequence(h));
+            REQUIRE(loaded.get_degree(l, false) == graph.get_degree(h, false));
+        });
+        REQUIRE(loaded.has_path("x"));
+        std::vector<handle_t> a, b;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& s) { a.push_back(graph.get_handle_of_step(s)); });
+        path_handle_t q = loaded.get_path_handle("x");
+        loaded.for_each_step_in_path(q, [&](const step_handle_t& s) { b.push_back(loaded.get_handle_of_step(s)); });
+        REQUIRE(a == b);
+    };
+
+    SECTION("The versioned layout round trips") {
+        std::stringstream ss;
+        graph.serialize_members(ss);
+        graph_t loaded;
+        loaded.set_number_of_threads(4);
+        loaded.deserialize_members(ss);
+        check(loaded);
+    }
+
+    SECTION("The unversioned layout is still readable") {
+        std::stringstream ss;
+        ss.write((char*)&graph._max_node_id, sizeof(graph._max_node_id));
+        ss.write((char*)&graph._min_node_id, sizeof(graph._min_node_id));
+        uint64_t node_count = graph.node_v.size();
+        ss.write((char*)&node_count, sizeof(node_count));
+        ss.write((char*)&graph._edge_count, sizeof(graph._edge_count));
+        ss.write((char*)&graph._path_count, sizeof(graph._path_count));
+        ss.write((char*)&graph._path_handle_next, sizeof(graph._path_handle_next));
+        ss.write((char*)&graph._id_increment, sizeof(graph._id_increment));
+        node_t empty_node;
+        for (auto* node : graph.node_v) {
+            if (node == nullptr) {
+                empty_node.serialize(ss);
+            } else {
+                node->serialize(ss);
+            }
+        }
+        graph.serialize_path_metadata(ss);
+        graph_t loaded;
+        loaded.set_number_of_threads(4);
+        loaded.deserialize_members(ss);
+        check(loaded);
+    }
+}
+
+TEST_CASE("Graphs load with other thread counts than they were written with", "[handle]") {
+    graph_t graph;
+    // one thread writes groups of 4 blocks, so this spans two groups
+    const uint64_t n = 4 * graph_t::serialization_block_size + 1000;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < n; ++i) {
+        handles.push_back(graph.create_handle(i % 3 ? "A" : "CT"));
+        if (i) graph.create_edge(handles[i-1], handles[i]);
+    }
+    graph.destroy_handle(handles[n - 10]);
+    path_handle_t p = graph.create_path_handle("x");
+    for (uint64_t i = n - 500; i < n - 20; ++i) {
+        graph.append_step(p, handles[i]);
+    }
+
+    auto round_trip = [&](const uint64_t& write_threads, const uint64_t& read_threads) {
+        graph.set_number_of_threads(write_threads);
+        std::stringstream ss;
+        graph.serialize_members(ss);
+        graph_t loaded;
+        loaded.set_number_of_threads(read_threads);
+        loaded.deserialize_members(ss);
+        REQUIRE(loaded.get_node_count() == graph.get_node_count());
+        REQUIRE(loaded.get_edge_count() == graph.get_edge_count());
+        REQUIRE(!loaded.has_node(graph.get_id(handles[n - 10])));
+        for (uint64_t i = 0; i < n; i += 997) {
+            const nid_t id = graph.get_id(handles[i]);
+            REQUIRE(loaded.get_sequence(loaded.get_handle(id)) == graph.get_sequence(handles[i]));
+        }
+        REQUIRE(loaded.get_sequence(loaded.get_handle(graph.get_id(handles[n - 1]))) == graph.get_sequence(handles[n - 1]));
+        std::vector<nid_t> a, b;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& s) { a.push_back(graph.get_id(graph.get_handle_of_step(s))); });
+        path_handle_t q = loaded.get_path_handle("x");
+        loaded.for_each_step_in_path(q, [&](const step_handle_t& s) { b.push_back(loaded.get_id(loaded.get_handle_of_step(s))); });
+        REQUIRE(a == b);
+    };
+
+    SECTION("Written with one thread, read with three") {
+        round_trip(1, 3);
+    }
+
+    SECTION("Written with three threads, read with one") {
+        round_trip(3, 1);
+    }
+}
+
+TEST_CASE("Graph fingerprints follow the graph's contents, not its thread count", "[handle]") {
+    std::mt19937 rng(5);
+    graph_t graph;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 20000; ++i) {
+        handles.push_back(graph.create_handle(std::string(1 + i % 5, "ACGT"[i % 4])));
+        if (i) graph.create_edge(handles[i-1], handles[i]);
+    }
+    graph.destroy_handle(handles[77]);
+    for (uint64_t k = 0; k < 16; ++k) {
+        path_handle_t p = graph.create_path_handle("p" + std::to_string(k), k % 5 == 0);
+        for (uint64_t i = 0; i < 500; ++i) {
+            const handle_t h = handles[100 + rng() % 19000];
+            graph.append_step(p, rng() % 2 ? graph.flip(h) : h);
+        }
+    }
+    graph.set_number_of_threads(1);
+    const uint64_t fingerprint = graph.fingerprint();
+    for (const uint64_t threads : {2, 8}) {
+        graph.set_number_of_threads(threads);
+        REQUIRE(graph.fingerprint() == fingerprint);
+    }
+
+    // a graph written with one thread count and read with another holds the same
+    std::stringstream ss;
+    graph.set_number_of_threads(8);
+    graph.serialize_members(ss);
+    graph_t loaded;
+    loaded.set_number_of_threads(1);
+    loaded.deserialize_members(ss);
+    REQUIRE(loaded.fingerprint() == fingerprint);
+
+    // while a change to a sequence, an edge or a step does not
+    graph.create_edge(handles[5], handles[9]);
+    REQUIRE(graph.fingerprint() != fingerprint);
+    loaded.append_step(loaded.get_path_handle("p3"), loaded.get_handle(graph.get_id(handles[42])));
+    REQUIRE(loaded.fingerprint() != fingerprint);
+}
+
+TEST_CASE("Path steps staged on disk serialize like steps held in the nodes", "[handle]") {
+    std::mt19937 rng(11);
+    graph_t graph, bare;
+    std::vector<handle_t> handles;
+    for (uint64_t i = 0; i < 200; ++i) {
+        std::string seq(1 + i % 3, "ACGT"[i % 4]);
+        handles.push_back(graph.create_handle(seq));
+        bare.create_handle(seq);
+        if (i) {
+            graph.create_edge(handles[i-1], handles[i]);
+            bare.create_edge(bare.get_handle(i), bare.get_handle(i + 1));
+        }
+    }
+    std::string base = xp::temp_file::create("odgi_external_steps_test");
+    external_steps_t steps(base, 4);
+    for (uint64_t k = 0; k < 20; ++k) {
+        std::string name = "p" + std::to_string(k);
+        path_handle_t p = graph.create_path_handle(name);
+        path_handle_t q = bare.create_path_handle(name);
+        std::vector<handle_t> to_append;
+        // some paths are empty or a single step, and many revisit nodes
+        const uint64_t length = (k % 7 == 0 ? 0 : (k % 5 == 0 ? 1 : 1 + rng() % 300));
+        for (uint64_t i = 0; i < length; ++i) {
+            to_append.push_back(rng() % 2 ? handles[rng() % 200] : graph.flip(handles[rng() % 200]));
+        }
+        graph.append_steps(p, to_append);
+        steps.add_path(bare, q, to_append);
+    }
+    steps.index();
+    std::stringstream ss;
+    bare.serialize_external(ss, steps);
+    graph_t loaded;
+    loaded.deserialize(ss);
+    REQUIRE(loaded.get_path_count() == graph.get_path_count());
+    graph.for_each_path_handle([&](const path_handle_t& p) {
+        path_handle_t q = loaded.get_path_handle(graph.get_path_name(p));
+        REQUIRE(loaded.get_step_count(q) == graph.get_step_count(p));
+        std::vector<handle_t> a, b, c;
+        graph.for_each_step_in_path(p, [&](const step_handle_t& s) { a.push_back(graph.get_handle_of_step(s)); });
+        loaded.for_each_step_in_path(q, [&](const step_handle_t& s) { b.push_back(loaded.get_handle_of_step(s)); });
+        REQUIRE(a == b);
+        // and backwards, through the previous step links
+        if (!loaded.is_empty(q)) {
+            step_handle_t s = loaded.path_back(q);
+            c.push_back(loaded.get_handle_of_step(s));
+            while (loaded.has_previous_step(s)) {
+                s = loaded.get_previous_step(s);
+                c.push_back(loaded.get_handle_of_step(s));
+            }
+            std::reverse(c.begin(), c.end());
+        }
+        REQUIRE(a == c);
+    });
+    graph.for_each_handle([&](const handle_t& h) {
+        REQUIRE(loaded.get_step_count(loaded.get_handle(graph.get_id(h))) == graph.get_step_count(h));
+    });
+    xp::temp_file::remove(base);
+}
+
+TEST_CASE("Optimizing after a few deletions matches a full rebuild", "[handle]") {
+    auto build = [](graph_t& graph) {
+        std::vector<handle_t> handles;
+        for (uint64_t i = 0; i < 100; ++i) {
+            handles.push_back(graph.create_handle(std::string(1 + i % 5, "ACGT"[i % 4])));
+        }
+        for (uint64_t i = 1; i < 100; ++i) {
+            graph.create_edge(handles[i-1], handles[i]);
+            if (i > 2) graph.create_edge(handles[i-3], graph.flip(handles[i]));
+        }
+        path_handle_t p = graph.create_path_handle("p");
+        for (uint64_t i = 0; i < 100; ++i) {
+            if (i != 40 && i != 41 && i != 90) graph.append_step(p, handles[i]);
+        }
+        path_handle_t q = graph.create_path_handle("q");
+        for (uint64_t i = 99; i > 60; --i) {
+            if (i != 90) graph.append_step(q, graph.flip(handles[i]));
+        }
+        // paths skip the nodes we delete
+        graph.destroy_handle(handles[40]);
+        graph.destroy_handle(handles[41]);
+        graph.destroy_handle(handles[90]);
+    };
+    graph_t incremental, rebuilt;
+    build(incremental);
+    build(rebuilt);
+    incremental.optimize();
+    rebuilt.apply_ordering({}, true);
+
+    REQUIRE(incremental.is_optimized());
+    REQUIRE(incremental.get_node_count() == rebuilt.get_node_count());
+    REQUIRE(incremental.max_node_id() == rebuilt.max_node_id());
+    rebuilt.for_each_handle([&](const handle_t& h) {
+        handle_t i = incremental.get_handle(rebuilt.get_id(h));
+        REQUIRE(incremental.get_sequence(i) == rebuilt.get_sequence(h));
+        for (bool go_left : {false, true}) {
+            std::vector<nid_t> a, b;
+            rebuilt.follow_edges(h, go_left, [&](const handle_t& o) { a.push_back(rebuilt.get_id(o)); });
+            incremental.follow_edges(i, go_left, [&](const handle_t& o) { b.push_back(incremental.get_id(o)); });
+            std::sort(a.begin(), a.end());
+            std::sort(b.begin(), b.end());
+            REQUIRE(a == b);
+        }
+    });
+    rebuilt.for_each_path_handle([&](const path_handle_t& p) {
+        path_handle_t q = incremental.get_path_handle(rebuilt.get_path_name(p));
+        std::vector<std::pair<nid_t, bool>> a, b;
+        rebuilt.for_each_step_in_path(p, [&](const step_handle_t& s) {
+            handle_t h = rebuilt.get_handle_of_step(s);
+            a.push_back(std::make_pair(rebuilt.get_id(h), rebuilt.get_is_reverse(h)));
+        });
+        incremental.for_each_step_in_path(q, [&](const step_handle_t& s) {
+            handle_t h = incremental.get_handle_of_step(s);
+            b.push_back(std::make_pair(incremental.get_id(h), incremental.get_is_reverse(h)));
+        });
+        REQUIRE(a == b);
+        // and backwards
+        std::vector<std::pair<nid_t, bool>> c;
+        for (step_handle_t s = incremental.path_back(q); ; s = incremental.get_previous_step(s)) {
+            handle_t h = incremental.get_handle_of_step(s);
+            c.push_back(std::make_pair(incremental.get_id(h), incremental.get_is_reverse(h)));
+            if (!incremental.has_previous_step(s)) break;
+        }
+        std::reverse(c.begin(), c.end());
+        REQUIRE(a == c);
+    });
+
+    // a second optimize has nothing left to do
+    incremental.optimize();
+    REQUIRE(incremental.get_node_count() == rebuilt.get_node_count());
+}
+
+
+TEST_CASE("Bulk path appends match appending one step at a time", "[handle]") {
+    std::vector<std::vector<uint64_t>> walks = {
+        {0, 1, 2, 3, 4, 5, 6, 7},
+        {3, 3, 4, 3, 9, 8, 3, 0},
+        {5},
+        {9, 8, 7, 6, 5, 4, 3, 2, 1, 0, 1, 2}
+    };
+    auto build_nodes = [&](graph_t& graph, std::vector<handle_t>& handles) {
+        for (uint64_t i = 0; i < 10; ++i) {
+            handles.push_back(graph.create_handle("ACGT"));
+        }
+    };
+    auto walk_handles = [&](const graph_t& graph, const std::vector<handle_t>& handles,
+                            const std::vector<uint64_t>& walk, uint64_t w) {
+        std::vector<handle_t> steps;
+        for (uint64_t i = 0; i < walk.size(); ++i) {
+            // mix orientations
+            steps.push_back((i + w) % 3 ? handles[walk[i]] : graph.flip(handles[walk[i]]));
+        }
+        return steps;
+    };
+    graph_t single, bulk;
+    std::vector<handle_t> single_handles, bulk_handles;
+    build_nodes(single, single_handles);
+    build_nodes(bulk, bulk_handles);
+    single.set_number_of_threads(2);
+    bulk.set_number_of_threads(2);
+
+    // the first walk goes in one call, the rest of the walks in a multi-path call,
+    // then the first path is extended by a second single call
+    std::vector<std::pair<path_handle_t, std::vector<handle_t>>> runs;
+    for (uint64_t w = 0; w < walks.size(); ++w) {
+        path_handle_t s = single.create_path_handle("p" + std::to_string(w));
+        path_handle_t b = bulk.create_path_handle("p" + std::to_string(w));
+        for (auto& h : walk_handles(single, single_handles, walks[w], w)) {
+            single.append_step(s, h);
+        }
+        if (w == 0) {
+            bulk.append_steps(b, walk_handles(bulk, bulk_handles, walks[w], w));
+        } else {
+            runs.push_back(std::make_pair(b, walk_handles(bulk, bulk_handles, walks[w], w)));
+        }
+    }
+    bulk.append_steps(runs);
+    for (auto& h : walk_handles(single, single_handles, walks[1], 0)) {
+        single.append_step(single.get_path_handle("p0"), h);
+    }
+    bulk.append_steps(bulk.get_path_handle("p0"), walk_handles(bulk, bulk_handles, walks[1], 0));
+
+    single.for_each_path_handle([&](const path_handle_t& p) {
+        path_handle_t q = bulk.get_path_handle(single.get_path_name(p));
+        REQUIRE(bulk.get_step_count(q) == single.get_step_count(p));
+        std::vector<step_handle_t> a, b, c;
+        single.for_each_step_in_path(p, [&](const step_handle_t& s) { a.push_back(s); });
+        bulk.for_each_step_in_path(q, [&](const step_handle_t& s) { b.push_back(s); });
+        for (step_handle_t s = bulk.path_back(q); ; s = bulk.get_previous_step(s)) {
+            c.push_back(s);
+            if (!bulk.has_previous_step(s)) break;
+        }
+        std::reverse(c.begin(), c.end());
+        REQUIRE(a == b);
+        REQUIRE(a == c);
+    });
+
+    // appending nothing changes nothing
+    bulk.append_steps(bulk.get_path_handle("p2"), {});
+    REQUIRE(bulk.get_step_count(bulk.get_path_handle("p2")) == 1);
+}
+
 }
 }
@@ -0,0 +1,235 @@
+/**
+ * \file
+ * unittest/mmap_graph.cpp: test cases for the frozen, memory-mapped graph.
+ */
+
+#include "catch.hpp"
+
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+#include "mmap_graph.hpp"
+#include "algorithms/temp_file.hpp"
+#include "algorithms/node_path_membership.hpp"
+#include "algorithms/path_range_index.hpp"
+
+#include <vector>
+#include <string>
+#include <algorithm>
+
+namespace odgi {
+namespace unittest {
+
+using namespace std;
+using namespace handlegraph;
+
+TEST_CASE("A frozen graph answers like the graph it was frozen from", "[mmap_graph]") {
+
+    graph_t graph;
+    handle_t n1 = graph.create_handle("CAAATAAG");
+    handle_t n2 = graph.create_handle("A");
+    handle_t n3 = graph.create_handle("G");
+    handle_t n4 = graph.create_handle("TTG");
+    handle_t n5 = graph.create_handle("GTC");
+    graph.create_edge(n1, n2);
+    graph.create_edge(n1, n3);
+    graph.create_edge(n2, n4);
+    graph.create_edge(n3, graph.flip(n4));
+    graph.create_edge(n4, n4);
+    graph.create_edge(n4, n5);
+
+    path_handle_t p1 = graph.create_path_handle("b#1#chr1");
+    graph.append_step(p1, n1);
+    graph.append_step(p1, n2);
+    graph.append_step(p1, n4);
+    graph.append_step(p1, n4);
+    graph.append_step(p1, n5);
+    path_handle_t p2 = graph.create_path_handle("a#1#chr1", true);
+    graph.append_step(p2, n1);
+    graph.append_step(p2, n3);
+    graph.append_step(p2, graph.flip(n4));
+
+    std::string filename = algorithms::temp_file::create("mmap_graph");
+    mmap_graph_t::freeze(graph, filename);
+    REQUIRE(mmap_graph_t::is_frozen(filename));
+    mmap_graph_t frozen(filename);
+
+    SECTION("Nodes and sequences match") {
+        REQUIRE(frozen.get_node_count() == graph.get_node_count());
+        REQUIRE(frozen.min_node_id() == graph.min_node_id());
+        REQUIRE(frozen.max_node_id() == graph.max_node_id());
+        graph.for_each_handle([&](const handle_t& h) {
+            nid_t id = graph.get_id(h);
+            REQUIRE(frozen.has_node(id));
+            handle_t f = frozen.get_handle(id);
+            REQUIRE(frozen.get_sequence(f) == graph.get_sequence(h));
+            REQUIRE(frozen.get_sequence(frozen.flip(f)) == graph.get_sequence(graph.flip(h)));
+            REQUIRE(frozen.get_base(frozen.flip(f), 0) == graph.get_sequence(graph.flip(h))[0]);
+            REQUIRE(frozen.get_step_count(f) == graph.get_step_count(h));
+        });
+        REQUIRE(frozen.get_subsequence(frozen.flip(frozen.get_handle(1)), 1, 3) == "TTA");
+    }
+
+    SECTION("Edges match in both orientations") {
+        graph.for_each_handle([&](const handle_t& h) {
+            for (bool rev : {false, true}) {
+                for (bool go_left : {false, true}) {
+                    handle_t g = rev ? graph.flip(h) : h;
+                    handle_t f = frozen.get_handle(graph.get_id(h), rev);
+                    std::vector<handle_t> a, b;
+                    graph.follow_edges(g, go_left, [&](const handle_t& o) { a.push_back(o); });
+                    frozen.follow_edges(f, go_left, [&](const handle_t& o) { b.push_back(o); });
+                    std::sort(a.begin(), a.end());
+                    std::sort(b.begin(), b.end());
+                    REQUIRE(a == b);
+                    REQUIRE(frozen.get_degree(f, go_left) == a.size());
+                }
+            }
+        });
+    }
+
+    SECTION("Paths match") {
+        REQUIRE(frozen.get_path_count() == 2);
+        REQUIRE(frozen.has_path("a#1#chr1"));
+        REQUIRE(!frozen.has_path("c#1#chr1"));
+        REQUIRE(frozen.get_is_circular(frozen.get_path_handle("a#1#chr1")));
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            path_handle_t q = frozen.get_path_handle(graph.get_path_name(p));
+            REQUIRE(frozen.get_path_name(q) == graph.get_path_name(p));
+            std::vector<handle_t> a, b;
+            graph.for_each_step_in_path(p, [&](const step_handle_t& s) { a.push_back(graph.get_handle_of_step(s)); });
+            frozen.for_each_step_in_path(q, [&](const step_handle_t& s) { b.push_back(frozen.get_handle_of_step(s)); });
+            REQUIRE(a == b);
+            REQUIRE(frozen.get_step_count(q) == a.size());
+            // walk backwards, counting steps as circular paths wrap around
+            std::vector<handle_t> c;
+            step_handle_t s = frozen.path_back(q);
+            for (uint64_t i = 0; i < frozen.get_step_count(q); ++i, s = frozen.get_previous_step(s)) {
+                c.push_back(frozen.get_handle_of_step(s));
+            }
+            std::reverse(c.begin(), c.end());
+            REQUIRE(a == c);
+        });
+        uint64_t n4_steps = 0;
+        frozen.for_each_step_on_handle(frozen.get_handle(4), [&](const step_handle_t& s) {
+            REQUIRE(frozen.get_id(frozen.get_handle_of_step(s)) == 4);
+            ++n4_steps;
+        });
+        REQUIRE(n4_steps == 3);
+    }
+
+    SECTION("Steps of circular paths wrap around, and those of linear paths end") {
+        path_handle_t circular = frozen.get_path_handle("a#1#chr1");
+        REQUIRE(frozen.has_next_step(frozen.path_back(circular)));
+        REQUIRE(frozen.get_next_step(frozen.path_back(circular)) == frozen.path_begin(circular));
+        REQUIRE(frozen.has_previous_step(frozen.path_begin(circular)));
+        REQUIRE(frozen.get_previous_step(frozen.path_begin(circular)) == frozen.path_back(circular));
+        path_handle_t linear = frozen.get_path_handle("b#1#chr1");
+        REQUIRE(!frozen.has_next_step(frozen.path_back(linear)));
+        REQUIRE(frozen.get_next_step(frozen.path_back(linear)) == frozen.path_end(linear));
+        REQUIRE(!frozen.has_previous_step(frozen.path_begin(linear)));
+        REQUIRE(frozen.get_previous_step(frozen.path_begin(linear)) == frozen.path_front_end(linear));
+        REQUIRE(frozen.has_next_step(frozen.path_begin(linear)));
+    }
+
+    SECTION("Indexes of read-only subcommands are built from the mapping as from the graph") {
+        // ranks by path name, as path handles differ between the two
+        auto ranks_of = [](const PathHandleGraph& g) {
+            std::vector<uint32_t> ranks;
+            g.for_each_path_handle([&](const path_handle_t& p) {
+                const uint64_t i = as_integer(p);
+                if (ranks.size() <= i) {
+                    ranks.resize(i + 1, algorithms::node_path_membership_t::no_rank);
+                }
+                ranks[i] = g.get_path_name(p) == "a#1#chr1" ? 0 : 1;
+            });
+            return ranks;
+        };
+        const algorithms::node_path_membership_t from_graph(graph, ranks_of(graph), 2);
+        const algorithms::node_path_membership_t from_frozen(frozen, ranks_of(frozen), 2);
+        graph.for_each_handle([&](const handle_t& h) {
+            const nid_t id = graph.get_id(h);
+            std::vector<std::pair<uint32_t, uint32_t>> a, b;
+            from_graph.for_each_member(id, [&](const uint32_t& rank, const uint32_t& steps) { a.push_back({rank, steps}); });
+            from_frozen.for_each_member(id, [&](const uint32_t& rank, const uint32_t& steps) { b.push_back({rank, steps}); });
+            REQUIRE(a == b);
+        });
+        algorithms::path_range_index_t range_index(frozen);
+        path_handle_t q = frozen.get_path_handle("b#1#chr1");
+        REQUIRE(range_index.get_path_length(q) == 18);
+        REQUIRE(frozen.get_id(frozen.get_handle_of_step(range_index.get_step(q, range_index.get_rank(q, 10)))) == 4);
+    }
+
+    SECTION("Thawing gives back an equivalent graph") {
+        graph_t thawed;
+        frozen.thaw(thawed);
+        REQUIRE(thawed.get_node_count() == graph.get_node_count());
+        REQUIRE(thawed.get_path_count() == graph.get_path_count());
+        graph.for_each_handle([&](const handle_t& h) {
+            handle_t t = thawed.get_handle(graph.get_id(h));
+            REQUIRE(thawed.get_sequence(t) == graph.get_sequence(h));
+            REQUIRE(thawed.get_degree(t, false) == graph.get_degree(h, false));
+            REQUIRE(thawed.get_degree(t, true) == graph.get_degree(h, true));
+        });
+        graph.for_each_path_handle([&](const path_handle_t& p) {
+            path_handle_t q = thawed.get_path_handle(graph.get_path_name(p));
+            std::vector<handle_t> a, b;
+            graph.for_each_step_in_path(p, [&](const step_handle_t& s) { a.push_back(graph.get_handle_of_step(s)); });
+            thawed.for_each_step_in_path(q, [&](const step_handle_t& s) { b.push_back(thawed.get_handle_of_step(s)); });
+            REQUIRE(a == b);
+        });
+    }
+
+    frozen.close();
+    algorithms::temp_file::remove(filename);
+}
+
+TEST_CASE("Nodes with empty sequences stay in a frozen graph, unlike deleted ones", "[mmap_graph]") {
+    graph_t graph;
+    handle_t n1 = graph.create_handle("CA");
+    // create_handle only takes non-empty sequences, while loaded graphs may hold empty ones
+    handle_t n2 = graph.load_node("", 2);
+    handle_t n3 = graph.create_handle("T");
+    handle_t n4 = graph.create_handle("GG");
+    graph.create_edge(n1, n2);
+    graph.create_edge(n2, n4);
+    graph.create_edge(n1, graph.flip(n4));
+    graph.destroy_handle(n3);
+    path_handle_t p = graph.create_path_handle("x");
+    graph.append_step(p, n1);
+    graph.append_step(p, n2);
+    graph.append_step(p, n4);
+
+    std::string filename = algorithms::temp_file::create("mmap_graph");
+    mmap_graph_t::freeze(graph, filename, 2);
+    mmap_graph_t frozen(filename);
+    REQUIRE(frozen.get_node_count() == 3);
+    REQUIRE(frozen.has_node(2));
+    REQUIRE(frozen.get_length(frozen.get_handle(2)) == 0);
+    REQUIRE(!frozen.has_node(3));
+    std::vector<nid_t> ids;
+    frozen.for_each_handle([&](const handle_t& h) { ids.push_back(frozen.get_id(h)); });
+    REQUIRE(ids == std::vector<nid_t>{1, 2, 4});
+    REQUIRE(frozen.has_edge(frozen.get_handle(1), frozen.get_handle(2)));
+    REQUIRE(frozen.has_edge(frozen.get_handle(2), frozen.get_handle(4)));
+
+    graph_t thawed;
+    frozen.thaw(thawed, 2);
+    REQUIRE(thawed.get_node_count() == 3);
+    REQUIRE(thawed.get_edge_count() == graph.get_edge_count());
+    REQUIRE(thawed.has_node(2));
+    REQUIRE(!thawed.has_node(3));
+    REQUIRE(thawed.has_edge(thawed.get_handle(1), thawed.get_handle(2)));
+    REQUIRE(thawed.has_edge(thawed.get_handle(2), thawed.get_handle(4)));
+    REQUIRE(thawed.has_edge(thawed.get_handle(1), thawed.get_handle(4, true)));
+    std::vector<handle_t> steps;
+    thawed.for_each_step_in_path(thawed.get_path_handle("x"), [&](const step_handle_t& s) {
+        steps.push_back(thawed.get_handle_of_step(s));
+    });
+    REQUIRE(steps == std::vector<handle_t>{thawed.get_handle(1), thawed.get_handle(2), thawed.get_handle(4)});
+
+    frozen.close();
+    algorithms::temp_file::remove(filename);
+}
+
+}
+}
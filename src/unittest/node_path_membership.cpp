@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+
+#include "src/algorithms/node_path_membership.hpp"
+
+namespace odgi {
+
+    namespace unittest {
+
+    using namespace std;
+    using namespace handlegraph;
+
+        TEST_CASE("Finding the paths and groups on each node", "[node_path_membership]") {
+            graph_t graph;
+            handle_t n1 = graph.create_handle("CAA");
+            handle_t n2 = graph.create_handle("A");
+            handle_t n3 = graph.create_handle("GTC");
+            handle_t n4 = graph.create_handle("TT");
+            graph.create_edge(n1, n2);
+            graph.create_edge(n2, n3);
+            graph.create_edge(n3, n4);
+            graph.create_edge(n4, n2);
+
+            // x: 1 2 3 4, y: 2 3 4 2 3, z: 1 2
+            auto path_x = graph.create_path_handle("x");
+            for (auto& h : {n1, n2, n3, n4}) graph.append_step(path_x, h);
+            auto path_y = graph.create_path_handle("y");
+            for (auto& h : {n2, n3, n4, n2, n3}) graph.append_step(path_y, h);
+            auto path_z = graph.create_path_handle("z");
+            for (auto& h : {n1, n2}) graph.append_step(path_z, h);
+
+            auto members_of = [](const algorithms::node_path_membership_t& membership, const nid_t& id) {
+                std::vector<std::pair<uint32_t, uint32_t>> members;
+                membership.for_each_member(id, [&](const uint32_t& rank, const uint32_t& steps) {
+                    members.push_back(std::make_pair(rank, steps));
+                });
+                return members;
+            };
+
+            SECTION("Each path has its own rank") {
+                // with three ranks, nodes crossed by all of them keep a bitmap and the others an array
+                std::vector<uint32_t> path_ranks = {algorithms::node_path_membership_t::no_rank, 0, 1, 2};
+                const algorithms::node_path_membership_t membership(graph, path_ranks, 3);
+                using members_t = std::vector<std::pair<uint32_t, uint32_t>>;
+                REQUIRE(members_of(membership, 1) == members_t{{0, 1}, {2, 1}});
+                REQUIRE(members_of(membership, 2) == members_t{{0, 1}, {1, 2}, {2, 1}});
+                REQUIRE(members_of(membership, 3) == members_t{{0, 1}, {1, 2}});
+                REQUIRE(members_of(membership, 4) == members_t{{0, 1}, {1, 1}});
+                REQUIRE(membership.get_member_count(2) == 3);
+                REQUIRE(membership.get_step_count(2, 1) == 2);
+                REQUIRE(membership.get_step_count(2, 2) == 1);
+                REQUIRE(membership.get_step_count(3, 2) == 0);
+                REQUIRE(membership.has_member(1, 2));
+                REQUIRE(!membership.has_member(1, 1));
+                REQUIRE(membership.get_member_count(5) == 0);
+            }
+
+            SECTION("Grouped paths share a rank, and paths without a group are skipped") {
+                std::vector<uint32_t> path_ranks = {algorithms::node_path_membership_t::no_rank, 0, 0,
+                                                    algorithms::node_path_membership_t::no_rank};
+                const algorithms::node_path_membership_t membership(graph, path_ranks, 1);
+                REQUIRE(membership.get_step_count(1, 0) == 1);
+                REQUIRE(membership.get_step_count(2, 0) == 3);
+                REQUIRE(membership.get_step_count(4, 0) == 2);
+            }
+        }
+
+    }
+
+}
@@ -0,0 +1,95 @@
+/**
+ * \file
+ * unittest/packed_sequence.cpp: test cases for 2-bit packed node sequences.
+ */
+
+#include "catch.hpp"
+
+#include "odgi.hpp"
+#include "packed_sequence.hpp"
+#include "dna.hpp"
+
+#include <string>
+#include <random>
+
+namespace odgi {
+namespace unittest {
+
+using namespace std;
+
+TEST_CASE("Packed sequences decode to what was packed", "[packed_sequence]") {
+    std::mt19937 rng(42);
+    const std::string alphabet = "ACGTACGTACGTNnRYacgt";
+    for (uint64_t len : {64, 65, 127, 1000}) {
+        std::string seq;
+        for (uint64_t i = 0; i < len; ++i) {
+            // mostly ACGT with some runs of other characters
+            seq.push_back(i % 50 < 5 ? 'N' : alphabet[rng() % 12]);
+        }
+        seq[len / 2] = 'y';
+        std::string packed;
+        REQUIRE(packed_sequence::pack(seq, packed));
+        REQUIRE(packed.size() < seq.size());
+        REQUIRE(packed_sequence::length(packed) == len);
+        REQUIRE(packed_sequence::unpack(packed) == seq);
+        std::string rc = reverse_complement(seq);
+        for (uint64_t i = 0; i < len; ++i) {
+            REQUIRE(packed_sequence::base(packed, i) == seq[i]);
+        }
+        for (uint64_t begin : {(uint64_t)0, (uint64_t)3, len / 3}) {
+            uint64_t n = len - begin - 1;
+            std::string fwd(n, '\0'), rev(n, '\0');
+            packed_sequence::unpack(packed, begin, n, false, &fwd[0]);
+            packed_sequence::unpack(packed, begin, n, true, &rev[0]);
+            REQUIRE(fwd == seq.substr(begin, n));
+            REQUIRE(rev == rc.substr(begin, n));
+        }
+    }
+    std::string packed;
+    REQUIRE(!packed_sequence::pack("ACGT", packed));
+    REQUIRE(!packed_sequence::pack("NRNRNRNRNRNRNRNRNRNRNRNR", packed));
+}
+
+TEST_CASE("Graphs with compact sequences behave like plain ones", "[packed_sequence]") {
+    graph_t graph;
+    graph.set_compact_sequences(true);
+    const std::string s1 = "CAAATAAGGCTTGGAAATTTTCTGGAGTTCTATTATATTCCAACTCTCTG";
+    const std::string s2 = "GNNNNNNNNNNNNNNNNNNNACGTACGTACGTACGTACGTACGTACGTTT";
+    handle_t h1 = graph.create_handle(s1);
+    handle_t h2 = graph.create_handle(s2);
+    handle_t h3 = graph.create_handle("A");
+    graph.create_edge(h1, h2);
+    graph.create_edge(h2, h3);
+    REQUIRE(graph.get_sequence(h1) == s1);
+    REQUIRE(graph.get_sequence(h2) == s2);
+    REQUIRE(graph.get_sequence(graph.flip(h2)) == reverse_complement(s2));
+    REQUIRE(graph.get_subsequence(graph.flip(h1), 5, 10) == reverse_complement(s1).substr(5, 10));
+    REQUIRE(graph.get_base(graph.flip(h2), 0) == 'A');
+    REQUIRE(graph.get_length(h2) == s2.size());
+    std::string walked;
+    graph.for_each_base(graph.flip(h1), [&](const char& c) { walked.push_back(c); return true; });
+    REQUIRE(walked == reverse_complement(s1));
+
+    // splitting and flipping keep the sequence right
+    auto parts = graph.divide_handle(h2, std::vector<size_t>{10, 30});
+    REQUIRE(graph.get_sequence(parts[0]) + graph.get_sequence(parts[1]) + graph.get_sequence(parts[2]) == s2);
+    handle_t f = graph.apply_orientation(graph.flip(h1));
+    REQUIRE(graph.get_sequence(f) == reverse_complement(s1));
+
+    // the choice survives serialization
+    std::stringstream ss;
+    graph.serialize_members(ss);
+    graph_t loaded;
+    loaded.deserialize_members(ss);
+    REQUIRE(loaded.get_compact_sequences());
+    graph.for_each_handle([&](const handle_t& h) {
+        REQUIRE(loaded.get_sequence(loaded.get_handle(graph.get_id(h))) == graph.get_sequence(h));
+    });
+
+    // and can be undone
+    graph.set_compact_sequences(false);
+    REQUIRE(graph.get_sequence(parts[1]) == s2.substr(10, 20));
+}
+
+}
+}
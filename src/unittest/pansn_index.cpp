@@ -0,0 +1,73 @@
+#include "catch.hpp"
+
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+
+#include <sstream>
+
+#include "src/algorithms/pansn_index.hpp"
+
+namespace odgi {
+
+    namespace unittest {
+
+    using namespace std;
+    using namespace handlegraph;
+
+        TEST_CASE("Grouping paths by their PanSN names", "[pansn_index]") {
+            graph_t graph;
+            handle_t n1 = graph.create_handle("CAA");
+            std::vector<path_handle_t> paths;
+            for (auto& name : {"HG002#2#chr1", "HG002#1#chr2", "chm13#chr1", "HG002#1#chr1", "grch38", "HG00438#1#chr1"}) {
+                paths.push_back(graph.create_path_handle(name));
+                graph.append_step(paths.back(), n1);
+            }
+            auto names_of = [&](const algorithms::pansn_index_t& index, const std::pair<uint64_t, uint64_t>& range) {
+                std::vector<std::string> names;
+                for (uint64_t i = range.first; i < range.second; ++i) {
+                    names.push_back(graph.get_path_name(index.get_paths()[i]));
+                }
+                return names;
+            };
+
+            algorithms::pansn_index_t index(graph);
+
+            SECTION("Samples and haplotypes are ranges of the sorted paths") {
+                REQUIRE(index.get_level_count() == 2);
+                REQUIRE(index.get_group_count(0) == 4);
+                REQUIRE(index.get_group_count(1) == 5);
+                REQUIRE(index.get_group_name(0, index.get_group(paths[1], 0)) == "HG002");
+                REQUIRE(index.get_group_name(1, index.get_group(paths[1], 1)) == "HG002#1");
+                // names without a haplotype, or without any delimiter, stay with their sample
+                REQUIRE(index.get_group_name(1, index.get_group(paths[2], 1)) == "chm13");
+                REQUIRE(index.get_group_name(1, index.get_group(paths[4], 1)) == "grch38");
+                REQUIRE(index.get_delimiter_count(paths[2]) == 1);
+                REQUIRE(index.get_delimiter_count(paths[4]) == 0);
+                REQUIRE(names_of(index, index.find("HG002")) == std::vector<std::string>{"HG002#1#chr1", "HG002#1#chr2", "HG002#2#chr1"});
+                REQUIRE(names_of(index, index.find("HG002#1")) == std::vector<std::string>{"HG002#1#chr1", "HG002#1#chr2"});
+                REQUIRE(names_of(index, index.find("HG0")).empty());
+                const auto subgroups = index.get_subgroups(0, index.get_group(paths[0], 0));
+                REQUIRE(subgroups.second - subgroups.first == 2);
+                REQUIRE(index.get_group_name(1, subgroups.first) == "HG002#1");
+            }
+
+            SECTION("A saved index is loaded with the same groups") {
+                std::stringstream ss;
+                index.save(ss);
+                algorithms::pansn_index_t loaded;
+                loaded.load(ss);
+                REQUIRE(loaded.get_paths() == index.get_paths());
+                for (auto& path : paths) {
+                    for (uint64_t level = 0; level < 2; ++level) {
+                        REQUIRE(loaded.get_group_name(level, loaded.get_group(path, level))
+                                == index.get_group_name(level, index.get_group(path, level)));
+                    }
+                }
+                REQUIRE(names_of(loaded, loaded.find("HG002#2")) == std::vector<std::string>{"HG002#2#chr1"});
+            }
+        }
+
+    }
+
+}
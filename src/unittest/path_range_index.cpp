@@ -0,0 +1,146 @@
+#include "catch.hpp"
+
+#include <handlegraph/handle_graph.hpp>
+#include <handlegraph/util.hpp>
+#include "odgi.hpp"
+
+#include <sstream>
+#include <filesystem>
+#include <chrono>
+
+#include "src/algorithms/path_range_index.hpp"
+#include "src/algorithms/index_cache.hpp"
+
+namespace odgi {
+
+    namespace unittest {
+
+    using namespace std;
+    using namespace handlegraph;
+
+        TEST_CASE("Finding the steps in path ranges", "[path_range_index]") {
+            graph_t graph;
+            handle_t n1 = graph.create_handle("CAA");
+            handle_t n2 = graph.create_handle("A");
+            handle_t n3 = graph.create_handle("GTC");
+            handle_t n4 = graph.create_handle("TT");
+            graph.create_edge(n1, n2);
+            graph.create_edge(n2, n3);
+            graph.create_edge(n3, n4);
+
+            // x: CAA A GTC TT, y: A TT, z is empty
+            auto path_x = graph.create_path_handle("x");
+            std::vector<step_handle_t> x_steps = {graph.append_step(path_x, n1), graph.append_step(path_x, n2),
+                                                  graph.append_step(path_x, n3), graph.append_step(path_x, n4)};
+            auto path_y = graph.create_path_handle("y");
+            std::vector<step_handle_t> y_steps = {graph.append_step(path_y, n2), graph.append_step(path_y, n4)};
+            auto path_z = graph.create_path_handle("z");
+
+            algorithms::path_range_index_t index(graph);
+
+            SECTION("Offsets are resolved to the steps covering them") {
+                REQUIRE(index.get_path_length(path_x) == 9);
+                REQUIRE(index.get_step_count(path_x) == 4);
+                REQUIRE(index.get_rank(path_x, 0) == 0);
+                REQUIRE(index.get_rank(path_x, 2) == 0);
+                REQUIRE(index.get_rank(path_x, 3) == 1);
+                REQUIRE(index.get_rank(path_x, 4) == 2);
+                REQUIRE(index.get_rank(path_x, 8) == 3);
+                REQUIRE(index.get_rank(path_x, 9) == 4);
+                REQUIRE(index.get_offset(path_x, 2) == 4);
+                REQUIRE(index.get_offset(path_x, 4) == 9);
+                REQUIRE(index.get_step(path_x, 2) == x_steps[2]);
+                REQUIRE(index.get_path_length(path_z) == 0);
+                REQUIRE(index.get_rank(path_z, 0) == 0);
+            }
+
+            SECTION("Ranges are resolved to the steps overlapping them") {
+                std::vector<path_range_t> ranges = {
+                    {{path_x, 2, false}, {path_x, 5, false}, false, "", ""},
+                    {{path_x, 3, false}, {path_x, 4, false}, false, "", ""},
+                    {{path_y, 0, false}, {path_y, 100, false}, false, "", ""},
+                    {{path_x, 9, false}, {path_x, 12, false}, false, "", ""},
+                    {{path_z, 0, false}, {path_z, 1, false}, false, "", ""}};
+                std::vector<std::vector<step_handle_t>> steps;
+                index.steps_in_range(ranges, steps, 2);
+                REQUIRE(steps.size() == ranges.size());
+                REQUIRE(steps[0] == std::vector<step_handle_t>(x_steps.begin(), x_steps.begin() + 3));
+                REQUIRE(steps[1] == std::vector<step_handle_t>{x_steps[1]});
+                REQUIRE(steps[2] == y_steps);
+                REQUIRE(steps[3].empty());
+                REQUIRE(steps[4].empty());
+            }
+
+            SECTION("A saved index is loaded without walking the paths again") {
+                index.index_paths({path_x, path_y}, 2);
+                std::stringstream ss;
+                index.save(ss);
+                algorithms::path_range_index_t loaded(graph);
+                loaded.load(ss);
+                for (uint64_t offset = 0; offset <= 10; ++offset) {
+                    REQUIRE(loaded.get_rank(path_x, offset) == index.get_rank(path_x, offset));
+                    REQUIRE(loaded.get_rank(path_y, offset) == index.get_rank(path_y, offset));
+                }
+                REQUIRE(loaded.get_step(path_y, 1) == y_steps[1]);
+            }
+
+            SECTION("All paths are kept in an index cache and loaded from there on later runs") {
+                const std::string dir = xp::temp_file::get_dir() + "/path_range_index_cache";
+                algorithms::index_cache_t cache(dir, "graph.og");
+                algorithms::cached_path_range_index(&cache, graph, index, 2, false);
+                const std::string cached = cache.file_of(graph.fingerprint(), "rngidx");
+                REQUIRE(std::filesystem::is_regular_file(cached));
+                // a rebuilt index would be renamed into place with a new write time
+                const auto stamp = std::filesystem::file_time_type::clock::now() - std::chrono::hours(24);
+                std::filesystem::last_write_time(cached, stamp);
+                algorithms::path_range_index_t loaded(graph);
+                algorithms::cached_path_range_index(&cache, graph, loaded, 2, false);
+                REQUIRE(std::filesystem::last_write_time(cached) == stamp);
+                for (uint64_t offset = 0; offset <= 10; ++offset) {
+                    REQUIRE(loaded.get_rank(path_x, offset) == index.get_rank(path_x, offset));
+                    REQUIRE(loaded.get_rank(path_y, offset) == index.get_rank(path_y, offset));
+                }
+                REQUIRE(loaded.get_step_count(path_z) == 0);
+                REQUIRE(loaded.get_step(path_x, 2) == x_steps[2]);
+                std::filesystem::remove_all(dir);
+            }
+
+            SECTION("A graph rebuilt with the steps on its nodes in another order doesn't load the cached index") {
+                graph_t rebuilt;
+                handle_t m1 = rebuilt.create_handle("CAA");
+                handle_t m2 = rebuilt.create_handle("A");
+                handle_t m3 = rebuilt.create_handle("GTC");
+                handle_t m4 = rebuilt.create_handle("TT");
+                rebuilt.create_edge(m1, m2);
+                rebuilt.create_edge(m2, m3);
+                rebuilt.create_edge(m3, m4);
+                auto rebuilt_x = rebuilt.create_path_handle("x");
+                auto rebuilt_y = rebuilt.create_path_handle("y");
+                rebuilt.create_path_handle("z");
+                // y's steps come first on the nodes it shares with x
+                rebuilt.append_step(rebuilt_y, m2);
+                rebuilt.append_step(rebuilt_y, m4);
+                for (auto& h : {m1, m2, m3, m4}) {
+                    rebuilt.append_step(rebuilt_x, h);
+                }
+                REQUIRE(rebuilt.fingerprint() != graph.fingerprint());
+
+                const std::string dir = xp::temp_file::get_dir() + "/path_range_index_cache_ranks";
+                algorithms::index_cache_t cache(dir, "graph.og");
+                algorithms::cached_path_range_index(&cache, graph, index, 2, false);
+                algorithms::path_range_index_t rebuilt_index(rebuilt);
+                algorithms::cached_path_range_index(&cache, rebuilt, rebuilt_index, 2, false);
+                for (auto& path : {rebuilt_x, rebuilt_y}) {
+                    uint64_t rank = 0;
+                    rebuilt.for_each_step_in_path(path, [&](const step_handle_t& step) {
+                        REQUIRE(rebuilt_index.get_step(path, rank++) == step);
+                    });
+                }
+                REQUIRE(rebuilt_index.get_step(rebuilt_x, 1) != x_steps[1]);
+                std::filesystem::remove_all(dir);
+            }
+        }
+
+    }
+
+}
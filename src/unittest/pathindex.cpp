@@ -8,6 +8,7 @@
 #include <handlegraph/util.hpp>
 #include "odgi.hpp"
 #include "algorithms/xp.hpp"
+#include "algorithms/position_batch.hpp"
 #include <sdsl/bit_vectors.hpp>
 
 namespace odgi {
@@ -306,5 +307,213 @@ namespace odgi {
                 // REQUIRE(loaded_path_index.get_pangenome_pos("4", 1) == 0);
             }
         }
+
+        TEST_CASE("XP construction in memory matches construction through temporary files", "[pathindex]") {
+            // also on a graph whose destroyed node leaves a hole until it is optimized, so
+            // that the last node's handle rank is past the node count
+            for (const bool destroy : {false, true}) {
+                graph_t graph;
+                std::vector<handle_t> handles;
+                for (uint64_t i = 0; i < 50; ++i) {
+                    handles.push_back(graph.create_handle(std::string(1 + i % 4, "ACGT"[i % 4])));
+                    if (i) graph.create_edge(handles[i-1], handles[i]);
+                }
+                if (destroy) {
+                    graph.destroy_handle(handles[3]);
+                    REQUIRE(number_bool_packing::unpack_number(handles[49]) >= graph.get_node_count());
+                }
+                for (uint64_t k = 0; k < 5; ++k) {
+                    path_handle_t p = graph.create_path_handle("p" + std::to_string(k));
+                    // paths revisit nodes, and end on one of the last nodes
+                    for (uint64_t i = k; i < 49; i += 1 + k) {
+                        if (!destroy || i != 3) {
+                            graph.append_step(p, handles[i]);
+                        }
+                        if (!destroy || (i * 7) % 49 != 3) {
+                            graph.append_step(p, graph.flip(handles[(i * 7) % 49]));
+                        }
+                    }
+                    graph.append_step(p, handles[49 - k]);
+                }
+
+                XP in_memory, on_disk;
+                set_memory_budget(std::numeric_limits<uint64_t>::max());
+                in_memory.from_handle_graph(graph, 2);
+                set_memory_budget(1);
+                on_disk.from_handle_graph(graph, 2);
+                set_memory_budget(0);
+
+                REQUIRE(in_memory.get_nr_iv() == on_disk.get_nr_iv());
+                REQUIRE(in_memory.get_npi_iv() == on_disk.get_npi_iv());
+                REQUIRE(in_memory.get_np_bv() == on_disk.get_np_bv());
+                REQUIRE(in_memory.path_count == on_disk.path_count);
+                for (uint64_t k = 0; k < 5; ++k) {
+                    const std::string name = "p" + std::to_string(k);
+                    REQUIRE(as_integer(in_memory.get_path_handle(name)) == as_integer(on_disk.get_path_handle(name)));
+                }
+            }
+        }
+
+        TEST_CASE("A mapped XP index loads its paths when they are first used", "[pathindex]") {
+            graph_t graph;
+            std::vector<handle_t> handles;
+            for (uint64_t i = 0; i < 30; ++i) {
+                handles.push_back(graph.create_handle(std::string(1 + i % 3, "ACGT"[i % 4])));
+                if (i) graph.create_edge(handles[i-1], handles[i]);
+            }
+            for (uint64_t k = 0; k < 4; ++k) {
+                path_handle_t p = graph.create_path_handle("chr" + std::to_string(k));
+                for (uint64_t i = k; i < 30; i += 1 + k) {
+                    graph.append_step(p, k % 2 ? graph.flip(handles[i]) : handles[i]);
+                }
+            }
+            XP path_index;
+            path_index.from_handle_graph(graph, 2);
+            std::string filename = temp_file::create() + "unittest_mapped.xp";
+            std::ofstream out(filename);
+            path_index.serialize_members(out);
+            out.close();
+
+            XP mapped;
+            mapped.load(filename);
+            REQUIRE(mapped.path_count == path_index.path_count);
+            // query one path first, as a server would
+            REQUIRE(mapped.get_path_step_count(mapped.get_path_handle("chr2")) == path_index.get_path_step_count(path_index.get_path_handle("chr2")));
+            for (uint64_t k = 0; k < 4; ++k) {
+                const std::string name = "chr" + std::to_string(k);
+                path_handle_t p = mapped.get_path_handle(name);
+                REQUIRE(as_integer(p) == as_integer(path_index.get_path_handle(name)));
+                REQUIRE(mapped.get_path_length(p) == path_index.get_path_length(p));
+                for (uint64_t pos = 0; pos < mapped.get_path_length(p); ++pos) {
+                    REQUIRE(mapped.get_pangenome_pos(name, pos) == path_index.get_pangenome_pos(name, pos));
+                    step_handle_t s = mapped.get_step_at_position(p, pos);
+                    REQUIRE(as_integer(mapped.get_handle_of_step(s)) == as_integer(path_index.get_handle_of_step(s)));
+                }
+            }
+            REQUIRE(mapped.get_nr_iv() == path_index.get_nr_iv());
+            REQUIRE(mapped.get_npi_iv() == path_index.get_npi_iv());
+            REQUIRE(mapped.get_np_bv() == path_index.get_np_bv());
+            temp_file::remove(filename);
+        }
+
+        TEST_CASE("Loading an XP index again replaces the one loaded before", "[pathindex]") {
+            // two indexes with different paths
+            auto build = [](XP& path_index, const std::string& prefix, const uint64_t& path_count) {
+                graph_t graph;
+                std::vector<handle_t> handles;
+                for (uint64_t i = 0; i < 20; ++i) {
+                    handles.push_back(graph.create_handle(std::string(1 + i % 3, "ACGT"[i % 4])));
+                    if (i) graph.create_edge(handles[i-1], handles[i]);
+                }
+                for (uint64_t k = 0; k < path_count; ++k) {
+                    path_handle_t p = graph.create_path_handle(prefix + std::to_string(k));
+                    for (uint64_t i = k; i < 20; i += 1 + k) {
+                        graph.append_step(p, handles[i]);
+                    }
+                }
+                path_index.from_handle_graph(graph, 2);
+            };
+            XP chr_index, scaffold_index;
+            build(chr_index, "chr", 4);
+            build(scaffold_index, "scaffold", 2);
+            // building cleans up temporary files, so we only create ours once both are built
+            std::vector<std::string> filenames;
+            for (XP* path_index : {&chr_index, &scaffold_index}) {
+                filenames.push_back(temp_file::create() + "unittest_reload.xp");
+                std::ofstream out(filenames.back());
+                path_index->serialize_members(out);
+            }
+
+            XP index;
+            index.load(filenames[0]);
+            REQUIRE(index.path_count == 4);
+            REQUIRE(index.get_path_length(index.get_path_handle("chr3")) > 0);
+            index.load(filenames[1]);
+            REQUIRE(index.path_count == 2);
+            REQUIRE(index.has_path("scaffold1"));
+            REQUIRE(!index.has_path("chr3"));
+            REQUIRE(index.get_path_length(index.get_path_handle("scaffold1")) == 20);
+            std::ifstream in(filenames[0]);
+            index.load(in);
+            REQUIRE(index.path_count == 4);
+            REQUIRE(index.has_path("chr3"));
+            REQUIRE(!index.has_path("scaffold1"));
+            REQUIRE(index.get_path_length(index.get_path_handle("chr0")) == 39);
+            for (auto& filename : filenames) {
+                temp_file::remove(filename);
+            }
+        }
+
+        TEST_CASE("Batches of path positions are lifted like single lookups", "[pathindex]") {
+            graph_t graph;
+            std::vector<handle_t> handles;
+            for (uint64_t i = 0; i < 20; ++i) {
+                handles.push_back(graph.create_handle(std::string(1 + i % 3, "ACGT"[i % 4])));
+                if (i) graph.create_edge(handles[i-1], handles[i]);
+            }
+            for (uint64_t k = 0; k < 3; ++k) {
+                path_handle_t p = graph.create_path_handle("HG002#" + std::to_string(k) + "#chr1:10-20");
+                for (uint64_t i = k; i < 20; i += 1 + k) {
+                    graph.append_step(p, k % 2 ? graph.flip(handles[i]) : handles[i]);
+                }
+            }
+            XP path_index;
+            path_index.from_handle_graph(graph, 2);
+
+            std::vector<algorithms::path_position_query_t> queries;
+            for (uint64_t k = 0; k < 3; ++k) {
+                const std::string name = "HG002#" + std::to_string(k) + "#chr1:10-20";
+                const uint64_t length = path_index.get_path_length(path_index.get_path_handle(name));
+                for (uint64_t pos = 0; pos <= length + 1; ++pos) {
+                    queries.push_back({name, pos});
+                }
+            }
+            queries.push_back({"HG003#1#chr1", 1});
+            const auto positions = algorithms::lift_position_batch(path_index, queries, 4);
+            REQUIRE(positions.size() == queries.size());
+            for (uint64_t i = 0; i < queries.size(); ++i) {
+                auto& query = queries[i];
+                // positions are 1-based, and 0 where there is nothing to lift
+                if (query.position > 0 && path_index.has_position(query.path_name, query.position - 1)) {
+                    REQUIRE(positions[i] == path_index.get_pangenome_pos(query.path_name, query.position - 1) + 1);
+                } else {
+                    REQUIRE(positions[i] == 0);
+                }
+            }
+
+            SECTION("JSON and TSV batches ask for the same lookups") {
+                bool is_json = false;
+                const auto from_json = algorithms::parse_position_batch(
+                        R"( [{"path": "HG002#1#chr1:10-20", "pos": 3}, ["HG002#0#chr1:10-20", "5"]] )", is_json);
+                REQUIRE(is_json);
+                const auto from_tsv = algorithms::parse_position_batch(
+                        "HG002#1#chr1:10-20\t3\r\nHG002#0#chr1:10-20:5\n", is_json);
+                REQUIRE(!is_json);
+                REQUIRE(from_json.size() == 2);
+                REQUIRE(from_tsv.size() == 2);
+                for (uint64_t i = 0; i < 2; ++i) {
+                    REQUIRE(from_json[i].path_name == from_tsv[i].path_name);
+                    REQUIRE(from_json[i].position == from_tsv[i].position);
+                }
+                const auto lifted = algorithms::lift_position_batch(path_index, from_json, 1);
+                REQUIRE(algorithms::format_position_batch(from_json, lifted, true)
+                        == "[" + std::to_string(lifted[0]) + "," + std::to_string(lifted[1]) + "]");
+                REQUIRE_THROWS(algorithms::parse_position_batch("[{\"path\": \"x\"}]", is_json));
+                REQUIRE_THROWS(algorithms::parse_position_batch("x:-1", is_json));
+            }
+
+            SECTION("Names matching only the end of PanSN names are not found") {
+                for (uint64_t k = 0; k < 3; ++k) {
+                    const std::string name = "HG002#" + std::to_string(k) + "#chr1:10-20";
+                    REQUIRE(path_index.get_path_name(path_index.find_path_handle(name)) == name);
+                }
+                // each of these is the end of all three names, or of one
+                std::vector<algorithms::path_position_query_t> suffixes = {{"chr1:10-20", 1}, {"1#chr1:10-20", 1}, {"", 1}};
+                for (auto& query : suffixes) {
+                    REQUIRE(as_integer(path_index.find_path_handle(query.path_name)) == 0);
+                }
+                REQUIRE(algorithms::lift_position_batch(path_index, suffixes, 2) == std::vector<uint64_t>{0, 0, 0});
+            }
+        }
     }
 }
@@ -0,0 +1,112 @@
+#include "catch.hpp"
+
+#include "response_cache.hpp"
+#include "telemetry.hpp"
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace odgi {
+
+    namespace unittest {
+
+    using namespace std;
+
+        TEST_CASE("Keeping server answers by query", "[response_cache]") {
+            auto answer = [](const std::string& body) {
+                return std::make_shared<const cached_response_t>(cached_response_t{body, "text/plain"});
+            };
+            // each entry counts its key, body and content type, and 64 bytes of bookkeeping
+            const uint64_t entry_bytes = 1 + 10 + 10 + 64;
+
+            SECTION("The least recently used answers are dropped to make room") {
+                response_cache_t cache(3 * entry_bytes, 1);
+                cache.put("a", answer("0123456789"));
+                cache.put("b", answer("1234567890"));
+                cache.put("c", answer("2345678901"));
+                REQUIRE(cache.get_entry_count() == 3);
+                REQUIRE(cache.get_bytes() == 3 * entry_bytes);
+                // a is now used more recently than b
+                REQUIRE(cache.get("a")->body == "0123456789");
+                cache.put("d", answer("3456789012"));
+                REQUIRE(cache.get("b") == nullptr);
+                REQUIRE(cache.get("a") != nullptr);
+                REQUIRE(cache.get("c") != nullptr);
+                REQUIRE(cache.get("d")->content_type == "text/plain");
+                REQUIRE(cache.get_entry_count() == 3);
+                REQUIRE(cache.get_eviction_count() == 1);
+            }
+
+            SECTION("Answering a query again replaces its answer") {
+                response_cache_t cache(3 * entry_bytes, 1);
+                cache.put("a", answer("0123456789"));
+                cache.put("a", answer("9876543210"));
+                REQUIRE(cache.get_entry_count() == 1);
+                REQUIRE(cache.get_bytes() == entry_bytes);
+                REQUIRE(cache.get("a")->body == "9876543210");
+            }
+
+            SECTION("Answers larger than the cache are not kept") {
+                response_cache_t cache(entry_bytes, 1);
+                cache.put("a", answer("0123456789"));
+                cache.put("b", answer("01234567890"));
+                REQUIRE(cache.get("b") == nullptr);
+                REQUIRE(cache.get("a") != nullptr);
+                REQUIRE(cache.get_eviction_count() == 0);
+            }
+
+            SECTION("Answers are spread over shards that threads use at once") {
+                // room for 100 answers in each of 4 shards
+                response_cache_t cache(4 * 100 * (3 + 10 + 10 + 64), 4);
+                REQUIRE(cache.get_max_bytes() == 4 * 100 * (3 + 10 + 10 + 64));
+                // assertions aren't thread safe, so the threads only count misses
+                std::atomic<uint64_t> misses{0};
+                std::vector<std::thread> threads;
+                for (uint64_t t = 0; t < 4; ++t) {
+                    threads.emplace_back([&cache, &answer, &misses, t]() {
+                        for (uint64_t i = 0; i < 50; ++i) {
+                            const std::string key = std::to_string(100 + t * 50 + i);
+                            cache.put(key, answer("0123456789"));
+                            if (cache.get(key) == nullptr) {
+                                ++misses;
+                            }
+                        }
+                    });
+                }
+                for (auto& thread : threads) {
+                    thread.join();
+                }
+                REQUIRE(misses == 0);
+                REQUIRE(cache.get_entry_count() == 200);
+                REQUIRE(cache.get_bytes() == 200 * (3 + 10 + 10 + 64));
+                REQUIRE(cache.get_eviction_count() == 0);
+                for (uint64_t i = 100; i < 300; ++i) {
+                    REQUIRE(cache.get(std::to_string(i))->body == "0123456789");
+                }
+            }
+        }
+
+        TEST_CASE("Finding quantiles of latencies", "[telemetry]") {
+            telemetry::latency_histogram_t histogram;
+            REQUIRE(histogram.quantile(0.5) == 0);
+            // 98 fast requests of 100 microseconds, and two slow ones of 10 milliseconds
+            for (uint64_t i = 0; i < 98; ++i) {
+                histogram.record(100e-6);
+            }
+            histogram.record(10e-3);
+            histogram.record(10e-3);
+            REQUIRE(histogram.count() == 100);
+            REQUIRE(histogram.sum() == Approx(98 * 100e-6 + 2 * 10e-3));
+            // 100 microseconds fall in [64, 128), and 10 milliseconds in [8192, 16384)
+            REQUIRE(histogram.quantile(0.5) == Approx(128e-6));
+            REQUIRE(histogram.quantile(0.98) == Approx(128e-6));
+            REQUIRE(histogram.quantile(0.99) == Approx(16384e-6));
+            REQUIRE(histogram.quantile(1) == Approx(16384e-6));
+        }
+
+    }
+
+}
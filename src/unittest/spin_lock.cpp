@@ -0,0 +1,91 @@
+/**
+ * \file
+ * unittest/spin_lock.cpp: test cases for the locks of node and path records.
+ */
+
+#include "catch.hpp"
+
+#include "spin_lock.hpp"
+#include "algorithms/temp_file.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace odgi {
+namespace unittest {
+
+using namespace std;
+
+TEST_CASE("Spin locks exclude each other and count their contention", "[spin_lock]") {
+
+    SECTION("Threads taking the same lock never hold it at once") {
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        uint64_t counter = 0;
+        std::vector<std::thread> threads;
+        for (uint64_t t = 0; t < 8; ++t) {
+            threads.emplace_back([&]() {
+                for (uint64_t i = 0; i < 100000; ++i) {
+                    spin_lock::acquire(lock, spin_lock::node_lock, 1);
+                    ++counter;
+                    spin_lock::release(lock);
+                }
+            });
+        }
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        REQUIRE(counter == 8 * 100000);
+    }
+
+    SECTION("A waiter backs off until it yields, and its attempts and yields are counted") {
+        // an id no other test locks, so that its counts are ours alone
+        const uint64_t id = 987654321;
+        spin_lock::enable_stats();
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        spin_lock::acquire(lock, spin_lock::path_lock, id);
+        std::atomic<bool> acquired{false};
+        std::thread waiter([&]() {
+            spin_lock::acquire(lock, spin_lock::path_lock, id);
+            acquired = true;
+            spin_lock::release(lock);
+        });
+        // far longer than the whole backoff, so the waiter must be yielding by the time we release
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        REQUIRE(!acquired);
+        spin_lock::release(lock);
+        waiter.join();
+        REQUIRE(acquired);
+        spin_lock::enable_stats(false);
+
+        const std::string filename = algorithms::temp_file::create("spin_lock");
+        spin_lock::write_stats(filename);
+        std::ifstream in(filename);
+        std::string line;
+        std::getline(in, line);
+        REQUIRE(line == "#kind\tid\tcontended\tattempts\tyields");
+        bool found = false;
+        while (std::getline(in, line)) {
+            std::stringstream fields(line);
+            std::string kind;
+            uint64_t line_id = 0, contended = 0, attempts = 0, yields = 0;
+            fields >> kind >> line_id >> contended >> attempts >> yields;
+            if (kind == "path" && line_id == id) {
+                found = true;
+                REQUIRE(contended == 1);
+                REQUIRE(attempts > 1);
+                REQUIRE(yields > 0);
+                REQUIRE(attempts > yields);
+            }
+        }
+        REQUIRE(found);
+        algorithms::temp_file::remove(filename);
+    }
+}
+
+}
+}
@@ -10,6 +10,9 @@
 #include "stepindex.hpp"
 
 #include "algorithms/xp.hpp"
+#include "algorithms/index_cache.hpp"
+#include <filesystem>
+#include <chrono>
 
 namespace odgi {
 	namespace unittest {
@@ -77,6 +80,31 @@ namespace odgi {
 				paths.push_back(path);
 			});
 
+			SECTION("Positions looked up in a batch match those looked up one at a time.") {
+				for (uint64_t sample_rate : {0, 1, 2, 4, 8, 16}) {
+					step_index_t step_index(graph, paths, 1, false, sample_rate);
+					std::vector<step_handle_t> steps;
+					for (auto& path : paths) {
+						graph.for_each_step_in_path(path, [&](const step_handle_t& occ) {
+							steps.push_back(occ);
+						});
+						steps.push_back(graph.path_end(path));
+					}
+					// in path order the walks are shared, backwards and repeated they are not
+					std::vector<step_handle_t> backwards(steps.rbegin(), steps.rend());
+					std::vector<step_handle_t> repeated = steps;
+					repeated.insert(repeated.end(), steps.begin(), steps.end());
+					for (auto* batch : {&steps, &backwards, &repeated}) {
+						std::vector<uint64_t> positions;
+						step_index.get_positions(*batch, positions, graph);
+						REQUIRE(positions.size() == batch->size());
+						for (uint64_t i = 0; i < batch->size(); ++i) {
+							REQUIRE(positions[i] == step_index.get_position(batch->at(i), graph));
+						}
+					}
+				}
+			}
+
 			SECTION("The index delivers the correct positions for a given step. Sample rate: 1.") {
 				step_index_t step_index_1(graph, paths, 1, false, 1);
 				graph.for_each_path_handle([&](const path_handle_t path) {
@@ -752,5 +780,127 @@ namespace odgi {
 			}
 
 		}
+
+		TEST_CASE("A cached step index is reused until the graph changes", "[stepindex]") {
+			graph_t graph;
+			handle_t n1 = graph.create_handle("CAA");
+			handle_t n2 = graph.create_handle("A");
+			handle_t n3 = graph.create_handle("GT");
+			graph.create_edge(n1, n2);
+			graph.create_edge(n2, n3);
+			path_handle_t path = graph.create_path_handle("path", false);
+			graph.append_step(path, n1);
+			graph.append_step(path, n2);
+			std::vector<path_handle_t> paths = {path};
+
+			const std::string dir = xp::temp_file::get_dir() + "/index_cache";
+			index_cache_t cache(dir, "graph.og");
+			auto count_files = [&]() {
+				return std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator());
+			};
+			const uint64_t fingerprint = graph.fingerprint();
+			REQUIRE(fingerprint == graph.fingerprint());
+
+			auto built = cached_step_index(&cache, graph, paths, 1, false, 2);
+			REQUIRE(count_files() == 1);
+			// a rebuilt index would be renamed into place with a new write time
+			const std::filesystem::path cached = std::filesystem::directory_iterator(dir)->path();
+			const auto stamp = std::filesystem::file_time_type::clock::now() - std::chrono::hours(24);
+			std::filesystem::last_write_time(cached, stamp);
+			// reading the graph with more threads doesn't change what it holds
+			graph.set_number_of_threads(4);
+			REQUIRE(graph.fingerprint() == fingerprint);
+			auto loaded = cached_step_index(&cache, graph, paths, 4, false, 2);
+			REQUIRE(count_files() == 1);
+			REQUIRE(std::filesystem::last_write_time(cached) == stamp);
+			graph.for_each_step_in_path(path, [&](const step_handle_t& step) {
+				REQUIRE(loaded->get_position(step, graph) == built->get_position(step, graph));
+			});
+			graph.set_number_of_threads(1);
+
+			step_handle_t added = graph.append_step(path, n3);
+			REQUIRE(graph.fingerprint() != fingerprint);
+			auto rebuilt = cached_step_index(&cache, graph, paths, 1, false, 2);
+			// the index of the earlier graph is replaced
+			REQUIRE(count_files() == 1);
+			REQUIRE(rebuilt->get_position(added, graph) == 4);
+			std::filesystem::remove_all(dir);
+		}
+
+		TEST_CASE("Graph files of the same name in different directories keep their own cached indexes", "[stepindex]") {
+			graph_t graph;
+			handle_t n1 = graph.create_handle("CAA");
+			handle_t n2 = graph.create_handle("A");
+			graph.create_edge(n1, n2);
+			path_handle_t path = graph.create_path_handle("path", false);
+			graph.append_step(path, n1);
+			graph.append_step(path, n2);
+			graph_t other;
+			handle_t m1 = other.create_handle("GT");
+			other.append_step(other.create_path_handle("path", false), m1);
+			std::vector<path_handle_t> paths = {path};
+
+			const std::string dir = xp::temp_file::get_dir() + "/index_cache_dirs";
+			index_cache_t cache(dir, "a/graph.og");
+			index_cache_t other_cache(dir, "b/graph.og");
+			REQUIRE(cache.file_of(graph.fingerprint(), "stpidx") != other_cache.file_of(graph.fingerprint(), "stpidx"));
+			// the same file named another way is the same graph
+			REQUIRE(index_cache_t(dir, "a/../a/graph.og").file_of(graph.fingerprint(), "stpidx")
+					== cache.file_of(graph.fingerprint(), "stpidx"));
+			cached_step_index(&cache, graph, paths, 1, false, 1);
+			cached_step_index(&other_cache, other, paths, 1, false, 1);
+			REQUIRE(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) == 2);
+			std::filesystem::remove_all(dir);
+		}
+
+		TEST_CASE("A cached step index is not reused when the steps on a node are in another order", "[stepindex]") {
+			// the same graph, with the steps of the two paths on the shared node added in either order
+			auto build = [](graph_t& graph, const bool x_first) {
+				handle_t n1 = graph.create_handle("CAA");
+				handle_t n2 = graph.create_handle("A");
+				handle_t n3 = graph.create_handle("GT");
+				graph.create_edge(n1, n2);
+				graph.create_edge(n2, n3);
+				path_handle_t x = graph.create_path_handle("x", false);
+				path_handle_t y = graph.create_path_handle("y", false);
+				graph.append_step(x, n1);
+				graph.append_step(y, n3);
+				if (x_first) {
+					graph.append_step(x, n2);
+					graph.append_step(y, n2);
+				} else {
+					graph.append_step(y, n2);
+					graph.append_step(x, n2);
+				}
+				graph.append_step(x, n3);
+			};
+			graph_t graph;
+			build(graph, true);
+			graph_t rebuilt;
+			build(rebuilt, false);
+			REQUIRE(graph.get_path_handle("x") == rebuilt.get_path_handle("x"));
+			REQUIRE(graph.fingerprint() != rebuilt.fingerprint());
+
+			const std::string dir = xp::temp_file::get_dir() + "/index_cache_ranks";
+			index_cache_t cache(dir, "graph.og");
+			std::vector<path_handle_t> paths;
+			graph.for_each_path_handle([&](const path_handle_t& path) {
+				paths.push_back(path);
+			});
+			cached_step_index(&cache, graph, paths, 1, false, 1);
+			const std::filesystem::path cached = std::filesystem::directory_iterator(dir)->path();
+			auto index = cached_step_index(&cache, rebuilt, paths, 1, false, 1);
+			// the index was built again, and replaced the one of the earlier graph
+			REQUIRE(!std::filesystem::exists(cached));
+			REQUIRE(std::distance(std::filesystem::directory_iterator(dir), std::filesystem::directory_iterator()) == 1);
+			for (auto& path : paths) {
+				uint64_t offset = 0;
+				rebuilt.for_each_step_in_path(path, [&](const step_handle_t& step) {
+					REQUIRE(index->get_position(step, rebuilt) == offset);
+					offset += rebuilt.get_length(rebuilt.get_handle_of_step(step));
+				});
+			}
+			std::filesystem::remove_all(dir);
+		}
 	}
 }
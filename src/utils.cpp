@@ -1,6 +1,8 @@
 #include <string>
 #include <algorithm>
 #include "utils.hpp"
+#include "mmap_graph.hpp"
+#include "telemetry.hpp"
 
 namespace utils {
     bool is_number(const std::string &s) {
@@ -89,7 +91,9 @@ namespace utils {
 			std::cerr << "[odgi::" << subcommmand_name << "] error: the given file \"" << infile << "\" does not exist. Please specify an existing input file in ODGI format via -i=[FILE], --idx=[FILE]." << std::endl;
 			exit(1);
 		}
-		if (utils::ends_with(infile, "gfa")) {
+		odgi::telemetry::set_threads(num_threads);
+		odgi::telemetry::phase_t phase("load graph", num_threads);
+		if (utils::ends_with(infile, "gfa") || utils::ends_with(infile, "gfa.gz") || utils::ends_with(infile, "gfa.bgz")) {
 			if (progress) {
 				std::cerr << "[odgi::" << subcommmand_name << "] warning: the given file \"" << infile << "\" is not in ODGI format. "
 																				   "To save time in the future, please use odgi build -i=[FILE], --idx=[FILE] -o=[FILE], --out=[FILE] "
@@ -97,14 +101,43 @@ namespace utils {
 			}
 			gfa_to_handle(infile, &graph, false, num_threads, progress);
 			graph.set_number_of_threads(num_threads);
+		} else if (odgi::mmap_graph_t::is_frozen(infile)) {
+			// subcommands that mutate the graph need a graph_t, read-only ones map it with handle_read_only_input
+			odgi::mmap_graph_t frozen(infile);
+			frozen.thaw(graph, num_threads);
+			graph.set_number_of_threads(num_threads);
 		} else {
 			ifstream f(infile.c_str());
+			graph.set_number_of_threads(num_threads);
 			graph.deserialize(f);
 			f.close();
 		}
+		phase.add_items(graph.get_node_count());
 		return 0;
     }
 
+	bool is_frozen_graph(const std::string &infile) {
+		return odgi::mmap_graph_t::is_frozen(infile);
+	}
+
+	const PathHandleGraph& handle_read_only_input(const std::string infile, const std::string subcommmand_name,
+												  const bool progress, const uint64_t num_threads,
+												  odgi::graph_t &graph, std::unique_ptr<odgi::mmap_graph_t> &frozen) {
+		if (infile == "-") {
+			graph.deserialize(std::cin);
+			return graph;
+		}
+		if (std::filesystem::exists(infile) && odgi::mmap_graph_t::is_frozen(infile)) {
+			odgi::telemetry::set_threads(num_threads);
+			odgi::telemetry::phase_t phase("load graph", num_threads);
+			frozen = std::make_unique<odgi::mmap_graph_t>(infile);
+			phase.add_items(frozen->get_node_count());
+			return *frozen;
+		}
+		handle_gfa_odgi_input(infile, subcommmand_name, progress, num_threads, graph);
+		return graph;
+	}
+
 	uint64_t modulo(const uint64_t n, const uint64_t d) {
 		return (n & (d - 1));
 	}
@@ -1,7 +1,9 @@
 #include "odgi.hpp"
+#include "mmap_graph.hpp"
 #include "gfa_to_handle.hpp"
 
 #include <filesystem>
+#include <memory>
 
 using namespace handlegraph;
 
@@ -16,6 +18,13 @@ namespace utils {
 	bool ends_with(const std::string &fullString, const std::string &ending);
 	int handle_gfa_odgi_input(const std::string infile, const std::string subcommmand_name, const bool progress,
 							  const uint64_t num_threads, odgi::graph_t &graph);
+	/// true if the file is a frozen graph that can be opened with odgi::mmap_graph_t
+	bool is_frozen_graph(const std::string &infile);
+	/// Open the input of a subcommand that only reads the graph: a frozen graph is mapped into
+	/// frozen and used from the mapping, anything else, including "-" for stdin, is loaded into graph
+	const PathHandleGraph& handle_read_only_input(const std::string infile, const std::string subcommmand_name,
+												  const bool progress, const uint64_t num_threads,
+												  odgi::graph_t &graph, std::unique_ptr<odgi::mmap_graph_t> &frozen);
 	/// this function will return n % d
 	/// it is assumed that d is one of 1, 2, 4, 8, 16, 32, ....
 	uint64_t modulo(const uint64_t n, const uint64_t d);